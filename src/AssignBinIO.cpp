@@ -0,0 +1,418 @@
+/*******************************************************************************
+ * This file is part of HmmUFOtu, an HMM and Phylogenetic placement
+ * based tool for Ultra-fast taxonomy assignment and OTU organization
+ * of microbiome sequencing data with species level accuracy.
+ * Copyright (C) 2017  Qi Zheng
+ *
+ * HmmUFOtu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HmmUFOtu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with AlignerBoost.  If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+/*
+ * AssignBinIO.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: zhengqi
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <stdexcept>
+#include <algorithm>
+#include <boost/algorithm/string.hpp> /* for boost string split */
+#include <boost/lexical_cast.hpp>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+#include "AssignBinIO.h"
+#include "BandedHMMP7.h"
+#include "HmmUFOtuConst.h"
+#include "StringUtils.h"
+
+namespace EGriceLab {
+namespace HmmUFOtu {
+
+using namespace std;
+
+const char AssignBinIO::MAGIC[8] = { 'H', 'U', 'A', 'S', 'S', 'I', 'G', 'N' };
+const uint32_t AssignBinIO::FORMAT_VERSION;
+const uint32_t AssignBinIO::DEFAULT_BLOCK_SIZE;
+
+/** trailer of the index offset and the magic */
+static const size_t TRAILER_LENGTH = sizeof(uint64_t) + sizeof(AssignBinIO::MAGIC);
+
+AssignBinIO::COL_TYPE AssignBinIO::colType(const string& name) {
+	if(name == "seq_start" || name == "seq_end" || name == "hmm_start" || name == "hmm_end"
+			|| name == "CS_start" || name == "CS_end"
+			|| name == "taxon_id" || name == "seg5_taxon_id" || name == "seg3_taxon_id")
+		return INT_COL;
+	else if(name == "cost" || name == "branch_ratio" || name == "anno_dist" || name == "loglik"
+			|| name == "Q_placement" || name == "Q_taxon" || name == "chimera_lod")
+		return REAL_COL;
+	else if(name == "alignment")
+		return ALIGN_COL;
+	else
+		return STRING_COL;
+}
+
+bool AssignBinIO::isBinFile(const string& fn) {
+	return StringUtils::endsWith(fn, ASSIGN_BIN_FILE_SUFFIX);
+}
+
+/** append a binary value to a buffer */
+template<typename T>
+static void appendValue(string& buf, const T& val) {
+	buf.append(reinterpret_cast<const char*> (&val), sizeof(T));
+}
+
+/** read a binary value from an input */
+template<typename T>
+static istream& readValue(istream& in, T& val) {
+	return in.read(reinterpret_cast<char*> (&val), sizeof(T));
+}
+
+/** append a length-prefixed string to a buffer */
+static void appendString(string& buf, const string& str) {
+	appendValue(buf, static_cast<uint64_t> (str.length()));
+	buf += str;
+}
+
+/** read a length-prefixed string from an input */
+static istream& readString(istream& in, string& str) {
+	uint64_t len = 0;
+	if(readValue(in, len)) {
+		str.resize(len);
+		if(len > 0)
+			in.read(&str[0], len);
+	}
+	return in;
+}
+
+/**
+ * append a column of raw data as codec, raw size, stored size and stored data
+ * @param compress  compress the data if zlib is available
+ */
+static void appendColumn(string& buf, const string& raw, bool compress) {
+#ifdef HAVE_LIBZ
+	if(!compress) {
+		appendValue(buf, static_cast<uint8_t> (AssignBinIO::RAW_CODEC));
+		appendValue(buf, static_cast<uint64_t> (raw.length()));
+		appendValue(buf, static_cast<uint64_t> (raw.length()));
+		buf += raw;
+		return;
+	}
+	uLongf storedLen = ::compressBound(raw.length());
+	string stored(storedLen, '\0');
+	if(::compress2(reinterpret_cast<Bytef*> (&stored[0]), &storedLen,
+			reinterpret_cast<const Bytef*> (raw.data()), raw.length(), Z_BEST_SPEED) != Z_OK)
+		throw std::runtime_error("Unable to compress assignment column");
+	stored.resize(storedLen);
+	appendValue(buf, static_cast<uint8_t> (AssignBinIO::ZLIB_CODEC));
+#else
+	const string& stored = raw;
+	appendValue(buf, static_cast<uint8_t> (AssignBinIO::RAW_CODEC));
+#endif
+	appendValue(buf, static_cast<uint64_t> (raw.length()));
+	appendValue(buf, static_cast<uint64_t> (stored.length()));
+	buf += stored;
+}
+
+ostream& AssignBinBlock::writeTSV(ostream& out, size_t i, bool compact) const {
+	for(vector<AssignBinIO::COL_TYPE>::size_type j = 0; j < types.size(); ++j) {
+		if(j > 0)
+			out << '\t';
+		switch(types[j]) {
+		case AssignBinIO::INT_COL:
+			out << getInts(j)[i];
+			break;
+		case AssignBinIO::REAL_COL:
+			out << getReals(j)[i];
+			break;
+		case AssignBinIO::ALIGN_COL:
+			if(!compact) {
+				BandedHMMP7::HmmAlignment::decodeAlign(getStr(j, i), getStr(j, i) + getStrLen(j, i), decoded);
+				out << decoded;
+				break;
+			}
+			/* no break */
+		default:
+			out.write(getStr(j, i), getStrLen(j, i));
+			break;
+		}
+	}
+	return out;
+}
+
+istream& AssignBinReader::readHeader() {
+	char magic[sizeof(AssignBinIO::MAGIC)];
+	uint32_t version = 0;
+	uint32_t nCol = 0;
+	if(!in.read(magic, sizeof(magic)) || std::memcmp(magic, AssignBinIO::MAGIC, sizeof(magic)) != 0
+			|| !readValue(in, version) || version != AssignBinIO::FORMAT_VERSION
+			|| !readString(in, comments) || !readValue(in, nCol)) {
+		in.setstate(std::ios_base::failbit);
+		return in;
+	}
+	colNames.resize(nCol);
+	colTypes.resize(nCol);
+	for(uint32_t j = 0; j < nCol && readString(in, colNames[j]); ++j)
+		colTypes[j] = AssignBinIO::colType(colNames[j]);
+	selected.assign(nCol, true);
+	return in;
+}
+
+string AssignBinReader::getColHeader() const {
+	string header;
+	for(vector<string>::const_iterator name = colNames.begin(); name != colNames.end(); ++name) {
+		if(name != colNames.begin())
+			header.push_back('\t');
+		header += *name;
+	}
+	return header;
+}
+
+int AssignBinReader::getColIdx(const string& name) const {
+	vector<string>::const_iterator it = std::find(colNames.begin(), colNames.end(), name);
+	return it != colNames.end() ? it - colNames.begin() : -1;
+}
+
+void AssignBinReader::selectCols(const vector<string>& names) {
+	selected.assign(colNames.size(), false);
+	for(vector<string>::const_iterator name = names.begin(); name != names.end(); ++name) {
+		int j = getColIdx(*name);
+		if(j >= 0)
+			selected[j] = true;
+	}
+}
+
+bool AssignBinReader::nextBlock(AssignBinBlock& block) {
+	uint32_t nRecord = 0;
+	if(!readValue(in, nRecord))
+		throw std::runtime_error("Truncated binary assignment input");
+	if(nRecord == 0) /* the end block */
+		return false;
+
+	const size_t nCol = colNames.size();
+	block.nRecord = nRecord;
+	block.types = colTypes;
+	block.loaded = selected;
+	block.data.resize(nCol);
+	block.strStart.resize(nCol);
+	string stored;
+	for(size_t j = 0; j < nCol; ++j) {
+		uint8_t codec;
+		uint64_t rawSize, storedSize;
+		if(!readValue(in, codec) || !readValue(in, rawSize) || !readValue(in, storedSize))
+			throw std::runtime_error("Truncated binary assignment input");
+		if(!selected[j]) { /* skip this column */
+			if(!in.seekg(storedSize, std::ios_base::cur)) { /* not seekable */
+				in.clear();
+				in.ignore(storedSize);
+			}
+			continue;
+		}
+
+		/* load column */
+		string& raw = block.data[j];
+		if(codec == AssignBinIO::RAW_CODEC) {
+			raw.resize(storedSize);
+			if(storedSize > 0)
+				in.read(&raw[0], storedSize);
+		}
+		else if(codec == AssignBinIO::ZLIB_CODEC) {
+#ifdef HAVE_LIBZ
+			stored.resize(storedSize);
+			if(storedSize > 0)
+				in.read(&stored[0], storedSize);
+			raw.resize(rawSize);
+			uLongf rawLen = rawSize;
+			if(in && rawSize > 0 && (::uncompress(reinterpret_cast<Bytef*> (&raw[0]), &rawLen,
+					reinterpret_cast<const Bytef*> (stored.data()), storedSize) != Z_OK || rawLen != rawSize))
+				throw std::runtime_error("Corrupted column '" + colNames[j] + "' in binary assignment input");
+#else
+			throw std::runtime_error("Compressed binary assignment input is not supported without zlib");
+#endif
+		}
+		else
+			throw std::runtime_error("Unknown codec of column '" + colNames[j] + "' in binary assignment input");
+		if(!in)
+			throw std::runtime_error("Truncated binary assignment input");
+
+		/* check column size */
+		size_t expSize = 0;
+		switch(colTypes[j]) {
+		case AssignBinIO::INT_COL:
+			expSize = nRecord * sizeof(int64_t);
+			break;
+		case AssignBinIO::REAL_COL:
+			expSize = nRecord * sizeof(double);
+			break;
+		default: /* index string values */
+			vector<size_t>& start = block.strStart[j];
+			start.resize(nRecord + 1);
+			start[0] = 0;
+			for(uint32_t i = 0; i < nRecord; ++i) {
+				const void* end = start[i] < raw.length() ? ::memchr(raw.data() + start[i], '\0', raw.length() - start[i]) : NULL;
+				if(end == NULL)
+					throw std::runtime_error("Corrupted column '" + colNames[j] + "' in binary assignment input");
+				start[i + 1] = static_cast<const char*> (end) - raw.data() + 1;
+			}
+			expSize = start[nRecord];
+			break;
+		}
+		if(raw.length() != expSize)
+			throw std::runtime_error("Corrupted column '" + colNames[j] + "' in binary assignment input");
+	}
+	return true;
+}
+
+bool AssignBinReader::loadIndex() {
+	const istream::pos_type cur = in.tellg();
+	if(cur == istream::pos_type(-1)) /* not seekable */
+		return false;
+	char magic[sizeof(AssignBinIO::MAGIC)];
+	uint64_t indexOffset, nBlock;
+	if(!in.seekg(-static_cast<istream::off_type> (TRAILER_LENGTH), std::ios_base::end)
+			|| !readValue(in, indexOffset) || !in.read(magic, sizeof(magic))
+			|| std::memcmp(magic, AssignBinIO::MAGIC, sizeof(magic)) != 0
+			|| !in.seekg(indexOffset) || !readValue(in, nBlock)) {
+		in.clear();
+		in.seekg(cur);
+		return false;
+	}
+	blockOffset.resize(nBlock);
+	blockStart.resize(nBlock + 1);
+	blockStart[0] = 0;
+	for(uint64_t k = 0; k < nBlock; ++k) {
+		uint32_t nRecord;
+		readValue(in, blockOffset[k]);
+		readValue(in, nRecord);
+		blockStart[k + 1] = blockStart[k] + nRecord;
+	}
+	if(!in) {
+		blockOffset.clear();
+		blockStart.clear();
+		in.clear();
+		in.seekg(cur);
+		return false;
+	}
+	in.seekg(cur);
+	indexLoaded = true;
+	return true;
+}
+
+long AssignBinReader::seekRecord(uint64_t i) {
+	if(!indexLoaded || i >= numRecords())
+		return -1;
+	const uint64_t k = std::upper_bound(blockStart.begin(), blockStart.end(), i) - blockStart.begin() - 1;
+	if(!in.seekg(blockOffset[k]))
+		return -1;
+	return i - blockStart[k];
+}
+
+void AssignBinWriter::addLine() {
+	if(!headerDone) {
+		if(!line.empty() && line[0] == '#') { /* comment line */
+			comments += line;
+			comments.push_back('\n');
+			return;
+		}
+		/* column names */
+		vector<string> colNames;
+		boost::split(colNames, line, boost::is_any_of("\t"));
+		colTypes.resize(colNames.size());
+		for(vector<string>::size_type j = 0; j < colNames.size(); ++j)
+			colTypes[j] = AssignBinIO::colType(colNames[j]);
+		data.resize(colNames.size());
+
+		pending.append(AssignBinIO::MAGIC, sizeof(AssignBinIO::MAGIC));
+		appendValue(pending, AssignBinIO::FORMAT_VERSION);
+		appendString(pending, comments);
+		appendValue(pending, static_cast<uint32_t> (colNames.size()));
+		for(vector<string>::const_iterator name = colNames.begin(); name != colNames.end(); ++name)
+			appendString(pending, *name);
+		headerDone = true;
+		return;
+	}
+
+	/* a record */
+	const char* p = line.c_str();
+	const char* end = p + line.length();
+	for(vector<string>::size_type j = 0; j < colTypes.size(); ++j) {
+		const char* fieldEnd = static_cast<const char*> (::memchr(p, '\t', end - p));
+		if(fieldEnd == NULL)
+			fieldEnd = end;
+		if((j + 1 < colTypes.size()) != (fieldEnd != end))
+			throw std::invalid_argument("Unmatched number of fields in assignment record '" + line.substr(0, line.find('\t')) + "'");
+		char* valEnd;
+		switch(colTypes[j]) {
+		case AssignBinIO::INT_COL:
+			appendValue(data[j], static_cast<int64_t> (::strtoll(p, &valEnd, 10)));
+			break;
+		case AssignBinIO::REAL_COL:
+			appendValue(data[j], ::strtod(p, &valEnd));
+			break;
+		case AssignBinIO::ALIGN_COL:
+			if(std::find_if(p, fieldEnd, ::isdigit) == fieldEnd) { /* not encoded yet */
+				data[j] += BandedHMMP7::HmmAlignment::encodeAlign(string(p, fieldEnd));
+				data[j].push_back('\0');
+				valEnd = const_cast<char*> (fieldEnd);
+				break;
+			}
+			/* no break */
+		default:
+			data[j].append(p, fieldEnd);
+			data[j].push_back('\0');
+			valEnd = const_cast<char*> (fieldEnd);
+			break;
+		}
+		if(valEnd != fieldEnd || (colTypes[j] == AssignBinIO::INT_COL || colTypes[j] == AssignBinIO::REAL_COL) && p == fieldEnd)
+			throw std::invalid_argument("Invalid value of column " + boost::lexical_cast<string>(j + 1)
+					+ " in assignment record '" + line.substr(0, line.find('\t')) + "'");
+		p = fieldEnd + 1;
+	}
+	if(++nRecord == blockSize)
+		flushBlock();
+}
+
+void AssignBinWriter::flushBlock() {
+	if(nRecord == 0)
+		return;
+	blockOffset.push_back(offset + pending.length());
+	blockSizes.push_back(nRecord);
+	appendValue(pending, nRecord);
+	for(vector<string>::size_type j = 0; j < data.size(); ++j) {
+		/* aligned seqs are already run-length encoded, and inflating them would dominate the reading time */
+		appendColumn(pending, data[j], colTypes[j] != AssignBinIO::ALIGN_COL);
+		data[j].clear();
+	}
+	nRecord = 0;
+}
+
+void AssignBinWriter::finish() {
+	if(!headerDone)
+		throw std::invalid_argument("Missing column header in assignment output");
+	flushBlock();
+	appendValue(pending, static_cast<uint32_t> (0)); /* the end block */
+	const uint64_t indexOffset = offset + pending.length();
+	appendValue(pending, static_cast<uint64_t> (blockOffset.size()));
+	for(vector<uint64_t>::size_type k = 0; k < blockOffset.size(); ++k) {
+		appendValue(pending, blockOffset[k]);
+		appendValue(pending, blockSizes[k]);
+	}
+	appendValue(pending, indexOffset);
+	pending.append(AssignBinIO::MAGIC, sizeof(AssignBinIO::MAGIC));
+}
+
+} /* namespace HmmUFOtu */
+} /* namespace EGriceLab */
@@ -0,0 +1,283 @@
+/*******************************************************************************
+ * This file is part of HmmUFOtu, an HMM and Phylogenetic placement
+ * based tool for Ultra-fast taxonomy assignment and OTU organization
+ * of microbiome sequencing data with species level accuracy.
+ * Copyright (C) 2017  Qi Zheng
+ *
+ * HmmUFOtu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HmmUFOtu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with AlignerBoost.  If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+/*
+ * AssignBinIO.h
+ * Binary columnar format of the hmmufotu assignment outputs
+ *  Created on: Oct 19, 2026
+ *      Author: zhengqi
+ */
+
+#ifndef SRC_ASSIGNBINIO_H_
+#define SRC_ASSIGNBINIO_H_
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstring>
+#include <stdint.h> /* for fixed size integers */
+#include <boost/iostreams/concepts.hpp> /* for multichar_output_filter */
+#include <boost/iostreams/operations.hpp> /* for boost::iostreams::write */
+
+namespace EGriceLab {
+namespace HmmUFOtu {
+
+using std::string;
+using std::vector;
+using std::istream;
+using std::ostream;
+
+/**
+ * Binary columnar format of the assignment outputs, as an alternative to the TSV format
+ * A file has a header of the magic, format version, the '#' comment lines and the column names of the TSV format,
+ * followed by blocks of up to blockSize records, an empty block, a block index and a trailer of the index offset and the magic.
+ * Every column of a block is stored separately, so readers can skip the columns they don't need;
+ * integer and real columns are stored as zlib compressed native binary values, string columns as compressed '\0' terminated strings,
+ * and the alignment column is encoded by BandedHMMP7::HmmAlignment::encodeAlign but not compressed, for fast reading
+ */
+class AssignBinIO {
+public:
+	/** column types, determined by the column names */
+	enum COL_TYPE { STRING_COL, INT_COL, REAL_COL, ALIGN_COL };
+
+	/** codecs of stored column data */
+	enum CODEC { RAW_CODEC, ZLIB_CODEC };
+
+	/** get the type of a column of the TSV format */
+	static COL_TYPE colType(const string& name);
+
+	/** test whether a file name is of the binary format */
+	static bool isBinFile(const string& fn);
+
+	static const char MAGIC[8];
+	static const uint32_t FORMAT_VERSION = 1;
+	static const uint32_t DEFAULT_BLOCK_SIZE = 4096;
+};
+
+/**
+ * A block of assignment records, with only the columns selected by its reader loaded
+ */
+class AssignBinBlock {
+public:
+	/** get number of records */
+	size_t size() const {
+		return nRecord;
+	}
+
+	/** test whether column j is loaded */
+	bool hasCol(int j) const {
+		return j >= 0 && j < static_cast<int> (loaded.size()) && loaded[j];
+	}
+
+	/** get the values of an integer column */
+	const int64_t* getInts(int j) const {
+		return reinterpret_cast<const int64_t*> (data[j].data());
+	}
+
+	/** get the values of a real column */
+	const double* getReals(int j) const {
+		return reinterpret_cast<const double*> (data[j].data());
+	}
+
+	/** get the '\0' terminated value of record i in a string or alignment column */
+	const char* getStr(int j, size_t i) const {
+		return data[j].data() + strStart[j][i];
+	}
+
+	/** get the length of the value of record i in a string or alignment column */
+	size_t getStrLen(int j, size_t i) const {
+		return strStart[j][i + 1] - strStart[j][i] - 1;
+	}
+
+	/**
+	 * write record i as a TSV line, all columns must be loaded
+	 * @param compact  keep the aligned seqs encoded as by --compact-align
+	 */
+	ostream& writeTSV(ostream& out, size_t i, bool compact = false) const;
+
+	friend class AssignBinReader;
+
+private:
+	size_t nRecord;
+	vector<AssignBinIO::COL_TYPE> types;
+	vector<bool> loaded;
+	vector<string> data; /* raw data of each column */
+	vector<vector<size_t> > strStart; /* start of each value in a string column, with a sentinel */
+	mutable string decoded; /* decoded aligned seq buffer */
+};
+
+/**
+ * Reader of the binary assignment format
+ */
+class AssignBinReader {
+public:
+	/** construct a reader on a binary input */
+	explicit AssignBinReader(istream& in) : in(in), indexLoaded(false)
+	{  }
+
+	/**
+	 * read the header, and select all columns
+	 * @return  the input, with failbit set if it is not a valid binary assignment input
+	 */
+	istream& readHeader();
+
+	/** get the '#' comment lines of the TSV format */
+	const string& getComments() const {
+		return comments;
+	}
+
+	/** get the column names */
+	const vector<string>& getColNames() const {
+		return colNames;
+	}
+
+	/** get the TSV header line of the column names, without the newline */
+	string getColHeader() const;
+
+	/** get the index of a column by name, or -1 if not exists */
+	int getColIdx(const string& name) const;
+
+	/** select or deselect column j for the following reads */
+	void selectCol(int j, bool select = true) {
+		selected[j] = select;
+	}
+
+	/** select only the given columns for the following reads, ignoring names not exist */
+	void selectCols(const vector<string>& names);
+
+	/**
+	 * read the next block with the selected columns, skipping others
+	 * @return  true if a non-empty block is read
+	 * @throw std::runtime_error if the input is corrupted
+	 */
+	bool nextBlock(AssignBinBlock& block);
+
+	/**
+	 * load the block index for random access, the input must be seekable
+	 * @return  true if loaded
+	 */
+	bool loadIndex();
+
+	/** get total number of records, the index must be loaded */
+	uint64_t numRecords() const {
+		return !blockStart.empty() ? blockStart.back() : 0;
+	}
+
+	/**
+	 * seek to the block containing record i, using the loaded index
+	 * @return  the index of record i in that block, or -1 if i is out of range
+	 */
+	long seekRecord(uint64_t i);
+
+private:
+	/** disable copy and assignment */
+	AssignBinReader(const AssignBinReader& other);
+	AssignBinReader& operator=(const AssignBinReader& other);
+
+	istream& in;
+	string comments;
+	vector<string> colNames;
+	vector<AssignBinIO::COL_TYPE> colTypes;
+	vector<bool> selected;
+	bool indexLoaded;
+	vector<uint64_t> blockOffset;
+	vector<uint64_t> blockStart; /* first record of each block, with a sentinel */
+};
+
+/**
+ * An output filter converting the TSV assignment output written through it to the binary format,
+ * so a boost filtering_ostream can write binary outputs without changes of its writers
+ */
+class AssignBinWriter : public boost::iostreams::multichar_output_filter {
+public:
+	/** construct a writer with given number of records per block */
+	explicit AssignBinWriter(uint32_t blockSize = AssignBinIO::DEFAULT_BLOCK_SIZE)
+	: blockSize(blockSize), headerDone(false), closed(false), nRecord(0), offset(0)
+	{  }
+
+	/** filter TSV text to binary output */
+	template<typename Sink>
+	std::streamsize write(Sink& snk, const char* s, std::streamsize n) {
+		const char* end = s + n;
+		for(const char* p = s; p < end; ) {
+			const char* nl = static_cast<const char*> (::memchr(p, '\n', end - p));
+			if(nl == NULL) {
+				line.append(p, end);
+				break;
+			}
+			line.append(p, nl);
+			addLine();
+			line.clear();
+			p = nl + 1;
+		}
+		writePending(snk);
+		return n;
+	}
+
+	/** finish all blocks and write the block index */
+	template<typename Sink>
+	void close(Sink& snk) {
+		if(closed)
+			return;
+		closed = true;
+		if(!line.empty()) { /* last line without newline */
+			addLine();
+			line.clear();
+		}
+		finish();
+		writePending(snk);
+	}
+
+private:
+	/** add a complete TSV line */
+	void addLine();
+
+	/** encode the current block to pending output */
+	void flushBlock();
+
+	/** finish the output, after all lines are added */
+	void finish();
+
+	template<typename Sink>
+	void writePending(Sink& snk) {
+		if(!pending.empty()) {
+			boost::iostreams::write(snk, pending.data(), pending.size());
+			offset += pending.size();
+			pending.clear();
+		}
+	}
+
+	uint32_t blockSize;
+	bool headerDone;
+	bool closed;
+	string line; /* current incomplete line */
+	string comments;
+	vector<AssignBinIO::COL_TYPE> colTypes;
+	vector<string> data; /* raw data of each column of current block */
+	uint32_t nRecord; /* records in current block */
+	string pending; /* encoded output not written yet */
+	uint64_t offset; /* output offset of pending */
+	vector<uint64_t> blockOffset;
+	vector<uint32_t> blockSizes;
+};
+
+} /* namespace HmmUFOtu */
+} /* namespace EGriceLab */
+
+#endif /* SRC_ASSIGNBINIO_H_ */
@@ -57,7 +57,7 @@ const IOFormat tabFmt(StreamPrecision, DontAlignCols, "\t", "\n", "", "", "", ""
 
 BandedHMMP7::BandedHMMP7() :
 		name("unnamed"), K(0), L(0), abc(NULL),
-		hmmBg(0), nSeq(0), effN(0), wingRetracted(false) {
+		hmmBg(0), nSeq(0), effN(0), wingRetracted(false), seqMode(GLOBAL) {
 	/* Assert IEE559 at construction time */
 	assert(std::numeric_limits<double>::is_iec559);
 }
@@ -66,7 +66,7 @@ BandedHMMP7::BandedHMMP7(const string& name, int K, const DegenAlphabet* abc) :
 		name(name), K(K), L(0), abc(abc),
 		hmmBg(K), nSeq(0), effN(0),
 		cs2ProfileIdx() /* zero initiation */, profile2CSIdx() /* zero initiation */,
-		wingRetracted(false) {
+		wingRetracted(false), seqMode(GLOBAL) {
 	if(!(abc->getAlias() == "DNA" && abc->getSize() == 4))
 		throw invalid_argument("BandedHMMP7 only supports DNA alphabet");
 	/* Assert IEE559 at construction time */
@@ -83,7 +83,7 @@ BandedHMMP7::BandedHMMP7(const string& name, const string& hmmVersion, int K, co
 		name(name), hmmVersion(hmmVersion), K(K), L(0), abc(abc),
 		hmmBg(K), nSeq(0), effN(0),
 		cs2ProfileIdx() /* zero initiation */, profile2CSIdx() /* zero initiation */,
-		wingRetracted(false) {
+		wingRetracted(false), seqMode(GLOBAL) {
 	if(!(abc->getAlias() == "DNA" && abc->getSize() == 4))
 		throw invalid_argument("BandedHMMP7 only supports DNA alphabet");
 	/* Assert IEE559 at construction time */
@@ -377,6 +377,167 @@ ostream& operator<<(ostream& out, const BandedHMMP7& hmm) {
 	return out;
 }
 
+ostream& BandedHMMP7::save(ostream& out) const {
+	/* save basic info */
+	StringUtils::saveString(hmmVersion, out);
+	StringUtils::saveString(name, out);
+	StringUtils::saveString(abc->getName(), out);
+	out.write((const char*) &K, sizeof(int));
+	out.write((const char*) &L, sizeof(int));
+	out.write((const char*) &nSeq, sizeof(int));
+	out.write((const char*) &effN, sizeof(double));
+	out.write((const char*) &wingRetracted, sizeof(bool));
+
+	/* save optional tags */
+	size_t nTag = optTagNames.size();
+	out.write((const char*) &nTag, sizeof(size_t));
+	for(vector<string>::const_iterator it = optTagNames.begin(); it != optTagNames.end(); ++it) {
+		StringUtils::saveString(*it, out);
+		StringUtils::saveString(getOptTag(*it), out);
+	}
+	size_t nLocTag = locOptTags.size();
+	out.write((const char*) &nLocTag, sizeof(size_t));
+	for(map<string, vector<string> >::const_iterator it = locOptTags.begin(); it != locOptTags.end(); ++it) {
+		StringUtils::saveString(it->first, out);
+		size_t n = it->second.size();
+		out.write((const char*) &n, sizeof(size_t));
+		for(vector<string>::const_iterator val = it->second.begin(); val != it->second.end(); ++val)
+			StringUtils::saveString(*val, out);
+	}
+
+	/* save background */
+	Vector4d bgFreq = hmmBg.getBgEmitPr();
+	out.write((const char*) bgFreq.data(), bgFreq.size() * sizeof(double));
+
+	/* save probability and cost matrices, all with known sizes */
+	for(int k = 0; k <= K; ++k) {
+		out.write((const char*) Tmat[k].data(), Tmat[k].size() * sizeof(double));
+		out.write((const char*) Tmat_cost[k].data(), Tmat_cost[k].size() * sizeof(double));
+	}
+	out.write((const char*) E_M.data(), E_M.size() * sizeof(double));
+	out.write((const char*) E_I.data(), E_I.size() * sizeof(double));
+	out.write((const char*) E_SP.data(), E_SP.size() * sizeof(double));
+	out.write((const char*) T_SP.data(), T_SP.size() * sizeof(double));
+	out.write((const char*) entryPr.data(), entryPr.size() * sizeof(double));
+	out.write((const char*) exitPr.data(), exitPr.size() * sizeof(double));
+	out.write((const char*) E_M_cost.data(), E_M_cost.size() * sizeof(double));
+	out.write((const char*) E_I_cost.data(), E_I_cost.size() * sizeof(double));
+	out.write((const char*) E_SP_cost.data(), E_SP_cost.size() * sizeof(double));
+	out.write((const char*) T_SP_cost.data(), T_SP_cost.size() * sizeof(double));
+	out.write((const char*) entryPr_cost.data(), entryPr_cost.size() * sizeof(double));
+	out.write((const char*) exitPr_cost.data(), exitPr_cost.size() * sizeof(double));
+
+	/* save limits */
+	out.write((const char*) gapBeforeLimit.data(), gapBeforeLimit.size() * sizeof(int));
+	out.write((const char*) gapAfterLimit.data(), gapAfterLimit.size() * sizeof(int));
+
+	/* save used part of the index */
+	int csMax = std::min(std::max(L, profile2CSIdx[K]), kMaxProfile - 1);
+	out.write((const char*) &csMax, sizeof(int));
+	out.write((const char*) cs2ProfileIdx, (csMax + 1) * sizeof(int));
+	out.write((const char*) profile2CSIdx, (K + 1) * sizeof(int));
+
+	return out;
+}
+
+istream& BandedHMMP7::load(istream& in) {
+	/* load basic info */
+	StringUtils::loadString(hmmVersion, in);
+	StringUtils::loadString(name, in);
+	string alphabet;
+	StringUtils::loadString(alphabet, in);
+	abc = AlphabetFactory::getAlphabetByName(alphabet);
+	in.read((char*) &K, sizeof(int));
+	in.read((char*) &L, sizeof(int));
+	in.read((char*) &nSeq, sizeof(int));
+	in.read((char*) &effN, sizeof(double));
+	in.read((char*) &wingRetracted, sizeof(bool));
+	if(!(in && K > 0 && K < kMaxProfile && L >= 0 && L < kMaxCS)) {
+		in.setstate(ios_base::badbit);
+		return in;
+	}
+	setProfileSize(); /* re-initiate all matrices with size K */
+
+	/* load optional tags */
+	optTagNames.clear();
+	optTags.clear();
+	size_t nTag = 0;
+	in.read((char*) &nTag, sizeof(size_t));
+	if(!(in && nTag <= kMaxOptTag)) {
+		in.setstate(ios_base::badbit);
+		return in;
+	}
+	for(size_t i = 0; i < nTag && in; ++i) {
+		string tag, val;
+		StringUtils::loadString(tag, in);
+		StringUtils::loadString(val, in);
+		setOptTag(tag, val);
+	}
+	locOptTags.clear();
+	size_t nLocTag = 0;
+	in.read((char*) &nLocTag, sizeof(size_t));
+	if(!(in && nLocTag <= kMaxOptTag)) {
+		in.setstate(ios_base::badbit);
+		return in;
+	}
+	for(size_t i = 0; i < nLocTag && in; ++i) {
+		string tag;
+		StringUtils::loadString(tag, in);
+		size_t n = 0;
+		in.read((char*) &n, sizeof(size_t));
+		if(!(in && n <= static_cast<size_t>(K) + 1)) { /* one value per profile position */
+			in.setstate(ios_base::badbit);
+			return in;
+		}
+		vector<string>& vals = locOptTags[tag];
+		vals.resize(n);
+		for(size_t j = 0; j < n && in; ++j)
+			StringUtils::loadString(vals[j], in);
+	}
+
+	/* load background */
+	Vector4d bgFreq;
+	in.read((char*) bgFreq.data(), bgFreq.size() * sizeof(double));
+	hmmBg.setBgFreq(bgFreq);
+
+	/* load probability and cost matrices */
+	for(int k = 0; k <= K; ++k) {
+		in.read((char*) Tmat[k].data(), Tmat[k].size() * sizeof(double));
+		in.read((char*) Tmat_cost[k].data(), Tmat_cost[k].size() * sizeof(double));
+	}
+	in.read((char*) E_M.data(), E_M.size() * sizeof(double));
+	in.read((char*) E_I.data(), E_I.size() * sizeof(double));
+	in.read((char*) E_SP.data(), E_SP.size() * sizeof(double));
+	in.read((char*) T_SP.data(), T_SP.size() * sizeof(double));
+	in.read((char*) entryPr.data(), entryPr.size() * sizeof(double));
+	in.read((char*) exitPr.data(), exitPr.size() * sizeof(double));
+	in.read((char*) E_M_cost.data(), E_M_cost.size() * sizeof(double));
+	in.read((char*) E_I_cost.data(), E_I_cost.size() * sizeof(double));
+	in.read((char*) E_SP_cost.data(), E_SP_cost.size() * sizeof(double));
+	in.read((char*) T_SP_cost.data(), T_SP_cost.size() * sizeof(double));
+	in.read((char*) entryPr_cost.data(), entryPr_cost.size() * sizeof(double));
+	in.read((char*) exitPr_cost.data(), exitPr_cost.size() * sizeof(double));
+
+	/* load limits */
+	in.read((char*) gapBeforeLimit.data(), gapBeforeLimit.size() * sizeof(int));
+	in.read((char*) gapAfterLimit.data(), gapAfterLimit.size() * sizeof(int));
+
+	/* load index */
+	reset_index();
+	int csMax = 0;
+	in.read((char*) &csMax, sizeof(int));
+	if(!(csMax >= 0 && csMax < kMaxProfile)) {
+		in.setstate(ios_base::badbit);
+		return in;
+	}
+	in.read((char*) cs2ProfileIdx, (csMax + 1) * sizeof(int));
+	in.read((char*) profile2CSIdx, (K + 1) * sizeof(int));
+	if(in.fail()) /* truncated input */
+		in.setstate(ios_base::badbit);
+
+	return in;
+}
+
 ostream& operator<<(ostream& os, const deque<BandedHMMP7::p7_state>& path) {
 	for(deque<BandedHMMP7::p7_state>::const_iterator it = path.begin(); it != path.end(); ++it)
 		os << BandedHMMP7::decode(*it);
@@ -468,6 +629,8 @@ BandedHMMP7& BandedHMMP7::build(const MSA& msa, double symfrac,
 		double w = msa.getSeqWeight(i);
 		int start = msa.seqStart(i);
 		int end = msa.seqEnd(i);
+		if(start < 0) /* all-gap seq, i.e. in a sliced MSA */
+			continue;
 		int8_t bStart = msa.encodeAt(i, start);
 		p7_state smStart = determineMatchingState(cs2ProfileIdx, start + 1, bStart);
 		Tmat[0](M, smStart) += w;
@@ -521,9 +684,9 @@ BandedHMMP7& BandedHMMP7::build(const MSA& msa, double symfrac,
 		int map = profile2CSIdx[k];
 		sprintf(value, "%d", map);
 		setLocOptTag("MAP", value, k);
-		char c = msa.CSBaseAt(map);
+		char c = msa.CSBaseAt(map - 1); /* MSA index is 0-based */
 		int8_t b = abc->encode(c);
-		if(msa.wIdentityAt(map) < CONS_THRESHOLD)
+		if(msa.wIdentityAt(map - 1) < CONS_THRESHOLD)
 			c = ::tolower(c);
 		setLocOptTag("CONS", string() + c, k);
 	}
@@ -579,6 +742,7 @@ void BandedHMMP7::setSequenceMode(enum align_mode mode) {
 	T_SP(N, B) = 1.0 - T_SP(N, N);
 	T_SP(E, C) = 1.0; // always exit from E->C
 	T_SP_cost = -T_SP.array().log(); // Eigen3 handle array to matrix assignment automatically
+	seqMode = mode;
 }
 
 void BandedHMMP7::setSpEmissionFreq(const Vector4d& freq) {
@@ -748,38 +912,13 @@ void BandedHMMP7::calcViterbiScores(const PrimarySeq& seq, ViterbiScores& vs) co
 	assert(seq.length() == vs.L);
 	assert(wingRetracted);
 
-	const int L = vs.L;
 	prepareViterbiScores(vs);
-
-	/* Full Dynamic-Programming at row-first order */
-	for (int j = 1; j <= K; ++j) {
-		for (int i = 1; i <= L; ++i) {
-			vs.DP_M(i, j) = E_M_cost(seq.encodeAt(i-1), j) + BandedHMMP7::min(
-					static_cast<double> (vs.DP_M(i, 0) + entryPr_cost(j)), // from the B state
-					static_cast<double> (vs.DP_M(i - 1, j - 1) + Tmat_cost[j-1](M, M)), // from Mi-1,j-1
-					static_cast<double> (vs.DP_I(i - 1, j - 1) + Tmat_cost[j-1](I, M)), // from Ii-1,j-1
-					static_cast<double> (vs.DP_D(i - 1, j - 1) + Tmat_cost[j-1](D, M))); // from Di-1,j-1
-			vs.DP_I(i, j) = E_I_cost(seq.encodeAt(i - 1), j) + std::min(
-							static_cast<double> (vs.DP_M(i - 1, j) + Tmat_cost[j](M, I)), // from Mi-1,j
-							static_cast<double> (vs.DP_I(i - 1, j) + Tmat_cost[j](I, I))); // from Ii-1,j
-			if(j > 1 && j < K) /* D1 and Dk are retracted */
-				vs.DP_D(i, j) = std::min(
-						static_cast<double> (vs.DP_M(i, j - 1) + Tmat_cost[j-1](M, D)), // from Mi,j-1
-						static_cast<double> (vs.DP_D(i, j - 1) + Tmat_cost[j-1](D, D))); // from Di,j-1
-		}
-	}
-	vs.S.leftCols(K + 1) = vs.DP_M; // 0..K columns copied from the calculated DP_M
-	vs.S.col(K + 1) = vs.DP_I.col(K);
-	// add M-E exit costs
-	vs.S.leftCols(K + 1).rowwise() += exitPr_cost.transpose();
-	vs.S.col(K + 1).array() += Tmat_cost[K](I, M); // IK->E
-	vs.S.array() += T_SP_cost(E, C); // add E->C transition
-	for (int i = 1; i < L; ++i) // S(L,) doesn't have a C-> loop
-		vs.S.row(i).array() += T_SP_cost(C, C) * (L - i); // add L-i C->C circles
+	/* Full Dynamic-Programming at column-first order */
+	calcViterbiBand(seq, vs, false, VectorXi(), VectorXi(), VectorXi());
 }
 
 void BandedHMMP7::calcViterbiScores(const PrimarySeq& seq,
-		ViterbiScores& vs, const vector<ViterbiAlignPath>& vpaths) const {
+		ViterbiScores& vs, const vector<ViterbiAlignPath>& vpaths, double gapFrac) const {
 	assert(seq.length() == vs.L);
 	assert(wingRetracted);
 
@@ -789,16 +928,25 @@ void BandedHMMP7::calcViterbiScores(const PrimarySeq& seq,
 
 	prepareViterbiScores(vs);
 
+	/* regular bands are calculated in one pass of the profile */
+	VectorXi bandFrom, bandTo, noEntryFrom;
+	if(getViterbiBand(L, vpaths, gapFrac, bandFrom, bandTo, noEntryFrom)) {
+		calcViterbiBand(seq, vs, true, bandFrom, bandTo, noEntryFrom);
+		return;
+	}
+
+	/* otherwise calculate the regions around each known path in order */
+
 	/* process each known path upstream and themselves */
 	for(vector<VPath>::const_iterator vpath = vpaths.begin(); vpath != vpaths.end(); ++vpath) {
 		/* Determine banded boundaries */
 		int upQLen = vpath == vpaths.begin() /* first path ? */ ? vpath->from - 1 : vpath->from - (vpath - 1)->to;
 		if(upQLen < 0)
 			upQLen = 0;
-		int up_start = vpath == vpaths.begin() /* first path ? */ ? vpath->start - upQLen * (1 + kMinGapFrac) : (vpath - 1)->end;
+		int up_start = vpath == vpaths.begin() /* first path ? */ ? vpath->start - upQLen * (1 + gapFrac) : (vpath - 1)->end;
 		if (up_start < 1)
 			up_start = 1;
-		int up_from = vpath == vpaths.begin() /* first path */ ? vpath->from - upQLen * (1 + kMinGapFrac) : (vpath - 1)->to;
+		int up_from = vpath == vpaths.begin() /* first path */ ? vpath->from - upQLen * (1 + gapFrac) : (vpath - 1)->to;
 		if (up_from < 1)
 			up_from = 1;
 //		cerr << "upQLen:" << upQLen << endl;
@@ -853,8 +1001,8 @@ void BandedHMMP7::calcViterbiScores(const PrimarySeq& seq,
 	int last_end = vpaths[vpaths.size() - 1].end;
 	int last_to = vpaths[vpaths.size() - 1].to;
 	int downQLen = L - last_to;
-	int down_end = last_end + downQLen * (1 + kMinGapFrac);
-	int down_to = last_to + downQLen * (1 + kMinGapFrac);
+	int down_end = last_end + downQLen * (1 + gapFrac);
+	int down_to = last_to + downQLen * (1 + gapFrac);
 	if(down_end > K)
 		down_end = K;
 	if(down_to > L)
@@ -879,15 +1027,213 @@ void BandedHMMP7::calcViterbiScores(const PrimarySeq& seq,
 		}
 	}
 //	cerr << "downstream done" << endl;
-	vs.S.leftCols(K + 1) = vs.DP_M;; // 0..K columns copied from the calculated DP_M
-	vs.S.col(K + 1) = vs.DP_I.col(K);
-	//vs.S.col(K + 1).setConstant(inf);
-	// add M-E exit costs
-	vs.S.leftCols(K + 1).rowwise() += exitPr_cost.transpose();
-	vs.S.col(K + 1).array() += Tmat_cost[K](I, M); // IK->E
-	vs.S.array() += T_SP_cost(E, C); // add E->C transition
-	for (int i = 1; i < L; ++i)
-		vs.S.row(i).array() += T_SP_cost(C, C) * (L - i); // add L-i C->C circles
+	calcExitScores(vs);
+}
+
+bool BandedHMMP7::getViterbiBand(int L, const vector<ViterbiAlignPath>& vpaths, double gapFrac,
+		VectorXi& bandFrom, VectorXi& bandTo, VectorXi& noEntryFrom) const {
+	bandFrom.setConstant(K + 1, L + 1);
+	bandTo.setZero(K + 1);
+	noEntryFrom.setConstant(K + 1, L + 1);
+
+	if(vpaths.empty()) { /* full DP */
+		bandFrom.tail(K).setOnes();
+		bandTo.tail(K).setConstant(L);
+		return true;
+	}
+
+	/* the regions are added in the same order of the banded calcViterbiScores,
+	 * a new region in a column must start at or right after the last row of previous regions */
+	for(vector<VPath>::const_iterator vpath = vpaths.begin(); vpath != vpaths.end(); ++vpath) {
+		int upQLen = vpath == vpaths.begin() /* first path ? */ ? vpath->from - 1 : vpath->from - (vpath - 1)->to;
+		if(upQLen < 0)
+			upQLen = 0;
+		int up_start = vpath == vpaths.begin() /* first path ? */ ? vpath->start - upQLen * (1 + gapFrac) : (vpath - 1)->end;
+		if (up_start < 1)
+			up_start = 1;
+		int up_from = vpath == vpaths.begin() /* first path */ ? vpath->from - upQLen * (1 + gapFrac) : (vpath - 1)->to;
+		if (up_from < 1)
+			up_from = 1;
+		for(int j = up_start; j <= vpath->start; ++j) {
+			if(up_from > vpath->from)
+				break;
+			if(bandFrom(j) <= bandTo(j) && (up_from < bandTo(j) || up_from > bandTo(j) + 1))
+				return false;
+			bandFrom(j) = std::min(bandFrom(j), up_from);
+			bandTo(j) = vpath->from;
+		}
+		for(int j = vpath->start; j <= vpath->end; ++j) {
+			int from = std::max(vpath->from, vpath->from + (j - vpath->start) - vpath->nDel);
+			int to = std::min(vpath->to, vpath->from + (j - vpath->start) + vpath->nIns);
+			if(from > to)
+				continue;
+			if(bandFrom(j) <= bandTo(j) && (from < bandTo(j) || from > bandTo(j) + 1))
+				return false;
+			bandFrom(j) = std::min(bandFrom(j), from);
+			bandTo(j) = to;
+		}
+	}
+
+	int last_end = vpaths[vpaths.size() - 1].end;
+	int last_to = vpaths[vpaths.size() - 1].to;
+	int downQLen = L - last_to;
+	int down_end = last_end + downQLen * (1 + gapFrac);
+	int down_to = last_to + downQLen * (1 + gapFrac);
+	if(down_end > K)
+		down_end = K;
+	if(down_to > L)
+		down_to = L;
+	for (int j = last_end; j <= down_end && last_to <= down_to; ++j) {
+		if(bandFrom(j) <= bandTo(j) && (last_to < bandTo(j) || last_to > bandTo(j) + 1))
+			return false;
+		bandFrom(j) = std::min(bandFrom(j), last_to);
+		bandTo(j) = down_to;
+		noEntryFrom(j) = last_to;
+	}
+	return true;
+}
+
+void BandedHMMP7::calcViterbiBand(const PrimarySeq& seq, ViterbiScores& vs, bool banded,
+		const VectorXi& bandFrom, const VectorXi& bandTo, const VectorXi& noEntryFrom) const {
+	switch(seqMode) {
+	case GLOBAL:
+		return banded ? viterbiKernel<GLOBAL, true>(seq, vs, bandFrom, bandTo, noEntryFrom)
+				: viterbiKernel<GLOBAL, false>(seq, vs, bandFrom, bandTo, noEntryFrom);
+	case LOCAL:
+		return banded ? viterbiKernel<LOCAL, true>(seq, vs, bandFrom, bandTo, noEntryFrom)
+				: viterbiKernel<LOCAL, false>(seq, vs, bandFrom, bandTo, noEntryFrom);
+	case NGCL:
+		return banded ? viterbiKernel<NGCL, true>(seq, vs, bandFrom, bandTo, noEntryFrom)
+				: viterbiKernel<NGCL, false>(seq, vs, bandFrom, bandTo, noEntryFrom);
+	case CGNL:
+		return banded ? viterbiKernel<CGNL, true>(seq, vs, bandFrom, bandTo, noEntryFrom)
+				: viterbiKernel<CGNL, false>(seq, vs, bandFrom, bandTo, noEntryFrom);
+	}
+}
+
+template<BandedHMMP7::align_mode MODE, bool BANDED>
+void BandedHMMP7::viterbiKernel(const PrimarySeq& seq, ViterbiScores& vs,
+		const VectorXi& bandFrom, const VectorXi& bandTo, const VectorXi& noEntryFrom) const {
+	const bool nLocal = MODE == LOCAL || MODE == CGNL; /* N->N loops allowed, so B can be entered at any row */
+	const bool cLocal = MODE == LOCAL || MODE == NGCL; /* C->C loops allowed, so E can be exited at any row */
+	const int L = vs.L;
+	const double EC = T_SP_cost(E, C);
+	const double CC = T_SP_cost(C, C);
+
+	vector<int8_t> code(L + 1); /* 1-based encoded seq */
+	for(int i = 1; i <= L; ++i)
+		code[i] = seq.encodeAt(i - 1);
+
+	int from = 1;
+	int to = L;
+	for(int j = 1; j <= K; ++j) {
+		if(BANDED) {
+			from = bandFrom(j);
+			to = bandTo(j);
+			if(from > to)
+				continue;
+		}
+		int entryTo = BANDED ? std::min(to, noEntryFrom(j) - 1) : to; /* last row that can enter from the B state */
+		if(!nLocal && entryTo > 1)
+			entryTo = 1; /* B is only reachable from row 1 without N->N loops */
+
+		/* D1 and Dk are retracted */
+		if(j > 1 && j < K)
+			viterbiColumn<true>(&code[0], vs, j, from, to, entryTo);
+		else
+			viterbiColumn<false>(&code[0], vs, j, from, to, entryTo);
+
+		/* fold in the M->E exit costs */
+		const double* Mc = &vs.DP_M(0, j);
+		const double exitCost = exitPr_cost(j);
+		if(cLocal) {
+			for(int i = from; i <= to; ++i) // S(L,) doesn't have a C-> loop, with L-i = 0
+				foldExitScore(vs, Mc[i] + exitCost + EC + CC * (L - i), i, j);
+		}
+		else if(to == L)
+			foldExitScore(vs, Mc[L] + exitCost + EC, L, j);
+	}
+
+	/* fold in the IK->E exit costs */
+	if(BANDED) {
+		from = bandFrom(K);
+		to = bandTo(K);
+	}
+	const double* Ic = &vs.DP_I(0, K);
+	const double exitCost = Tmat_cost[K](I, M);
+	if(cLocal) {
+		for(int i = from; i <= to; ++i)
+			foldExitScore(vs, Ic[i] + exitCost + EC + CC * (L - i), i, K + 1);
+	}
+	else if(from <= L && to == L)
+		foldExitScore(vs, Ic[L] + exitCost + EC, L, K + 1);
+}
+
+template<bool HAS_D>
+void BandedHMMP7::viterbiColumn(const int8_t* code, ViterbiScores& vs, int j, int from, int to, int entryTo) const {
+	const double* Bc = &vs.DP_M(0, 0); /* B state costs */
+	const double* Mp = &vs.DP_M(0, j - 1);
+	const double* Ip = &vs.DP_I(0, j - 1);
+	const double* Dp = &vs.DP_D(0, j - 1);
+	double* Mc = &vs.DP_M(0, j);
+	double* Ic = &vs.DP_I(0, j);
+	double* Dc = &vs.DP_D(0, j);
+	const double* eM = &E_M_cost(0, j);
+	const double* eI = &E_I_cost(0, j);
+	const double entry = entryPr_cost(j);
+	const double MM = Tmat_cost[j-1](M, M);
+	const double IM = Tmat_cost[j-1](I, M);
+	const double DM = Tmat_cost[j-1](D, M);
+	const double MD = Tmat_cost[j-1](M, D);
+	const double DD = Tmat_cost[j-1](D, D);
+	const double MI = Tmat_cost[j](M, I);
+	const double II = Tmat_cost[j](I, I);
+
+	int i = from;
+	for(; i <= to && i <= entryTo; ++i) {
+		Mc[i] = eM[code[i]] + BandedHMMP7::min(
+				Bc[i] + entry, // from the B state
+				Mp[i - 1] + MM, // from Mi-1,j-1
+				Ip[i - 1] + IM, // from Ii-1,j-1
+				Dp[i - 1] + DM); // from Di-1,j-1
+		Ic[i] = eI[code[i]] + std::min(
+				Mc[i - 1] + MI, // from Mi-1,j
+				Ic[i - 1] + II); // from Ii-1,j
+		if(HAS_D)
+			Dc[i] = std::min(
+					Mp[i] + MD, // from Mi,j-1
+					Dp[i] + DD); // from Di,j-1
+	}
+	for(; i <= to; ++i) {
+		Mc[i] = eM[code[i]] + BandedHMMP7::min(
+				Mp[i - 1] + MM, // from Mi-1,j-1
+				Ip[i - 1] + IM, // from Ii-1,j-1
+				Dp[i - 1] + DM); // from Di-1,j-1
+		Ic[i] = eI[code[i]] + std::min(
+				Mc[i - 1] + MI, // from Mi-1,j
+				Ic[i - 1] + II); // from Ii-1,j
+		if(HAS_D)
+			Dc[i] = std::min(
+					Mp[i] + MD, // from Mi,j-1
+					Dp[i] + DD); // from Di,j-1
+	}
+}
+
+void BandedHMMP7::calcExitScores(ViterbiScores& vs) const {
+	const int L = vs.L;
+	const double EC = T_SP_cost(E, C);
+	const double CC = T_SP_cost(C, C);
+	vs.minScore = inf;
+	vs.minRow = vs.minCol = 0;
+	for(int j = 1; j <= K + 1; ++j) {
+		for(int i = 1; i <= L; ++i) {
+			double cost = j <= K ? vs.DP_M(i, j) + exitPr_cost(j) /* M-E exit */ : vs.DP_I(i, K) + Tmat_cost[K](I, M) /* IK->E */;
+			cost += EC; // add E->C transition
+			if(i < L) // S(L,) doesn't have a C-> loop
+				cost += CC * (L - i); // add L-i C->C circles
+			foldExitScore(vs, cost, i, j);
+		}
+	}
 }
 
 BandedHMMP7::ViterbiAlignPath BandedHMMP7::buildAlignPath(const CSLoc& csLoc, int csFrom, int csTo) const {
@@ -940,8 +1286,9 @@ BandedHMMP7::ViterbiAlignPath BandedHMMP7::buildAlignPath(const CSLoc& csLoc, in
 }
 
 void BandedHMMP7::buildViterbiTrace(const ViterbiScores& vs, ViterbiAlignTrace& vtrace) const {
-	MatrixXd::Index minRow, minCol;
-	vtrace.minScore = vs.S.minCoeff(&minRow, &minCol);
+	const int minRow = vs.minRow;
+	const int minCol = vs.minCol;
+	vtrace.minScore = vs.minScore;
 	if(vtrace.minScore == inf)
 		return; // return an invalid VTrace
 
@@ -1211,6 +1558,44 @@ BandedHMMP7::HmmAlignment& BandedHMMP7::HmmAlignment::merge(const HmmAlignment&
 	return *this;
 }
 
+string BandedHMMP7::HmmAlignment::encodeAlign(const string& align) {
+	string code;
+	code.reserve(align.length());
+	char buf[32];
+	for(string::size_type i = 0; i < align.length(); ) {
+		const char c = align[i];
+		string::size_type j = i + 1;
+		if(c == BandedHMMP7::GAP_SYM || c == BandedHMMP7::PAD_SYM)
+			while(j < align.length() && align[j] == c)
+				j++;
+		if(j - i > MIN_ENCODE_RUN) {
+			::sprintf(buf, "%lu%c", static_cast<unsigned long> (j - i), c);
+			code += buf;
+		}
+		else
+			code.append(j - i, c);
+		i = j;
+	}
+	return code;
+}
+
+string& BandedHMMP7::HmmAlignment::decodeAlign(const char* begin, const char* end, string& align) {
+	align.clear();
+	for(const char* p = begin; p < end; ) {
+		if(::isdigit(*p)) {
+			char* q;
+			const unsigned long n = ::strtoul(p, &q, 10);
+			if(q == end)
+				throw std::invalid_argument("Missing symbol after run length in encoded alignment");
+			align.append(n, *q);
+			p = q + 1;
+		}
+		else
+			align.push_back(*p++);
+	}
+	return align;
+}
+
 ostream& operator<<(ostream& out, const BandedHMMP7::HmmAlignment& hmmAln) {
 	out << hmmAln.seqStart << "\t" << hmmAln.seqEnd << "\t" <<
 			hmmAln.hmmStart << "\t" << hmmAln.hmmEnd << "\t" <<
@@ -1224,6 +1609,8 @@ istream& operator>>(istream& in, BandedHMMP7::HmmAlignment& hmmAln) {
 	hmmAln.hmmStart >> hmmAln.hmmEnd >>
 	hmmAln.csStart >> hmmAln.csEnd >>
 	hmmAln.cost >> hmmAln.align;
+	if(hmmAln.align.find_first_of("0123456789") != string::npos) /* an encoded aligned seq */
+		hmmAln.align = BandedHMMP7::HmmAlignment::decodeAlign(hmmAln.align);
 	return in;
 }
 
@@ -109,11 +109,29 @@ public:
 		 */
 		static HmmAlignment merge(const HmmAlignment& aln1, const HmmAlignment& aln2);
 
+		/**
+		 * Encode an aligned seq compactly, by writing each run of more than MIN_ENCODE_RUN GAP_SYM or PAD_SYM
+		 * as its length followed by the symbol, i.e. the N'/C' padding outside the CS region becomes a few characters
+		 */
+		static string encodeAlign(const string& align);
+
+		/**
+		 * Decode an aligned seq in [begin, end) into align, which is either encoded by encodeAlign or a plain aligned seq
+		 * @return  the decoded seq
+		 */
+		static string& decodeAlign(const char* begin, const char* end, string& align);
+
+		/** Decode an aligned seq, which is either encoded by encodeAlign or a plain aligned seq */
+		static string decodeAlign(const string& code) {
+			string align;
+			return decodeAlign(code.c_str(), code.c_str() + code.length(), align);
+		}
+
 		/* non-member friend functions */
 		/** write to a text output */
 		friend ostream& operator<<(ostream& out, const HmmAlignment& hmmAln);
 
-		/** read from a text input */
+		/** read from a text input, the aligned seq can be either plain or encoded by encodeAlign */
 		friend istream& operator>>(istream& in, HmmAlignment& hmmAln);
 
 		/* member fields */
@@ -127,6 +145,7 @@ public:
 
 		/* static fields */
 		static const string TSV_HEADER;
+		static const int MIN_ENCODE_RUN = 2; /* shorter runs of gaps/paddings are not encoded */
 	};
 
 	/* constructors */
@@ -205,7 +224,8 @@ public:
 							to the profile submodel up to the ending in xi being emitted by Ij */
 		MatrixXd DP_D;  /* (L+1) * (K+1) cost matrix of the best path ending in Dj, and xi being the last character emitted before Dj).*/
 
-		MatrixXd S;     /* (L+1) * (K+2) score matrix storing the whole ViterbiScores with the last column the cost exiting from Dk status */
+		double minScore; /* minimum cost exiting the profile, with the exit and C->C loop costs added */
+		int minRow, minCol; /* cell of minScore, with minCol = K + 1 for exiting from IK */
 
 		/* member methods */
 		void reset(int L) {
@@ -218,12 +238,12 @@ public:
 			DP_M.resize(L + 1, K + 1);
 			DP_I.resize(L + 1, K + 1);
 			DP_D.resize(L + 1, K + 1);
-			S.resize(L + 1, K + 2);
 
 			DP_M.setConstant(inf);
 			DP_I.setConstant(inf);
 			DP_D.setConstant(inf);
-			S.setConstant(inf);
+			minScore = inf;
+			minRow = minCol = 0;
 		}
 	};
 
@@ -277,6 +297,7 @@ public:
 	static const string HMM_TAG;
 	static const int kMaxProfile = UINT16_MAX + 1;
 	static const int kMaxCS = UINT16_MAX + 1;
+	static const size_t kMaxOptTag = 1024; // maximum number of optional tags in a binary profile
 	static const double kMinGapFrac; // minimum gap fraction comparing to the profile
 	static const double CONS_THRESHOLD; // threshold for print upper-case consensus residues
 	static const double DEFAULT_ERE; // target mean average relative entropy of the model
@@ -445,9 +466,11 @@ public:
 
 	/**
 	 * Calculate banded Viterbi DP scores w/ a given known "seed" alignment region
+	 * @param gapFrac  gap fraction used to extend the band up- and downstream of the known paths
 	 * @return a vector of size L giving the final Viterbi lods of the End state
 	 */
-	void calcViterbiScores(const PrimarySeq& seq, ViterbiScores& vs, const vector<ViterbiAlignPath>& vpaths) const;
+	void calcViterbiScores(const PrimarySeq& seq, ViterbiScores& vs, const vector<ViterbiAlignPath>& vpaths,
+			double gapFrac = kMinGapFrac) const;
 
 	/**
 	 * build the ViterbiTrace matrix, using the B, M, I, D as indicator flags
@@ -494,6 +517,17 @@ public:
 	 */
 	void normalize();
 
+	/**
+	 * save this profile to a binary output, with all probability and cost matrices
+	 * stored as is, so no parsing or re-computing is needed when loading
+	 */
+	ostream& save(ostream& out) const;
+
+	/**
+	 * load a profile from a binary input, override any old data
+	 */
+	istream& load(istream& in);
+
 private:
 	/* core fields */
 	int K; // profile length
@@ -562,6 +596,7 @@ private:
 	map<string, vector<string> > locOptTags; // other profile loc-specific optional tags in the match emission line
 
 	bool wingRetracted;
+	align_mode seqMode; // sequence align mode set by setSequenceMode
 
 	/**
 	 * Initialize profile transition matrices,
@@ -649,6 +684,59 @@ private:
 	 */
 	double meanRelativeEntropy() const;
 
+	/**
+	 * Get the cells of the banded Viterbi DP as one row range per profile column,
+	 * giving the same cells and B state entries as the banded calcViterbiScores
+	 * @param L  seq length
+	 * @param vpaths  known paths, or empty for the full DP
+	 * @param bandFrom  first row of each column
+	 * @param bandTo  last row of each column, smaller than bandFrom if no cells
+	 * @param noEntryFrom  first row of each column that can not be entered from the B state
+	 * @return  false if the bands of the known paths can't be represented as a row range per column
+	 */
+	bool getViterbiBand(int L, const vector<ViterbiAlignPath>& vpaths, double gapFrac,
+			VectorXi& bandFrom, VectorXi& bandTo, VectorXi& noEntryFrom) const;
+
+	/**
+	 * Calculate Viterbi DP scores in one pass of the profile columns,
+	 * with the exit costs folded into the minimum exit score of the VScore
+	 * @param banded  whether to use the given bands, or the full DP otherwise
+	 */
+	void calcViterbiBand(const PrimarySeq& seq, ViterbiScores& vs, bool banded,
+			const VectorXi& bandFrom, const VectorXi& bandTo, const VectorXi& noEntryFrom) const;
+
+	/**
+	 * Viterbi DP kernel specialized for the sequence align mode, and whether to use the bands
+	 */
+	template<align_mode MODE, bool BANDED>
+	void viterbiKernel(const PrimarySeq& seq, ViterbiScores& vs,
+			const VectorXi& bandFrom, const VectorXi& bandTo, const VectorXi& noEntryFrom) const;
+
+	/**
+	 * Calculate rows from..to of column j, with rows upto entryTo entering from the B state
+	 * @param code  encoded seq, 1-based
+	 */
+	template<bool HAS_D>
+	void viterbiColumn(const int8_t* code, ViterbiScores& vs, int j, int from, int to, int entryTo) const;
+
+	/**
+	 * Fold the exit costs of all calculated cells into the minimum exit score of a VScore,
+	 * used when the cells are not calculated in the column order
+	 */
+	void calcExitScores(ViterbiScores& vs) const;
+
+	/**
+	 * Fold the exit cost of a cell into the minimum exit score of a VScore,
+	 * cells must be folded in the column order so the first minimum is kept
+	 */
+	static void foldExitScore(ViterbiScores& vs, double cost, int i, int j) {
+		if(cost < vs.minScore) {
+			vs.minScore = cost;
+			vs.minRow = i;
+			vs.minCol = j;
+		}
+	}
+
 	/**
 	 * Re-estimate the parameters using the given prior and current observed frequencies
 	 * (usually unnormalzied due to previous call of scale(double)
@@ -28,6 +28,7 @@
 #include <stdint.h>
 #include <cctype>
 #include <cstdlib>
+#include <boost/random/uniform_int_distribution.hpp>
 #include "CSFMIndex.h"
 #include "HmmUFOtuConst.h"
 #include "BitSequenceBuilder.h"
@@ -118,7 +119,7 @@ CSLoc CSFMIndex::locateFirst(const string& pattern) const {
 		return CSLoc();
 }
 
-CSLoc CSFMIndex::locateOne(const string& pattern) const {
+CSLoc CSFMIndex::locateOne(const string& pattern, RNG& rng) const {
 	if(pattern.empty())
 		return CSLoc(); /* empty pattern matches to nothing */
     int32_t start = 0;
@@ -136,7 +137,7 @@ CSLoc CSFMIndex::locateOne(const string& pattern) const {
         }
     }
     if(start <= end) {
-    	int32_t i = start + rand() % (end - start + 1);
+    	int32_t i = boost::random::uniform_int_distribution<int32_t>(start, end)(rng);
     	uint32_t concatStart = accessSA(i); // random 1-based position
     	int32_t csStart = concat2CS[concatStart];
     	int32_t csEnd = concat2CS[concatStart + pattern.length() - 1];
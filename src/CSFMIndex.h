@@ -31,6 +31,7 @@
 #include <fstream>
 #include <set>
 #include <algorithm>
+#include <boost/random/mersenne_twister.hpp>
 #include "MSA.h"
 #include "CSLoc.h"
 #include "divsufsort.h"
@@ -50,6 +51,8 @@ using std::ostream;
  */
 class CSFMIndex {
 public:
+	typedef boost::random::mt11213b RNG; /* random number generator type used for locating a random hit */
+
 	/* constructors */
 	/** Default constructor, zero-initiate all members */
 	CSFMIndex() : abc(NULL), gapCh('\0'), csLen(0),
@@ -112,9 +115,10 @@ public:
 	/**
 	 * Locate the consensus sequence positions of given pattern
 	 * @param pattern  the un-coded pattern
+	 * @param rng  random number generator used to pick one of the hits
 	 * @return  a random CS position
 	 */
-	CSLoc locateOne(const string& pattern) const;
+	CSLoc locateOne(const string& pattern, RNG& rng) const;
 
 	/**
 	 * Locate the consensus sequence positions of given pattern
@@ -47,13 +47,20 @@ const double nan = std::numeric_limits<double>::quiet_NaN();
 const string MSA_FILE_SUFFIX = ".msa";
 const string CSFM_FILE_SUFFIX = ".csfm";
 const string HMM_FILE_SUFFIX = ".hmm";
+const string HMM_BIN_FILE_SUFFIX = ".hmmb";
 const string SUB_MODEL_FILE_SUFFIX = ".sm";
 const string PHYLOTREE_FILE_SUFFIX = ".ptu";
 const string JPLACE_FILE_SUFFIX = ".jplace";
+const string DB_FILE_SUFFIX = ".hudb";
+const string ASSIGN_BIN_FILE_SUFFIX = ".hua";
 
 const string GZIP_FILE_SUFFIX = ".gz";
 const string BZIP2_FILE_SUFFIX = ".bz2";
 
+/* HMM header tags recording the origin of a sliced database */
+const string HMM_CS_OFFSET_TAG = "CSOFFSET";
+const string HMM_CS_SRCLEN_TAG = "CSSRCLEN";
+
 const int MAX_NAME_LENGTH = 4096;
 
 } /* namespace HmmUFOtu */
@@ -0,0 +1,319 @@
+/*******************************************************************************
+ * This file is part of HmmUFOtu, an HMM and Phylogenetic placement
+ * based tool for Ultra-fast taxonomy assignment and OTU organization
+ * of microbiome sequencing data with species level accuracy.
+ * Copyright (C) 2017  Qi Zheng
+ *
+ * HmmUFOtu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HmmUFOtu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with AlignerBoost.  If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+/*
+ * HmmUFOtuDB.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: zhengqi
+ */
+
+#include <fstream>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <sys/stat.h>
+#include <boost/iostreams/stream.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include "HmmUFOtuDB.h"
+#include "ProgLog.h"
+
+namespace EGriceLab {
+namespace HmmUFOtu {
+
+using namespace std;
+
+const char HmmUFOtuDB::DB_MAGIC[8] = { 'H', 'm', 'm', 'U', 'F', 'O', 't', 'u' };
+const uint32_t HmmUFOtuDB::DB_FORMAT_VERSION;
+const uint64_t HmmUFOtuDB::SECTION_ALIGN;
+const size_t HmmUFOtuDB::SECTION_NAME_LENGTH;
+const string HmmUFOtuDB::DB_SECTIONS[] = {
+		MSA_FILE_SUFFIX, CSFM_FILE_SUFFIX, HMM_FILE_SUFFIX, HMM_BIN_FILE_SUFFIX, PHYLOTREE_FILE_SUFFIX
+};
+const size_t HmmUFOtuDB::NUM_DB_SECTIONS = sizeof(DB_SECTIONS) / sizeof(DB_SECTIONS[0]);
+
+/** lookup table of the reflected CRC-32 polynomial, built once at startup */
+static const struct CRC32Table {
+	CRC32Table() {
+		for(uint32_t i = 0; i < 256; ++i) {
+			uint32_t c = i;
+			for(int k = 0; k < 8; ++k)
+				c = c & 1 ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+			v[i] = c;
+		}
+	}
+
+	uint32_t v[256];
+} CRC32_TABLE;
+
+/** length of the packed header with n sections, including the header checksum */
+static uint64_t headerLength(uint32_t n) {
+	return sizeof(HmmUFOtuDB::DB_MAGIC) + 2 * sizeof(uint32_t)
+			+ n * (HmmUFOtuDB::SECTION_NAME_LENGTH + 2 * sizeof(uint64_t) + sizeof(uint32_t))
+			+ sizeof(uint32_t);
+}
+
+/** round x up to the section alignment */
+static uint64_t alignUp(uint64_t x) {
+	return (x + HmmUFOtuDB::SECTION_ALIGN - 1) / HmmUFOtuDB::SECTION_ALIGN * HmmUFOtuDB::SECTION_ALIGN;
+}
+
+bool HmmUFOtuDB::open(const string& dbName, bool verify) {
+	close();
+	this->dbName = dbName;
+	this->verify = verify;
+	string fn = dbName + DB_FILE_SUFFIX;
+	struct stat dbStat;
+	if(::stat(fn.c_str(), &dbStat) != 0) { /* legacy layout */
+		debugLog << "Opening database '" << dbName << "' in the legacy layout" << endl;
+		return true;
+	}
+
+	/* the packed file is preferred, but it may be stale if the legacy files are rebuilt after packing */
+	bool hasLegacy = false;
+	for(size_t i = 0; i < NUM_DB_SECTIONS; ++i) {
+		const string legacyFn = dbName + DB_SECTIONS[i];
+		struct stat legacyStat;
+		if(::stat(legacyFn.c_str(), &legacyStat) != 0)
+			continue;
+		hasLegacy = true;
+		if(legacyStat.st_mtime > dbStat.st_mtime)
+			warningLog << "Legacy file '" << legacyFn << "' is newer than the packed database file '" << fn
+			<< "', re-run hmmufotu-pack to update it" << endl;
+	}
+	if(hasLegacy)
+		infoLog << "Both packed and legacy files found for database '" << dbName << "', opening '" << fn << "'" << endl;
+	else
+		debugLog << "Opening packed database file '" << fn << "'" << endl;
+
+	try {
+		file.open(fn);
+	}
+	catch(const std::ios_base::failure& e) {
+		errorLog << "Unable to map database file '" << fn << "': " << e.what() << endl;
+		return false;
+	}
+	packed = true;
+	return loadHeader();
+}
+
+void HmmUFOtuDB::close() {
+	for(vector<istream*>::iterator in = streams.begin(); in != streams.end(); ++in)
+		delete *in;
+	streams.clear();
+	sections.clear();
+	if(file.is_open())
+		file.close();
+	packed = false;
+}
+
+bool HmmUFOtuDB::loadHeader() {
+	const string fn = dbName + DB_FILE_SUFFIX;
+	const char* data = file.data();
+	const uint64_t fileSize = file.size();
+	if(fileSize < headerLength(0) || std::memcmp(data, DB_MAGIC, sizeof(DB_MAGIC)) != 0) {
+		errorLog << "'" << fn << "' is not a valid HmmUFOtu database file" << endl;
+		return false;
+	}
+	const char* p = data + sizeof(DB_MAGIC);
+	uint32_t version, nSec;
+	std::memcpy(&version, p, sizeof(uint32_t));
+	p += sizeof(uint32_t);
+	std::memcpy(&nSec, p, sizeof(uint32_t));
+	p += sizeof(uint32_t);
+	if(version != DB_FORMAT_VERSION) {
+		errorLog << "Unsupported database format version " << version << " of '" << fn << "', expecting " << DB_FORMAT_VERSION << endl;
+		return false;
+	}
+	if(fileSize < headerLength(nSec)) {
+		errorLog << "Truncated database file '" << fn << "'" << endl;
+		return false;
+	}
+
+	/* verify header before trusting the section table */
+	uint32_t hCrc;
+	const uint64_t hLen = headerLength(nSec) - sizeof(uint32_t);
+	std::memcpy(&hCrc, data + hLen, sizeof(uint32_t));
+	if(crc32(data, hLen) != hCrc) {
+		errorLog << "Corrupted header of database file '" << fn << "'" << endl;
+		return false;
+	}
+
+	for(uint32_t i = 0; i < nSec; ++i) {
+		Section sec;
+		sec.name.assign(p, ::strnlen(p, SECTION_NAME_LENGTH));
+		p += SECTION_NAME_LENGTH;
+		std::memcpy(&sec.offset, p, sizeof(uint64_t));
+		p += sizeof(uint64_t);
+		std::memcpy(&sec.size, p, sizeof(uint64_t));
+		p += sizeof(uint64_t);
+		std::memcpy(&sec.crc, p, sizeof(uint32_t));
+		p += sizeof(uint32_t);
+		if(sec.offset > fileSize || sec.size > fileSize - sec.offset) {
+			errorLog << "Section '" << sec.name << "' is out of range in database file '" << fn << "'" << endl;
+			return false;
+		}
+		sections.push_back(sec);
+	}
+
+	return true;
+}
+
+const HmmUFOtuDB::Section* HmmUFOtuDB::findSection(const string& suffix) const {
+	for(vector<Section>::const_iterator sec = sections.begin(); sec != sections.end(); ++sec)
+		if(sec->name == suffix)
+			return &*sec;
+	return NULL;
+}
+
+bool HmmUFOtuDB::hasSection(const string& suffix) const {
+	if(packed)
+		return findSection(suffix) != NULL;
+	else
+		return ifstream((dbName + suffix).c_str()).good();
+}
+
+istream& HmmUFOtuDB::openSection(const string& suffix) {
+	istream* in = NULL;
+	if(packed) {
+		const Section* sec = findSection(suffix);
+		if(sec == NULL) {
+			errorLog << "Section '" << suffix << "' not found in database file '" << dbName + DB_FILE_SUFFIX << "'" << endl;
+			errno = ENOENT;
+		}
+		else if(verify && crc32(file.data() + sec->offset, sec->size) != sec->crc) {
+			errorLog << "Checksum mismatch of section '" << suffix << "' in database file '" << dbName + DB_FILE_SUFFIX << "'" << endl;
+			errno = EIO;
+		}
+		else
+			in = new boost::iostreams::stream<boost::iostreams::array_source>(file.data() + sec->offset, sec->size);
+	}
+	else {
+		try {
+			in = new boost::iostreams::stream<boost::iostreams::mapped_file_source>(
+					boost::iostreams::mapped_file_source(dbName + suffix));
+		}
+		catch(const std::ios_base::failure& e) {
+			in = NULL;
+		}
+	}
+
+	if(in == NULL)
+		in = new istream(NULL); /* always failed */
+	streams.push_back(in);
+	return *in;
+}
+
+bool HmmUFOtuDB::getChecksum(const string& suffix, Checksum& sum) const {
+	if(packed) {
+		const Section* sec = findSection(suffix);
+		if(sec == NULL)
+			return false;
+		sum = Checksum(sec->size, sec->crc);
+		return true;
+	}
+
+	try {
+		boost::iostreams::mapped_file_source src(dbName + suffix);
+		sum = checksum(src.data(), src.size());
+	}
+	catch(const std::ios_base::failure& e) {
+		return false;
+	}
+	return true;
+}
+
+ostream& HmmUFOtuDB::pack(const string& dbName, ostream& out) {
+	vector<boost::iostreams::mapped_file_source> files;
+	vector<Section> secs;
+	for(size_t i = 0; i < NUM_DB_SECTIONS; ++i) {
+		const string& suffix = DB_SECTIONS[i];
+		const string fn = dbName + suffix;
+		if(suffix == HMM_BIN_FILE_SUFFIX && !ifstream(fn.c_str()).good()) /* compiled HMM is optional */
+			continue;
+		try {
+			files.push_back(boost::iostreams::mapped_file_source(fn));
+		}
+		catch(const std::ios_base::failure& e) {
+			errorLog << "Unable to map database file '" << fn << "': " << e.what() << endl;
+			out.setstate(std::ios_base::badbit);
+			return out;
+		}
+		const boost::iostreams::mapped_file_source& src = files.back();
+		secs.push_back(Section(suffix, 0, src.size(), crc32(src.data(), src.size())));
+	}
+
+	/* determine aligned section offsets */
+	uint64_t offset = headerLength(secs.size());
+	for(vector<Section>::iterator sec = secs.begin(); sec != secs.end(); ++sec) {
+		sec->offset = alignUp(offset);
+		offset = sec->offset + sec->size;
+	}
+
+	/* write header */
+	string header(DB_MAGIC, sizeof(DB_MAGIC));
+	uint32_t version = DB_FORMAT_VERSION;
+	uint32_t nSec = secs.size();
+	header.append((const char*) &version, sizeof(uint32_t));
+	header.append((const char*) &nSec, sizeof(uint32_t));
+	for(vector<Section>::const_iterator sec = secs.begin(); sec != secs.end(); ++sec) {
+		char name[SECTION_NAME_LENGTH] = { 0 };
+		sec->name.copy(name, SECTION_NAME_LENGTH);
+		header.append(name, SECTION_NAME_LENGTH);
+		header.append((const char*) &sec->offset, sizeof(uint64_t));
+		header.append((const char*) &sec->size, sizeof(uint64_t));
+		header.append((const char*) &sec->crc, sizeof(uint32_t));
+	}
+	uint32_t hCrc = crc32(header.data(), header.length());
+	header.append((const char*) &hCrc, sizeof(uint32_t));
+	out.write(header.data(), header.length());
+
+	/* write sections with zero padding */
+	offset = header.length();
+	const string pad(SECTION_ALIGN, '\0');
+	for(size_t i = 0; i < secs.size(); ++i) {
+		out.write(pad.data(), secs[i].offset - offset);
+		out.write(files[i].data(), secs[i].size);
+		offset = secs[i].offset + secs[i].size;
+	}
+
+	return out;
+}
+
+ostream& HmmUFOtuDB::Checksum::save(ostream& out) const {
+	out.write((const char*) &size, sizeof(uint64_t));
+	out.write((const char*) &crc, sizeof(uint32_t));
+	return out;
+}
+
+istream& HmmUFOtuDB::Checksum::load(istream& in) {
+	in.read((char*) &size, sizeof(uint64_t));
+	in.read((char*) &crc, sizeof(uint32_t));
+	return in;
+}
+
+uint32_t HmmUFOtuDB::crc32(const char* buf, size_t len, uint32_t crc) {
+	crc = ~crc;
+	for(size_t i = 0; i < len; ++i)
+		crc = CRC32_TABLE.v[(crc ^ static_cast<uint8_t>(buf[i])) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+} /* namespace HmmUFOtu */
+} /* namespace EGriceLab */
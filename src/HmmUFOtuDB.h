@@ -0,0 +1,210 @@
+/*******************************************************************************
+ * This file is part of HmmUFOtu, an HMM and Phylogenetic placement
+ * based tool for Ultra-fast taxonomy assignment and OTU organization
+ * of microbiome sequencing data with species level accuracy.
+ * Copyright (C) 2017  Qi Zheng
+ *
+ * HmmUFOtu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HmmUFOtu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with AlignerBoost.  If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+/*
+ * HmmUFOtuDB.h
+ * A single-file, memory-mapped HmmUFOtu database container
+ *  Created on: Oct 19, 2026
+ *      Author: zhengqi
+ */
+
+#ifndef SRC_HMMUFOTUDB_H_
+#define SRC_HMMUFOTUDB_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <stdint.h> /* for fixed size integers */
+#include <boost/iostreams/device/mapped_file.hpp>
+#include "HmmUFOtuConst.h"
+
+namespace EGriceLab {
+namespace HmmUFOtu {
+
+using std::string;
+using std::vector;
+using std::map;
+using std::istream;
+using std::ostream;
+
+/**
+ * An HmmUFOtu database opened for reading
+ * A packed database is a single DBNAME.hudb file with a section table and one page-aligned section per database file,
+ * each with its own CRC-32 checksum, which is verified on request.
+ * The whole file is memory-mapped once, so concurrent jobs share the page cache,
+ * and each section is read directly from the mapped pages.
+ * A database in the legacy layout (one file per section) is opened transparently, with each file mapped on request.
+ */
+class HmmUFOtuDB {
+public:
+	/** constructors */
+	/** Default constructor */
+	HmmUFOtuDB() : packed(false), verify(false) {  }
+
+	/** Destructor, close all section streams and the mapped file */
+	virtual ~HmmUFOtuDB() {
+		close();
+	}
+
+private:
+	/** disable copy and assignment */
+	HmmUFOtuDB(const HmmUFOtuDB& other);
+	HmmUFOtuDB& operator=(const HmmUFOtuDB& other);
+
+public:
+	/** section table entry */
+	struct Section {
+		Section() : offset(0), size(0), crc(0) {  }
+
+		Section(const string& name, uint64_t offset, uint64_t size, uint32_t crc)
+		: name(name), offset(offset), size(size), crc(crc)
+		{  }
+
+		string name;
+		uint64_t offset;
+		uint64_t size;
+		uint32_t crc;
+	};
+
+	/** size and CRC-32 checksum of a section, used to tell whether a derived section is built from it */
+	struct Checksum {
+		Checksum() : size(0), crc(0) {  }
+
+		Checksum(uint64_t size, uint32_t crc) : size(size), crc(crc) {  }
+
+		/** save this checksum to a binary output */
+		ostream& save(ostream& out) const;
+
+		/** load a checksum from a binary input */
+		istream& load(istream& in);
+
+		bool operator==(const Checksum& other) const {
+			return size == other.size && crc == other.crc;
+		}
+
+		bool operator!=(const Checksum& other) const {
+			return !(*this == other);
+		}
+
+		uint64_t size;
+		uint32_t crc;
+	};
+
+	/** member methods */
+	/**
+	 * Open a database by name, using the packed DBNAME.hudb file if it exists, or the legacy files otherwise
+	 * @param verify  verify the checksum of each packed section when it is opened
+	 * @return  true if the database is opened and, if packed, its header and section table are valid
+	 */
+	bool open(const string& dbName, bool verify = false);
+
+	/** close this database */
+	void close();
+
+	/** test whether this database is opened from a packed file */
+	bool isPacked() const {
+		return packed;
+	}
+
+	/** get the name of this database */
+	const string& getName() const {
+		return dbName;
+	}
+
+	/** get the section table of a packed database */
+	const vector<Section>& getSections() const {
+		return sections;
+	}
+
+	/**
+	 * test whether a section exists
+	 * @param suffix  section name, which is also its legacy file suffix, i.e. MSA_FILE_SUFFIX
+	 */
+	bool hasSection(const string& suffix) const;
+
+	/**
+	 * get the file or section name for a section, for messages
+	 */
+	string sectionFn(const string& suffix) const {
+		return packed ? dbName + DB_FILE_SUFFIX + ":" + suffix : dbName + suffix;
+	}
+
+	/**
+	 * Open a read-only stream of a given section, owned by this database and valid until close
+	 * the checksum of a packed section is verified first if this database is opened with verify
+	 * @param suffix  section name, which is also its legacy file suffix, i.e. MSA_FILE_SUFFIX
+	 * @return  the section stream, in a fail state if the section is missing, unreadable or corrupted
+	 */
+	istream& openSection(const string& suffix);
+
+	/**
+	 * Get the checksum of a given section, read from the section table of a packed database,
+	 * or calculated from the legacy file otherwise
+	 * @return  true if the section exists and is readable
+	 */
+	bool getChecksum(const string& suffix, Checksum& sum) const;
+
+	/** non-member functions */
+	/**
+	 * Pack a database of the legacy layout into a single file
+	 * @param dbName  database name of the legacy files
+	 * @param out  output of the packed database
+	 * @return  the output, in a bad state on any failures
+	 */
+	static ostream& pack(const string& dbName, ostream& out);
+
+	/**
+	 * calculate the CRC-32 (IEEE 802.3) checksum of a buffer
+	 * @param crc  checksum of preceding data, for incremental use
+	 */
+	static uint32_t crc32(const char* buf, size_t len, uint32_t crc = 0);
+
+	/** get the checksum of a buffer */
+	static Checksum checksum(const char* buf, size_t len) {
+		return Checksum(len, crc32(buf, len));
+	}
+
+private:
+	/** load and check the packed header and section table */
+	bool loadHeader();
+
+	/** find a packed section by name, or NULL if not exists */
+	const Section* findSection(const string& suffix) const;
+
+	string dbName;
+	bool packed;
+	bool verify; /* verify section checksums on open */
+	boost::iostreams::mapped_file_source file; /* the mapped packed file */
+	vector<Section> sections; /* packed section table */
+	vector<istream*> streams; /* opened section streams */
+
+public:
+	static const char DB_MAGIC[8];
+	static const uint32_t DB_FORMAT_VERSION = 1;
+	static const uint64_t SECTION_ALIGN = 4096; /* align sections to memory pages */
+	static const size_t SECTION_NAME_LENGTH = 16;
+	static const string DB_SECTIONS[]; /* all known sections, in packing order */
+	static const size_t NUM_DB_SECTIONS;
+};
+
+} /* namespace HmmUFOtu */
+} /* namespace EGriceLab */
+
+#endif /* SRC_HMMUFOTUDB_H_ */
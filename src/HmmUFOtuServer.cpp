@@ -0,0 +1,138 @@
+/*******************************************************************************
+ * This file is part of HmmUFOtu, an HMM and Phylogenetic placement
+ * based tool for Ultra-fast taxonomy assignment and OTU organization
+ * of microbiome sequencing data with species level accuracy.
+ * Copyright (C) 2017  Qi Zheng
+ *
+ * HmmUFOtu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HmmUFOtu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with AlignerBoost.  If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+/*
+ * HmmUFOtuServer.cpp
+ *  Created on: Oct 19, 2026
+ *      Author: zhengqi
+ */
+
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "HmmUFOtuServer.h"
+
+namespace EGriceLab {
+namespace HmmUFOtu {
+
+ostream& writeBlock(ostream& out, const string& name, const string& data) {
+	out << name << ' ' << data.length() << '\n';
+	out.write(data.c_str(), data.length());
+	out << '\n';
+	return out;
+}
+
+ostream& writeEndBlock(ostream& out) {
+	writeBlock(out, END_BLOCK, "");
+	out.flush();
+	return out;
+}
+
+istream& readBlock(istream& in, string& name, string& data) {
+	size_t size = 0;
+	if(!(in >> name >> size) || in.get() != '\n') {
+		in.setstate(std::ios_base::failbit);
+		return in;
+	}
+	data.resize(size);
+	if(size > 0)
+		in.read(&data[0], size);
+	if(in.get() != '\n')
+		in.setstate(std::ios_base::failbit);
+	return in;
+}
+
+string joinArgs(const vector<string>& args) {
+	string data;
+	for(vector<string>::const_iterator arg = args.begin(); arg != args.end(); ++arg) {
+		if(arg != args.begin())
+			data.push_back('\0');
+		data += *arg;
+	}
+	return data;
+}
+
+vector<string> splitArgs(const string& data) {
+	vector<string> args;
+	string::size_type start = 0;
+	for(string::size_type i = 0; i <= data.length(); ++i) {
+		if(i == data.length() || data[i] == '\0') {
+			args.push_back(data.substr(start, i - start));
+			start = i + 1;
+		}
+	}
+	return args;
+}
+
+/** fill a Unix socket address, return false if the path is too long */
+static bool setSocketAddr(const string& path, struct sockaddr_un& addr) {
+	if(path.length() >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		return false;
+	}
+	::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+	return true;
+}
+
+int listenSocket(const string& path) {
+	struct sockaddr_un addr;
+	if(!setSocketAddr(path, addr))
+		return -1;
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0)
+		return -1;
+	if(::bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+		int err = errno;
+		::close(fd);
+		errno = err;
+		return -1;
+	}
+	return fd;
+}
+
+int acceptSocket(int fd) {
+	int connFd;
+	do {
+		connFd = ::accept(fd, NULL, NULL);
+	} while(connFd < 0 && errno == EINTR);
+	return connFd;
+}
+
+int connectSocket(const string& path) {
+	struct sockaddr_un addr;
+	if(!setSocketAddr(path, addr))
+		return -1;
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0)
+		return -1;
+	if(::connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+		int err = errno;
+		::close(fd);
+		errno = err;
+		return -1;
+	}
+	return fd;
+}
+
+} /* namespace HmmUFOtu */
+} /* namespace EGriceLab */
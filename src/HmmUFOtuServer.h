@@ -0,0 +1,98 @@
+/*******************************************************************************
+ * This file is part of HmmUFOtu, an HMM and Phylogenetic placement
+ * based tool for Ultra-fast taxonomy assignment and OTU organization
+ * of microbiome sequencing data with species level accuracy.
+ * Copyright (C) 2017  Qi Zheng
+ *
+ * HmmUFOtu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HmmUFOtu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with AlignerBoost.  If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+/*
+ * HmmUFOtuServer.h
+ * Message framing and local sockets used by the hmmufotu server mode and hmmufotu-client
+ *  Created on: Oct 19, 2026
+ *      Author: zhengqi
+ */
+
+#ifndef SRC_HMMUFOTUSERVER_H_
+#define SRC_HMMUFOTUSERVER_H_
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+namespace EGriceLab {
+namespace HmmUFOtu {
+
+using std::string;
+using std::vector;
+using std::istream;
+using std::ostream;
+
+/**
+ * A request or response is a series of named blocks, each as a '<name> <size>\n' line followed by size bytes and a '\n',
+ * and is terminated by an empty block named 'end'.
+ * A request has an 'args' block with the '\0'-separated command line of the client,
+ * a 'fwd' block with the forward/assembled read file content and an optional 'rev' block with the reverse read file content.
+ * A response has an 'assign' block with the assignment output, optional 'align' and 'chimera' blocks,
+ * or an 'error' block with the error message if the request failed.
+ */
+static const string END_BLOCK = "end";
+static const string ARGS_BLOCK = "args";
+static const string FWD_BLOCK = "fwd";
+static const string REV_BLOCK = "rev";
+static const string ASSIGN_BLOCK = "assign";
+static const string ALIGN_BLOCK = "align";
+static const string CHIMERA_BLOCK = "chimera";
+static const string ERROR_BLOCK = "error";
+
+/** write a named block */
+ostream& writeBlock(ostream& out, const string& name, const string& data);
+
+/** write the end block, and flush the output */
+ostream& writeEndBlock(ostream& out);
+
+/**
+ * read a named block
+ * @return  the input, with failbit set if there is no more block or the block is malformed
+ */
+istream& readBlock(istream& in, string& name, string& data);
+
+/** join args into an args block */
+string joinArgs(const vector<string>& args);
+
+/** split an args block into args */
+vector<string> splitArgs(const string& data);
+
+/**
+ * create a Unix socket listening on the given path
+ * @return  the socket file descriptor, or -1 on error with errno set
+ */
+int listenSocket(const string& path);
+
+/**
+ * accept a connection on a listening socket, retrying if interrupted
+ * @return  the connected file descriptor, or -1 on error with errno set
+ */
+int acceptSocket(int fd);
+
+/**
+ * connect to a Unix socket listening on the given path
+ * @return  the connected file descriptor, or -1 on error with errno set
+ */
+int connectSocket(const string& path);
+
+} /* namespace HmmUFOtu */
+} /* namespace EGriceLab */
+
+#endif /* SRC_HMMUFOTUSERVER_H_ */
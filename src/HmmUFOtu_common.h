@@ -39,9 +39,12 @@
 #include "DigitalSeq.h"
 #include "PrimarySeq.h"
 #include "SeqUtils.h"
+#include "PDistIndex.h"
 #include "SeqIO.h"
 #include "MSA.h"
 #include "CSLoc.h"
+#include "HmmUFOtuDB.h"
+#include "HmmUFOtuServer.h"
 #include "StringUtils.h"
 #include "TSVRecord.h"
 #include "TSVScanner.h"
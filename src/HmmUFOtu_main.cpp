@@ -26,6 +26,8 @@
 
 #include <Eigen/Dense>
 #include <cassert>
+#include <cfloat>
+#include <ctime>
 #include <algorithm>
 #include "HmmUFOtu_main.h"
 #include "StringUtils.h"
@@ -36,23 +38,84 @@ using namespace Eigen;
 namespace EGriceLab {
 namespace HmmUFOtu {
 
-BandedHMMP7::HmmAlignment alignSeq(const BandedHMMP7& hmm, const CSFMIndex& csfm, const PrimarySeq& read,
-		int seedLen, int seedRegion, BandedHMMP7::align_mode mode) {
-	const DegenAlphabet* abc = hmm.getNuclAbc();
-	const int K = hmm.getProfileSize();
-	const int L = hmm.getCSLen();
-	const int N = read.length();
+const char* StageStats::STAGE_NAME[NUM_STAGE] = {
+		"csfm_seed", "banded_dp", "full_dp", "trace", "get_seed", "estimate", "place", "chimera"
+};
 
-	BandedHMMP7::ViterbiScores seqVscore(K, N); // construct an empty reusable score
+const char* StageStats::COUNTER_NAME[NUM_COUNTER] = {
+		"reads", "banded_dp", "widened_dp", "full_dp", "seeds", "candidates", "filtered_candidates",
+		"pruned_placements", "placements", "branch_iterations", "chimeras"
+};
+
+StageStats::StageStats() {
+	std::fill(time, time + NUM_STAGE, 0.0);
+	std::fill(count, count + NUM_COUNTER, 0L);
+}
+
+StageStats& StageStats::operator+=(const StageStats& other) {
+	for(int i = 0; i < NUM_STAGE; ++i)
+		time[i] += other.time[i];
+	for(int i = 0; i < NUM_COUNTER; ++i)
+		count[i] += other.count[i];
+	return *this;
+}
+
+ostream& StageStats::writeJSON(ostream& out, double elapsed, int nThreads) const {
+	const long nRead = count[COUNTER_READ];
+	const long nAlign = count[COUNTER_BANDED_DP] + count[COUNTER_WIDENED_DP] + count[COUNTER_FULL_DP];
+	out << "{" << endl;
+	out << "  \"threads\": " << nThreads << "," << endl;
+	out << "  \"elapsed_sec\": " << elapsed << "," << endl;
+	out << "  \"reads_per_sec\": " << (elapsed > 0 ? nRead / elapsed : 0) << "," << endl;
+	out << "  \"stage_sec\": {" << endl;
+	for(int i = 0; i < NUM_STAGE; ++i)
+		out << "    \"" << STAGE_NAME[i] << "\": " << time[i] << (i < NUM_STAGE - 1 ? "," : "") << endl;
+	out << "  }," << endl;
+	out << "  \"counters\": {" << endl;
+	for(int i = 0; i < NUM_COUNTER; ++i)
+		out << "    \"" << COUNTER_NAME[i] << "\": " << count[i] << "," << endl;
+	out << "    \"seeds_per_read\": " << (nRead > 0 ? static_cast<double> (count[COUNTER_SEED]) / nRead : 0) << "," << endl;
+	out << "    \"full_dp_fraction\": " << (nAlign > 0 ? static_cast<double> (count[COUNTER_FULL_DP]) / nAlign : 0) << "," << endl;
+	out << "    \"iterations_per_placement\": "
+			<< (count[COUNTER_PLACED] > 0 ? static_cast<double> (count[COUNTER_BRANCH_ITER]) / count[COUNTER_PLACED] : 0) << endl;
+	out << "  }" << endl;
+	out << "}" << endl;
+	return out;
+}
+
+double StageStats::now() {
+	struct timespec ts;
+	::clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static long nQueuedTasks = 0; /* read-level tasks waiting for a thread */
+
+void addQueuedTasks(long n) {
+#pragma omp atomic
+	nQueuedTasks += n;
+}
+
+bool splitTasks(size_t n) {
+	if(n <= 1)
+		return false;
+	long nQueued;
+#pragma omp atomic read
+	nQueued = nQueuedTasks;
+	return nQueued <= 0;
+}
+
+vector<BandedHMMP7::ViterbiAlignPath> getSeedPaths(const BandedHMMP7& hmm, const CSFMIndex& csfm, const PrimarySeq& read,
+		int seedLen, int seedRegion, BandedHMMP7::align_mode mode, CSFMIndex::RNG& rng) {
+	const DegenAlphabet* abc = hmm.getNuclAbc();
 	vector<BandedHMMP7::ViterbiAlignPath> seqVpaths; // construct an empty list of VPaths
-	BandedHMMP7::ViterbiAlignTrace seqVtrace; // construct an empty VTrace
 
 	int regionLen = seedRegion < read.length() ? seedRegion : read.length(); /* search region */
 	/* find seed in 5' */
 	for(int seedFrom = 0; seedFrom + seedLen - 1 < regionLen; ++seedFrom) {
 		int seedTo = seedFrom + seedLen - 1;
 		PrimarySeq seed(abc, read.getId(), read.subseq(seedFrom, seedLen));
-		const CSLoc& loc = csfm.locateOne(seed.getSeq());
+		const CSLoc& loc = csfm.locateOne(seed.getSeq(), rng);
 		if(loc.isValid()) /* a read seed located */ {
 //			cerr << "using 5' seed seedFrom: " << seedFrom << " seedTo: " << seedTo << endl;
 //			cerr << "Using 5' seed: " << seed.getSeq() << endl;
@@ -69,7 +132,7 @@ BandedHMMP7::HmmAlignment alignSeq(const BandedHMMP7& hmm, const CSFMIndex& csfm
 		for(int seedTo = read.length() - 1; seedTo - seedLen + 1 >= (int) read.length() - regionLen; --seedTo) {
 			int seedFrom = seedTo - seedLen + 1;
 			PrimarySeq seed(abc, read.getId(), read.subseq(seedFrom, seedLen));
-			const CSLoc& loc = csfm.locateOne(seed.getSeq());
+			const CSLoc& loc = csfm.locateOne(seed.getSeq(), rng);
 			if(loc.isValid()) { /* a read seed located */
 //				cerr << "using 3' seed seedFrom: " << seedFrom << " seedTo: " << seedTo << endl;
 //				cerr << "Using 3' seed: " << seed.getSeq() << endl;
@@ -82,18 +145,71 @@ BandedHMMP7::HmmAlignment alignSeq(const BandedHMMP7& hmm, const CSFMIndex& csfm
 			}
 		}
 	}
+	return seqVpaths;
+}
 
-	/* banded HMM align */
-	if(!seqVpaths.empty()) { /* use banded Viterbi algorithm */
-		hmm.calcViterbiScores(read, seqVscore, seqVpaths);
-		if(seqVscore.S.minCoeff() == inf) { /* banded version failed */
-			debugLog << "Banded HMM algorithm didn't find a potential Viterbi path, returning to regular HMM" << endl;
+/**
+ * finish the Viterbi scores of a read whose banded scores were calculated with the default band,
+ * by widening the band then falling back to the full DP if the band failed
+ * @return  the DP tier finally used
+ */
+static ALIGN_TIER completeViterbiScores(const BandedHMMP7& hmm, const PrimarySeq& read,
+		const vector<BandedHMMP7::ViterbiAlignPath>& seqVpaths, BandedHMMP7::ViterbiScores& seqVscore) {
+	ALIGN_TIER alnTier = TIER_FULL;
+	if(!seqVpaths.empty()) { /* banded Viterbi algorithm used */
+		if(seqVscore.minScore != inf)
+			alnTier = TIER_BANDED;
+		/* retry with geometrically widened bands */
+		double gapFrac = BandedHMMP7::kMinGapFrac;
+		for(int n = 0; alnTier == TIER_FULL && n < MAX_BAND_WIDEN; ++n) {
+			gapFrac *= 2;
+			debugLog << "Banded HMM algorithm didn't find a potential Viterbi path, widening band gap fraction to " << gapFrac << endl;
+			seqVscore.reset();
+			hmm.calcViterbiScores(read, seqVscore, seqVpaths, gapFrac);
+			if(seqVscore.minScore != inf)
+				alnTier = TIER_WIDENED;
+		}
+		/* retry with each seed alone, in case of inconsistent 5' and 3' seeds */
+		for(vector<BandedHMMP7::ViterbiAlignPath>::size_type i = 0; alnTier == TIER_FULL && seqVpaths.size() > 1 && i < seqVpaths.size(); ++i) {
+			seqVscore.reset();
+			hmm.calcViterbiScores(read, seqVscore, vector<BandedHMMP7::ViterbiAlignPath>(1, seqVpaths[i]), gapFrac);
+			if(seqVscore.minScore != inf)
+				alnTier = TIER_WIDENED;
+		}
+		if(alnTier == TIER_FULL) { /* banded versions all failed */
+			debugLog << "Widened banded HMM algorithm didn't find a potential Viterbi path, returning to regular HMM" << endl;
 			seqVscore.reset();
-			hmm.calcViterbiScores(read, seqVscore);
 		}
 	}
-	else
+	if(alnTier == TIER_FULL)
 		hmm.calcViterbiScores(read, seqVscore); /* use original Viterbi algorithm */
+	return alnTier;
+}
+
+BandedHMMP7::HmmAlignment alignSeq(const BandedHMMP7& hmm, const CSFMIndex& csfm, const PrimarySeq& read,
+		int seedLen, int seedRegion, BandedHMMP7::align_mode mode, CSFMIndex::RNG& rng, ALIGN_TIER* tier,
+		StageStats* stats) {
+	const int K = hmm.getProfileSize();
+	const int N = read.length();
+	StageStats localStats;
+	if(stats == NULL)
+		stats = &localStats;
+	double t = StageStats::now();
+
+	BandedHMMP7::ViterbiScores seqVscore(K, N); // construct an empty reusable score
+	BandedHMMP7::ViterbiAlignTrace seqVtrace; // construct an empty VTrace
+	const vector<BandedHMMP7::ViterbiAlignPath>& seqVpaths = getSeedPaths(hmm, csfm, read, seedLen, seedRegion, mode, rng);
+	t = stats->addTime(STAGE_CSFM_SEED, t);
+
+	/* banded HMM align, widening the band before falling back to the full DP */
+	if(!seqVpaths.empty())
+		hmm.calcViterbiScores(read, seqVscore, seqVpaths);
+	t = stats->addTime(STAGE_BANDED_DP, t);
+	ALIGN_TIER alnTier = completeViterbiScores(hmm, read, seqVpaths, seqVscore);
+	if(tier != NULL)
+		*tier = alnTier;
+	stats->add(alnTier == TIER_BANDED ? COUNTER_BANDED_DP : alnTier == TIER_WIDENED ? COUNTER_WIDENED_DP : COUNTER_FULL_DP);
+	t = stats->addTime(STAGE_FULL_DP, t);
 
 	/* build VTrace */
 	hmm.buildViterbiTrace(seqVscore, seqVtrace);
@@ -101,7 +217,9 @@ BandedHMMP7::HmmAlignment alignSeq(const BandedHMMP7& hmm, const CSFMIndex& csfm
 	assert(seqVtrace.minScore != inf);
 
 	/* get aligned seq */
-	return hmm.buildGlobalAlign(read, seqVscore, seqVtrace);
+	BandedHMMP7::HmmAlignment aln = hmm.buildGlobalAlign(read, seqVscore, seqVtrace);
+	stats->addTime(STAGE_TRACE, t);
+	return aln;
 }
 
 BandedHMMP7::HmmAlignment alignSeq(const BandedHMMP7& hmm, const PrimarySeq& read) {
@@ -136,6 +254,37 @@ vector<PTUnrooted::PTLoc> getSeed(const PTUnrooted& ptu, const DigitalSeq& seq,
 		locs.push_back(PTUnrooted::PTLoc(start, end, node->getId(), pDist));
 	}
 	std::sort(locs.begin(), locs.end()); /* sort by p-Dist */
+	return filterSeed(locs, maxDiff);
+}
+
+vector<PTUnrooted::PTLoc> getSeedTopDown(const PTUnrooted& ptu, const DigitalSeq& seq,
+		int start, int end, int beamWidth, double maxDiff) {
+	assert(beamWidth > 0);
+	vector<PTUnrooted::PTLoc> locs; /* candidate locations */
+	vector<PTUnrooted::PTLoc> beam; /* nodes to be expanded at current level */
+	beam.push_back(PTUnrooted::PTLoc(start, end, ptu.getRoot()->getId(), 0));
+	while(!beam.empty()) {
+		vector<PTUnrooted::PTLoc> next; /* children of nodes in the beam */
+		for(vector<PTUnrooted::PTLoc>::const_iterator loc = beam.begin(); loc != beam.end(); ++loc) {
+			const vector<PTUnrooted::PTUNodePtr>& children = ptu.getNode(loc->id)->getChildren();
+			for(vector<PTUnrooted::PTUNodePtr>::const_iterator child = children.begin(); child != children.end(); ++child)
+				next.push_back(PTUnrooted::PTLoc(start, end, (*child)->getId(), SeqUtils::pDist((*child)->getSeq(), seq, start, end)));
+		}
+		locs.insert(locs.end(), next.begin(), next.end());
+		/* only expand the best subtrees */
+		if(next.size() > static_cast<size_t> (beamWidth)) {
+			std::partial_sort(next.begin(), next.begin() + beamWidth, next.end());
+			next.erase(next.begin() + beamWidth, next.end());
+		}
+		beam.swap(next);
+	}
+	std::sort(locs.begin(), locs.end()); /* sort by p-Dist */
+	return filterSeed(locs, maxDiff);
+}
+
+vector<PTUnrooted::PTLoc>& filterSeed(vector<PTUnrooted::PTLoc>& locs, double maxDiff) {
+	if(locs.empty())
+		return locs;
 	/* remove bad seed, if necessary */
 	double bestDist = locs[0].dist;
 	double worstDist = locs[locs.size() - 1].dist;
@@ -152,9 +301,37 @@ vector<PTUnrooted::PTLoc> getSeed(const PTUnrooted& ptu, const DigitalSeq& seq,
 
 vector<PTUnrooted::PTPlacement> estimateSeq(const PTUnrooted& ptu, const DigitalSeq& seq,
 		const vector<PTUnrooted::PTLoc>& locs, const string& method) {
-	vector<PTUnrooted::PTPlacement> places;
-	for(vector<PTUnrooted::PTLoc>::const_iterator loc = locs.begin(); loc != locs.end(); ++loc)
-		places.push_back(ptu.estimateSeq(seq, *loc, method));
+	vector<PTUnrooted::PTPlacement> places(locs.size());
+	const bool split = splitTasks(locs.size());
+	for(vector<PTUnrooted::PTLoc>::size_type i = 0; i < locs.size(); ++i)
+#pragma omp task if(split) shared(ptu, seq, locs, method, places)
+		places[i] = ptu.estimateSeq(seq, locs[i], method);
+#pragma omp taskwait
+	return places;
+}
+
+PDistIndex& indexSeed(const PTUnrooted& ptu, const vector<PTUnrooted::PTLoc>& seeds, PDistIndex& pdIdx) {
+	for(vector<PTUnrooted::PTLoc>::const_iterator seed = seeds.begin(); seed != seeds.end(); ++seed) {
+		PTUnrooted::PTUNodePtr node = ptu.getNode(seed->id);
+		pdIdx.addRef(node->getId(), node->getSeq());
+		pdIdx.addRef(node->getParent()->getId(), node->getParent()->getSeq());
+	}
+	return pdIdx;
+}
+
+PTUnrooted::PTPlacement estimateSeq(const PTUnrooted& ptu, const DigitalSeq& seq,
+		const PTUnrooted::PTLoc& loc, const PDistIndex& pdIdx, const string& method) {
+	return ptu.estimateSeq(seq, loc, pdIdx.pDist(ptu.getNode(loc.id)->getParent()->getId(), loc.start, loc.end), method);
+}
+
+vector<PTUnrooted::PTPlacement> estimateSeq(const PTUnrooted& ptu, const DigitalSeq& seq,
+		const vector<PTUnrooted::PTLoc>& locs, const PDistIndex& pdIdx, const string& method) {
+	vector<PTUnrooted::PTPlacement> places(locs.size());
+	const bool split = splitTasks(locs.size());
+	for(vector<PTUnrooted::PTLoc>::size_type i = 0; i < locs.size(); ++i)
+#pragma omp task if(split) shared(ptu, seq, locs, pdIdx, method, places)
+		places[i] = estimateSeq(ptu, seq, locs[i], pdIdx, method);
+#pragma omp taskwait
 	return places;
 }
 
@@ -172,11 +349,45 @@ vector<PTUnrooted::PTPlacement>& filterPlacements(vector<PTUnrooted::PTPlacement
 }
 
 vector<PTUnrooted::PTPlacement>& placeSeq(const PTUnrooted& ptu, const DigitalSeq& seq, vector<PTUnrooted::PTPlacement>& places) {
+	const bool split = splitTasks(places.size());
 	for(vector<PTUnrooted::PTPlacement>::iterator place = places.begin(); place != places.end(); ++place)
+#pragma omp task if(split) shared(ptu, seq)
+		ptu.placeSeq(seq, *place);
+#pragma omp taskwait
+	return places;
+}
+
+vector<PTUnrooted::PTPlacement>& placeSeq(const PTUnrooted& ptu, const DigitalSeq& seq,
+		vector<PTUnrooted::PTPlacement>& places, PTUnrooted::PRIOR_TYPE type, double margin, long* nPruned) {
+	if(places.size() <= 1)
+		return placeSeq(ptu, seq, places);
+
+	/* place the best estimated placement first */
+	ptu.placeSeq(seq, places.front());
+	const double minBound = places.front().loglik + places.front().logPriorPr(type) - margin; /* all log-priors are no greater than 0 */
+	/* remove placements that cannot reach the bound, those with the estimated loglik reaching it are kept without bounding */
+	vector<PTUnrooted::PTPlacement>::iterator last = places.begin() + 1;
+	for(vector<PTUnrooted::PTPlacement>::iterator place = places.begin() + 1; place != places.end(); ++place) {
+		if(!(place->loglik < minBound) || !(ptu.boundLoglik(seq, *place, minBound) < minBound))
+			*last++ = *place;
+	}
+	if(nPruned != NULL)
+		*nPruned += places.end() - last;
+	places.erase(last, places.end());
+
+	/* place the others */
+	const bool split = splitTasks(places.size() - 1);
+	for(vector<PTUnrooted::PTPlacement>::iterator place = places.begin() + 1; place != places.end(); ++place)
+#pragma omp task if(split) shared(ptu, seq)
 		ptu.placeSeq(seq, *place);
+#pragma omp taskwait
 	return places;
 }
 
+double qValueMargin(size_t n) {
+	return (PTUnrooted::PTPlacement::MAX_Q / 10.0 + DBL_DIG) * ::log(10.0) + ::log(static_cast<double> (n));
+}
+
 void calcQValues(vector<PTUnrooted::PTPlacement>& places, PTUnrooted::PRIOR_TYPE type) {
 	if(places.empty())
 		return;
@@ -30,6 +30,7 @@
 
 #include <string>
 #include <vector>
+#include <iostream>
 #include <algorithm>
 #include <cmath>
 #include <boost/unordered_set.hpp>
@@ -41,6 +42,7 @@ namespace HmmUFOtu {
 
 using std::string;
 using std::vector;
+using std::ostream;
 
 /**
  * A JSON Placement type for holding an HmmUFOtu placement result
@@ -67,9 +69,116 @@ struct JPlace {
 	static const int MAX_Q = 250; /* maximum allowed Q value */
 };
 
-/** Align seq using banded HMM algorithm, returns an HmmAlignment */
+/** Viterbi DP tiers used by alignSeq, from the cheapest to the most expensive */
+enum ALIGN_TIER {
+	TIER_BANDED, /* banded DP with the default gap fraction */
+	TIER_WIDENED, /* banded DP with a widened band */
+	TIER_FULL /* full DP */
+};
+
+static const int NUM_ALIGN_TIER = 3;
+static const int MAX_BAND_WIDEN = 3; /* maximum times of doubling the band gap fraction before using the full DP */
+
+/** stages of read assignment timed by StageStats */
+enum STAGE {
+	STAGE_CSFM_SEED, /* locating 5'/3' read seeds in the CSFM-index */
+	STAGE_BANDED_DP, /* banded Viterbi DP with the default band */
+	STAGE_FULL_DP, /* widened banded and full Viterbi DP after the default band failed */
+	STAGE_TRACE, /* Viterbi trace and global alignment */
+	STAGE_GET_SEED, /* seed nodes of the 'Seed' stage of SEP */
+	STAGE_ESTIMATE, /* estimated placements and their filtering */
+	STAGE_PLACE, /* accurate placements and Q-values */
+	STAGE_CHIMERA /* chimera checking, including placing all segments */
+};
+
+static const int NUM_STAGE = 8;
+
+/** counters of read assignment kept by StageStats */
+enum COUNTER {
+	COUNTER_READ, /* reads/pairs processed */
+	COUNTER_BANDED_DP, /* alignments done by the banded DP */
+	COUNTER_WIDENED_DP, /* alignments done by a widened banded DP */
+	COUNTER_FULL_DP, /* alignments falling back to the full DP */
+	COUNTER_SEED, /* seed nodes used */
+	COUNTER_CANDIDATE, /* estimated placements before filterPlacements */
+	COUNTER_FILTERED, /* estimated placements after filterPlacements */
+	COUNTER_PRUNED, /* filtered placements skipped by their loglik bound */
+	COUNTER_PLACED, /* accurate placements done */
+	COUNTER_BRANCH_ITER, /* iterations of optimizeBranchLength used by accurate placements */
+	COUNTER_CHIMERA /* reads/pairs found as chimera */
+};
+
+static const int NUM_COUNTER = 11;
+
+/**
+ * Accumulated wall time of each stage and counters of read assignment
+ * each thread keeps its own StageStats, merged after all reads are done
+ */
+struct StageStats {
+	/** default constructor, with all times and counters zero */
+	StageStats();
+
+	/** add the time since start to a stage, and return the current time */
+	double addTime(STAGE stage, double start) {
+		const double t = now();
+		time[stage] += t - start;
+		return t;
+	}
+
+	/** add n to a counter */
+	void add(COUNTER counter, long n = 1) {
+		count[counter] += n;
+	}
+
+	/** merge another StageStats into this one */
+	StageStats& operator+=(const StageStats& other);
+
+	/**
+	 * write as a JSON object
+	 * @param elapsed  elapsed wall time of the whole run, used for the overall reads/sec
+	 * @param nThreads  number of threads used
+	 */
+	ostream& writeJSON(ostream& out, double elapsed, int nThreads) const;
+
+	/** current monotonic time in seconds */
+	static double now();
+
+	double time[NUM_STAGE]; /* seconds spent in each stage, summed over threads */
+	long count[NUM_COUNTER];
+
+	static const char* STAGE_NAME[NUM_STAGE];
+	static const char* COUNTER_NAME[NUM_COUNTER];
+};
+
+/**
+ * Add n to the number of read-level OpenMP tasks created but not yet started,
+ * called with 1 when a read task is created and -1 when it starts
+ */
+void addQueuedTasks(long n);
+
+/**
+ * Test whether n candidates of a single seq should be split into their own OpenMP tasks,
+ * only when n > 1 and no read-level task is waiting for a thread, so they never compete with whole reads
+ */
+bool splitTasks(size_t n);
+
+/**
+ * Align seq using banded HMM algorithm, returns an HmmAlignment
+ * if the banded DP fails, the band is widened MAX_BAND_WIDEN times before falling back to the full DP
+ * @param rng  random number generator used for picking seed hits, results are reproducible for the same rng state
+ * @param tier  if not NULL, set to the DP tier finally used
+ * @param stats  if not NULL, the alignment stages and DP tier are added to it
+ */
 BandedHMMP7::HmmAlignment alignSeq(const BandedHMMP7& hmm, const CSFMIndex& csfm, const PrimarySeq& read,
-		int seedLen, int seedRegion, BandedHMMP7::align_mode mode);
+		int seedLen, int seedRegion, BandedHMMP7::align_mode mode, CSFMIndex::RNG& rng, ALIGN_TIER* tier = NULL,
+		StageStats* stats = NULL);
+
+/**
+ * Get the known alignment paths of a read by locating its 5' seed and, in GLOBAL mode, 3' seed in the CSFM-index
+ * @return  known paths used by the banded Viterbi algorithm, or empty if no seed found
+ */
+vector<BandedHMMP7::ViterbiAlignPath> getSeedPaths(const BandedHMMP7& hmm, const CSFMIndex& csfm, const PrimarySeq& read,
+		int seedLen, int seedRegion, BandedHMMP7::align_mode mode, CSFMIndex::RNG& rng);
 
 /** Align seq using traditional HMM algorithm, returns an HmmAlignment */
 BandedHMMP7::HmmAlignment alignSeq(const BandedHMMP7& hmm, const PrimarySeq& read);
@@ -86,10 +195,46 @@ BandedHMMP7::HmmAlignment alignSeq(const BandedHMMP7& hmm, const PrimarySeq& rea
 vector<PTUnrooted::PTLoc> getSeed(const PTUnrooted& ptu, const DigitalSeq& seq,
 		int start, int end, double maxDiff = inf);
 
-/** Get estimated placement for a seq at given locations */
+/**
+ * Get seed placement locations by a top-down search of the tree, starting from the root,
+ * comparing the seq to the observed/inferred seq of each child, and only expanding the best subtrees at each level
+ * @param beamWidth  number of nodes expanded at each level
+ * @return  a vector of PTPlacement of all compared nodes sorted by the p-dist
+ */
+vector<PTUnrooted::PTLoc> getSeedTopDown(const PTUnrooted& ptu, const DigitalSeq& seq,
+		int start, int end, int beamWidth, double maxDiff = inf);
+
+/**
+ * Remove seeds with p-dist larger than the best one by more than maxDiff
+ * @param locs  seeds sorted by p-dist
+ * @return  the modified seeds
+ */
+vector<PTUnrooted::PTLoc>& filterSeed(vector<PTUnrooted::PTLoc>& locs, double maxDiff);
+
+/**
+ * Get estimated placement for a seq at given locations
+ * each location is estimated in its own OpenMP task if splitTasks() allows, so idle threads can share the work of a single seq
+ */
 vector<PTUnrooted::PTPlacement> estimateSeq(const PTUnrooted& ptu, const DigitalSeq& seq,
 		const vector<PTUnrooted::PTLoc>& locs, const string& method);
 
+/**
+ * Index the seq of seed nodes and their parents, so p-distances of the seeds and their placements
+ * in any sub-region can be get from the index
+ */
+PDistIndex& indexSeed(const PTUnrooted& ptu, const vector<PTUnrooted::PTLoc>& seeds, PDistIndex& pdIdx);
+
+/** Get estimated placement for a seq at given location, using the indexed p-distance of its parent */
+PTUnrooted::PTPlacement estimateSeq(const PTUnrooted& ptu, const DigitalSeq& seq,
+		const PTUnrooted::PTLoc& loc, const PDistIndex& pdIdx, const string& method);
+
+/**
+ * Get estimated placement for a seq at given locations, using the indexed p-distances of their parents
+ * each location is estimated in its own OpenMP task if splitTasks() allows
+ */
+vector<PTUnrooted::PTPlacement> estimateSeq(const PTUnrooted& ptu, const DigitalSeq& seq,
+		const vector<PTUnrooted::PTLoc>& locs, const PDistIndex& pdIdx, const string& method);
+
 /**
  * filter estimated placement by removing bad placement with estimated loglik lower than the best placement
  * @param places  a vector of placements
@@ -98,10 +243,33 @@ vector<PTUnrooted::PTPlacement> estimateSeq(const PTUnrooted& ptu, const Digital
  */
 vector<PTUnrooted::PTPlacement>& filterPlacements(vector<PTUnrooted::PTPlacement>& places, double maxError);
 
-/** Get accurate placement for a seq given the estimated placements */
+/**
+ * Get accurate placement for a seq given the estimated placements
+ * each placement is done in its own OpenMP task if splitTasks() allows
+ */
 vector<PTUnrooted::PTPlacement>& placeSeq(const PTUnrooted& ptu, const DigitalSeq& seq,
 		vector<PTUnrooted::PTPlacement>& places);
 
+/**
+ * Get accurate placement for a seq given the estimated placements, with branch-and-bound pruning
+ * the first (best estimated) placement is placed first, then any other placement whose loglik bound
+ * cannot come within margin of the posterior of the first is removed without placing,
+ * any placement whose estimated loglik already comes within the margin is kept without computing its bound
+ * @param places  estimated placements sorted by loglik decreasingly, as returned by filterPlacements
+ * @param type  prior type used to compare the posteriors
+ * @param margin  minimum posterior log-difference for a placement to be removed
+ * @param nPruned  if not NULL, incremented by the number of placements removed
+ * @return  the modified vector of placements, in the same order without the removed ones
+ */
+vector<PTUnrooted::PTPlacement>& placeSeq(const PTUnrooted& ptu, const DigitalSeq& seq,
+		vector<PTUnrooted::PTPlacement>& places, PTUnrooted::PRIOR_TYPE type, double margin, long* nPruned = NULL);
+
+/**
+ * get the margin of posterior log-difference beyond which placements cannot change
+ * the Q-values of n placements to the precision of a double
+ */
+double qValueMargin(size_t n);
+
 /** calculate Q-values using a given prior type */
 void calcQValues(vector<PTUnrooted::PTPlacement>& places, PTUnrooted::PRIOR_TYPE type);
 
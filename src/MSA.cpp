@@ -137,6 +137,42 @@ MSA& MSA::prune() {
 	return *this;
 }
 
+MSA& MSA::slice(unsigned start, unsigned end) {
+	if(!(start <= end && end < csLen))
+		throw out_of_range("Invalid MSA slicing region");
+	const unsigned len = end - start + 1;
+	if(len == csLen) /* nothing to do */
+		return *this;
+
+	/* construct the sliced concatMSA */
+	string slicedMSA;
+	slicedMSA.reserve(static_cast<string::size_type> (numSeq) * len);
+	for(unsigned i = 0; i < numSeq; ++i)
+		slicedMSA.append(concatMSA, static_cast<string::size_type> (i) * csLen + start, len);
+	/* swap the storage */
+	concatMSA.swap(slicedMSA);
+
+	/* slice the known CS, if exist */
+	if(!CS.empty())
+		CS = CS.substr(start, len);
+
+	/* update index */
+	csLen = len;
+
+	/* destroy old counts */
+	clear();
+	resetRawCount();
+	resetSeqWeight();
+	resetWeightedCount();
+
+	/* rebuild the counts */
+	updateRawCounts();
+	updateSeqWeight();
+	updateWeightedCounts();
+
+	return *this;
+}
+
 long MSA::loadMSAFasta(const DegenAlphabet* abc, istream& in) {
 	SeqIO seqI(&in, abc, "fasta");
 	while(seqI.hasNext()) {
@@ -128,6 +128,13 @@ public:
 	 */
 	MSA& prune();
 
+	/**
+	 * Slice this MSA to the consensus columns [start, end] (0-based, inclusive)
+	 * @return the modified MSA object
+	 * @throw std::out_of_range if the given region is invalid
+	 */
+	MSA& slice(unsigned start, unsigned end);
+
 	/**
 	 * get the total length of this MSA
 	 * @return the total MSA length w/ gaps
@@ -80,6 +80,14 @@ struct OTUObserved {
 		return numSymSites() / static_cast<double> (csLen);
 	}
 
+	/** add the observed data of another OTUObserved of the same OTU and samples to this one */
+	OTUObserved& operator+=(const OTUObserved& other) {
+		freq += other.freq;
+		gap += other.gap;
+		count += other.count;
+		return *this;
+	}
+
 	string id; /* id for this OTU */
 	string taxon; /* taxon for this OTU */
 	int csLen;  /* consensus sequence length */
@@ -9,10 +9,16 @@
 #include <cassert>
 #include <algorithm>
 #include <sstream>
+#include <cstring>
+#include <cstdlib>
 #include <boost/lexical_cast.hpp>
-#include <boost/random/random_number_generator.hpp> /* an adapter between randome_number_generator and uniform_random_number_generator */
+#include <boost/cstdint.hpp>
+#include <boost/random/seed_seq.hpp>
+#include <boost/random/binomial_distribution.hpp>
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 #include "StringUtils.h"
+#include "HypergeometricDistribution.h"
 #include "HmmUFOtuConst.h"
 #include "OTUTable.h"
 
@@ -24,13 +30,34 @@ using namespace Eigen;
 
 const IOFormat OTUTable::dblTabFmt(FullPrecision, DontAlignCols, "\t", "\n", "", "", "");
 const IOFormat OTUTable::fltTabFmt(FullPrecision, DontAlignCols, "\t", "\n", "", "", "");
-OTUTable::RNG OTUTable::rng(time(NULL)); /* initiate RNG with random seed */
 
 void OTUTable::clear() {
 	samples.clear();
 	otus.clear();
 	metric.resize(0, 0);
 	otu2Taxon.clear();
+	sampleIdx.clear();
+	otuIdx.clear();
+}
+
+void OTUTable::indexSamples() {
+	sampleIdx.clear();
+	for(size_t j = 0; j < samples.size(); ++j)
+		sampleIdx.insert(std::make_pair(samples[j], j)); /* keep the first of duplicated names */
+}
+
+void OTUTable::indexOTUs() {
+	otuIdx.clear();
+	for(size_t i = 0; i < otus.size(); ++i)
+		otuIdx.insert(std::make_pair(otus[i], i));
+}
+
+bool OTUTable::isRelative() const {
+	for(SpMatrix::Index i = 0; i < metric.outerSize(); ++i)
+		for(SpMatrix::InnerIterator it(metric, i); it; ++it)
+			if(it.value() > 1.0)
+				return false;
+	return true;
 }
 
 size_t OTUTable::addSample(const string& sampleName) {
@@ -39,23 +66,34 @@ size_t OTUTable::addSample(const string& sampleName) {
 		return N;
 
 	samples.push_back(sampleName);
-	metric.conservativeResize(Eigen::NoChange, N + 1);
-	metric.col(N).setZero();
+	sampleIdx[sampleName] = N;
+	metric.conservativeResize(metric.rows(), N + 1); /* new column is all zero */
 
 	return N;
 }
 
-void OTUTable::removeSample(size_t j) {
-	const size_t N = metric.cols();
-	samples.erase(samples.begin() + j);
-	MatrixXd oldMetric(metric); /* copy the old values */
-	metric.resize(Eigen::NoChange, N - 1);
-	for(MatrixXd::Index n = 0, k = 0; n < N; ++n) {
-		if(n != j) { /* not the deleted column */
-			metric.col(k) = oldMetric.col(n);
-			k++;
+void OTUTable::keepSamples(const vector<bool>& keep) {
+	/* map old column to new column */
+	vector<SpMatrix::Index> newIdx(numSamples(), -1);
+	vector<string> newSamples;
+	for(size_t j = 0; j < numSamples(); ++j) {
+		if(keep[j]) {
+			newIdx[j] = newSamples.size();
+			newSamples.push_back(samples[j]);
 		}
 	}
+	SpMatrix newMetric(metric.rows(), newSamples.size());
+	newMetric.reserve(metric.nonZeros());
+	for(SpMatrix::Index i = 0; i < metric.outerSize(); ++i) {
+		newMetric.startVec(i);
+		for(SpMatrix::InnerIterator it(metric, i); it; ++it)
+			if(newIdx[it.col()] >= 0)
+				newMetric.insertBack(i, newIdx[it.col()]) = it.value();
+	}
+	newMetric.finalize();
+	metric.swap(newMetric);
+	samples.swap(newSamples);
+	indexSamples();
 }
 
 size_t OTUTable::addOTU(const string& otuID, const string& taxon, const RowVectorXd& count) {
@@ -64,60 +102,70 @@ size_t OTUTable::addOTU(const string& otuID, const string& taxon, const RowVecto
 		return M;
 
 	otus.push_back(otuID);
+	otuIdx[otuID] = M;
 	otu2Taxon[otuID] = taxon;
-	metric.conservativeResize(M + 1, Eigen::NoChange);
-	metric.row(M) = count;
+	/* append the new row to the end of the compressed metric */
+	metric.conservativeResize(M + 1, metric.cols());
+	for(RowVectorXd::Index j = 0; j < count.size(); ++j)
+		if(count(j) != 0)
+			metric.insertBack(M, j) = count(j);
 
 	return M;
 }
 
-void OTUTable::removeOTU(size_t i) {
-	const size_t M = metric.rows();
-	otu2Taxon.erase(otus[i]); /* remove taxon first */
-	otus.erase(otus.begin() + i); /* remove the actual OTU */
-	MatrixXd oldMetric(metric); /* copy the old values */
-	metric.resize(M - 1, Eigen::NoChange);
-	for(MatrixXd::Index m = 0, k = 0; m < M; ++m) {
-		if(m != i) { /* not the deleted row */
-			metric.row(k) = oldMetric.row(m);
-			k++;
+void OTUTable::keepOTUs(const vector<bool>& keep) {
+	vector<string> newOTUs;
+	SpMatrix newMetric(std::count(keep.begin(), keep.end(), true), metric.cols());
+	newMetric.reserve(metric.nonZeros());
+	for(size_t i = 0; i < numOTUs(); ++i) {
+		if(!keep[i]) {
+			otu2Taxon.erase(otus[i]);
+			continue;
 		}
+		newMetric.startVec(newOTUs.size());
+		for(SpMatrix::InnerIterator it(metric, i); it; ++it)
+			newMetric.insertBack(newOTUs.size(), it.col()) = it.value();
+		newOTUs.push_back(otus[i]);
 	}
+	newMetric.finalize();
+	metric.swap(newMetric);
+	otus.swap(newOTUs);
+	indexOTUs();
 }
 
 void OTUTable::pruneSamples(size_t min) {
 	if(min == 0)
 		return;
 
-	const size_t N = numSamples();
-	/* remove samples backwards */
-	for(size_t j = N; j > 0; --j) {
-		if(sumSampleMetric(j - 1) < min)
-			removeSample(j - 1);
-	}
+	const RowVectorXd sampleTotal = RowVectorXd::Ones(numOTUs()) * metric;
+	vector<bool> keep(numSamples());
+	for(size_t j = 0; j < numSamples(); ++j)
+		keep[j] = sampleTotal(j) >= min;
+	keepSamples(keep);
 }
 
 void OTUTable::pruneOTUs(size_t min) {
 	const size_t M = numOTUs();
-	/* remove samples backwards */
-	for(size_t i = M; i > 0; --i) {
-		double nRead = sumOTUMetric(i - 1);
-		if(min > 0 && nRead < min || min == 0 && nRead == 0)
-			removeOTU(i - 1);
+	vector<bool> keep(M);
+	for(size_t i = 0; i < M; ++i) {
+		double nRead = sumOTUMetric(i);
+		keep[i] = !((min > 0 && nRead < min) || (min == 0 && nRead == 0));
 	}
+	keepOTUs(keep);
 }
 
 void OTUTable::normalizeConst(double Z) {
 	assert(Z >= 0);
-	if(empty() || (metric.array() == 0).all()) /* empty or all zero metric */
+	if(empty() || metric.nonZeros() == 0) /* empty or all zero metric */
 		return;
+	const RowVectorXd sampleTotal = RowVectorXd::Ones(numOTUs()) * metric;
 	if(Z == 0)
-		Z = metric.colwise().sum().maxCoeff(); /* use max column sum as constant */
+		Z = sampleTotal.maxCoeff(); /* use max column sum as constant */
 
-	const size_t N = metric.cols();
-	RowVectorXd norm = metric.colwise().sum() / Z;
-	for(MatrixXd::Index j = 0; j < N; ++j)
-		metric.col(j) /= norm(j);
+	RowVectorXd norm = sampleTotal / Z;
+	for(SpMatrix::Index i = 0; i < metric.outerSize(); ++i)
+		for(SpMatrix::InnerIterator it(metric, i); it; ++it)
+			it.valueRef() /= norm(it.col());
 }
 
 istream& OTUTable::loadTable(istream& in) {
@@ -125,6 +173,7 @@ istream& OTUTable::loadTable(istream& in) {
 	/* input header */
 	string line;
 	size_t N = 0;
+	vector<Triplet<double> > values; /* non-zero values */
 	while(std::getline(in, line)) {
 		if(StringUtils::startsWith(line, "otuID")) { /* header line */
 			vector<string> headers;
@@ -133,20 +182,41 @@ istream& OTUTable::loadTable(istream& in) {
 			/* update samples */
 			samples.resize(N);
 			std::copy(headers.begin() + 1, headers.end() - 1, samples.begin());
-			metric.resize(0, N);
 		}
 		else { /* value line */
-			string otuID, taxon;
-			istringstream lineIn(line);
-			std::getline(lineIn, otuID, '\t');
-			RowVectorXd counts(N);
-			for(size_t j = 0; j < N; ++j)
-				lineIn >> counts(j);
-			lineIn.ignore(1, '\t');
-			std::getline(lineIn, taxon);
-			addOTU(otuID, taxon, counts); /* add a new OTU */
+			const char* p = line.c_str();
+			const char* idEnd = ::strchr(p, '\t');
+			if(idEnd == NULL)
+				idEnd = p + line.length();
+			const string otuID(p, idEnd);
+			p = idEnd;
+			const size_t i = otus.size();
+			const bool isNew = otuIdx.insert(std::make_pair(otuID, i)).second; /* ignore duplicated OTUs */
+			for(size_t j = 0; j < N; ++j) {
+				char* valEnd;
+				double val = ::strtod(p, &valEnd);
+				if(valEnd == p) {
+#pragma omp critical(writeLog)
+					errorLog << "Invalid metric value for OTU '" << otuID << "' in sample " << (j + 1) << endl;
+					in.setstate(std::ios_base::failbit);
+					return in;
+				}
+				if(isNew && val != 0)
+					values.push_back(Triplet<double>(i, j, val));
+				p = valEnd;
+			}
+			if(*p == '\t')
+				p++;
+			if(isNew) {
+				otus.push_back(otuID);
+				otu2Taxon[otuID] = p;
+			}
 		}
 	}
+	metric.resize(otus.size(), N);
+	metric.setFromTriplets(values.begin(), values.end());
+	indexSamples();
+	in.clear(in.rdstate() & ~std::ios_base::failbit); /* reading stopped at EOF */
 
 	return in;
 }
@@ -155,87 +225,167 @@ ostream& OTUTable::saveTable(ostream& out) const {
 	/* output header */
 	out << "otuID\t" << boost::join(samples, "\t") << "\ttaxonomy" << endl;
 
-	/* output each OTU */
+	/* output each OTU, with zeros filled between the non-zero metrics */
 	const size_t M = numOTUs();
-	for(size_t i = 0; i < M; ++i)
-		out << otus[i] << "\t" << metric.row(i).format(fltTabFmt) << "\t" << otu2Taxon.at(otus[i]) << endl;
+	const size_t N = numSamples();
+	const std::streamsize oldPrec = out.precision(NumTraits<double>::digits10()); /* as fltTabFmt */
+	for(size_t i = 0; i < M; ++i) {
+		out << otus[i];
+		SpMatrix::InnerIterator it(metric, i);
+		for(size_t j = 0; j < N; ++j) {
+			out << '\t';
+			if(it && static_cast<size_t> (it.col()) == j) {
+				out << it.value();
+				++it;
+			}
+			else
+				out << '0';
+		}
+		out << "\t" << otu2Taxon.at(otus[i]) << endl;
+	}
+	out.precision(oldPrec);
 
 	return out;
 }
 
-void OTUTable::subsetUniform(size_t min) {
-	for(int j = 0; j < numSamples(); ++j) {
-		double sampleTotal = sumSampleMetric(j);
-		if(sampleTotal <= min) /* not enough reads to subset */
+OTUTable::RNG OTUTable::sampleRNG(size_t j) const {
+	const boost::uint32_t key[] = { rngSeed, static_cast<boost::uint32_t> (j) };
+	boost::random::seed_seq seq(key, key + 2);
+	return RNG(seq);
+}
+
+void OTUTable::subsetUniform(size_t min, int nIter) {
+	assert(nIter > 0);
+	Eigen::SparseMatrix<double> sampleMetric(metric); /* CSC copy, one column per sample */
+	const long N = numSamples();
+#pragma omp parallel for schedule(dynamic)
+	for(long j = 0; j < N; ++j) {
+		double* count = sampleMetric.valuePtr() + sampleMetric.outerIndexPtr()[j];
+		const long nOTU = sampleMetric.outerIndexPtr()[j + 1] - sampleMetric.outerIndexPtr()[j];
+		long sampleTotal = 0;
+		for(long i = 0; i < nOTU; ++i)
+			sampleTotal += static_cast<long> (count[i]);
+		if(sampleTotal <= static_cast<long> (min)) /* not enough reads to subset */
 			continue;
 
-		/* generate an sampling index with length M */
-		std::vector<bool> otuIdx(static_cast<size_t> (sampleTotal), false); /* use the efficient std::vector<bool>, default all false */
-		fill_n(otuIdx.begin(), min, true);
-		boost::random_number_generator<RNG, size_t> gen(rng);
-		boost::random_shuffle(otuIdx, gen);
-		/* subset reads in OTUs without replacement using the random index */
-		for(size_t i = 0, k = 0; i < numOTUs(); ++i) { /* k is the start index of current OTU */
-			size_t N = static_cast<size_t> (metric(i, j));
-			metric(i, j) = std::count(otuIdx.begin() + k, otuIdx.begin() + k + N, true);
-			assert(metric(i, j) <= N);
-			k += N;
+		RNG rng = sampleRNG(j);
+		VectorXd sampled = VectorXd::Zero(nOTU);
+		for(int iter = 0; iter < nIter; ++iter) {
+			/* draw reads of each OTU without replacement from the remaining reads */
+			long nLeft = sampleTotal;
+			long nDraw = min;
+			for(long i = 0; i < nOTU && nDraw > 0; ++i) {
+				const long nRead = static_cast<long> (count[i]);
+				const long k = Math::hypergeometric(nLeft, nRead, nDraw)(rng);
+				sampled(i) += k;
+				nLeft -= nRead;
+				nDraw -= k;
+			}
 		}
+		Map<VectorXd>(count, nOTU) = sampled / nIter;
 	}
+	sampleMetric.prune(0.0); /* remove subsetted zeros */
+	metric = sampleMetric;
 }
 
-void OTUTable::subsetMultinom(size_t min) {
-	const size_t M = numOTUs();
-	double *otuPr = new double[M]; /* raw read sample probabilities */
-	Map<VectorXd> otuPrMap(otuPr, M); /* use a map to access indirectly */
-	otuPrMap.setOnes(); /* use all equal probs by default */
-	ReadDistrib rdist(otuPr, otuPr + M); /* construct the discrete distribution */
-
-	for(int j = 0; j < numSamples(); ++j) {
-		double sampleTotal = sumSampleMetric(j);
+void OTUTable::subsetMultinom(size_t min, int nIter) {
+	assert(nIter > 0);
+	Eigen::SparseMatrix<double> sampleMetric(metric); /* CSC copy, one column per sample */
+	const long N = numSamples();
+#pragma omp parallel for schedule(dynamic)
+	for(long j = 0; j < N; ++j) {
+		double* count = sampleMetric.valuePtr() + sampleMetric.outerIndexPtr()[j];
+		const long nOTU = sampleMetric.outerIndexPtr()[j + 1] - sampleMetric.outerIndexPtr()[j];
+		const double sampleTotal = Map<VectorXd>(count, nOTU).sum();
 		if(sampleTotal <= min) /* not enough reads to subset */
 			continue;
 
-		/** reset rdist probabilities according to current counts */
-		otuPrMap = metric.col(j);
-		rdist.param(ReadParam(otuPr, otuPr + M));
-		/* sample min reads */
-		VectorXd sampled = VectorXd::Zero(M);
-		for(size_t m = 0; m < min; ++m)
-			sampled(rdist(rng))++;
-		metric.col(j) = sampled;
+		RNG rng = sampleRNG(j);
+		VectorXd sampled = VectorXd::Zero(nOTU);
+		for(int iter = 0; iter < nIter; ++iter) {
+			/* split the reads by the conditional probability of each OTU over the remaining OTUs */
+			double prLeft = sampleTotal;
+			long nDraw = min;
+			for(long i = 0; i < nOTU && nDraw > 0; ++i) {
+				const double p = count[i] < prLeft ? count[i] / prLeft : 1.0;
+				const long k = boost::random::binomial_distribution<long>(nDraw, p)(rng);
+				sampled(i) += k;
+				prLeft -= count[i];
+				nDraw -= k;
+			}
+		}
+		Map<VectorXd>(count, nOTU) = sampled / nIter;
 	}
-	delete[] otuPr;
+	sampleMetric.prune(0.0); /* remove unsampled zeros */
+	metric = sampleMetric;
 }
 
-OTUTable& OTUTable::operator+=(const OTUTable& other) {
-	if(empty()) {
-		*this = other;
-		return *this;
+void OTUTable::addIndices(const OTUTable& other, vector<size_t>& sampleTo, vector<size_t>& otuTo) {
+	sampleTo.resize(other.numSamples());
+	for(size_t j = 0; j < other.numSamples(); ++j) {
+		const string& sampleName = other.getSample(j);
+		sampleTo[j] = getSampleIndex(sampleName);
+		if(sampleTo[j] == numSamples()) { /* a new sample */
+			samples.push_back(sampleName);
+			sampleIdx[sampleName] = sampleTo[j];
+		}
 	}
-	if(other.empty())
-		return *this;
-
-	/* add non-existing samples */
-	for(size_t j = 0; j < other.numSamples(); ++j)
-		addSample(other.getSample(j));
-
-	/* add non-existing OTUs */
+	otuTo.resize(other.numOTUs());
 	for(size_t i = 0; i < other.numOTUs(); ++i) {
-		string otuID = other.getOTU(i);
-		addOTU(otuID, other.getTaxon(otuID));
+		const string& otuID = other.getOTU(i);
+		otuTo[i] = getOTUIndex(otuID);
+		if(otuTo[i] == numOTUs()) { /* a new OTU */
+			otus.push_back(otuID);
+			otuIdx[otuID] = otuTo[i];
+			otu2Taxon[otuID] = other.getTaxon(i);
+		}
 	}
+}
 
-	/** merge counts */
-	for(size_t i = 0; i < other.numOTUs(); ++i) {
-		string otuID = other.getOTU(i);
-		int i0 = getOTUIndex(otuID);
-		for(size_t j = 0; j < other.numSamples(); ++j) {
-			int j0 = getSampleIndex(other.getSample(j));
-			metric(i0, j0) += other.numMetric(i, j);
-		}
+void OTUTable::appendValues(const SpMatrix& otuMetric, const vector<size_t>& sampleTo, const vector<size_t>& otuTo,
+		vector<Triplet<double> >& values) {
+	for(SpMatrix::Index i = 0; i < otuMetric.outerSize(); ++i)
+		for(SpMatrix::InnerIterator it(otuMetric, i); it; ++it)
+			values.push_back(Triplet<double>(otuTo[it.row()], sampleTo[it.col()], it.value()));
+}
+
+void OTUTable::appendTable(const OTUTable& other, vector<Triplet<double> >& values) {
+	vector<size_t> sampleTo, otuTo;
+	addIndices(other, sampleTo, otuTo);
+	appendValues(other.metric, sampleTo, otuTo, values);
+}
+
+void OTUTable::setValues(const vector<Triplet<double> >& values) {
+	metric.resize(numOTUs(), numSamples());
+	metric.setFromTriplets(values.begin(), values.end()); /* duplicated values are summed */
+}
+
+OTUTable& OTUTable::merge(vector<OTUTable>& others) {
+	size_t nnz = metric.nonZeros();
+	for(vector<OTUTable>::const_iterator other = others.begin(); other != others.end(); ++other)
+		nnz += other->metric.nonZeros();
+	vector<Triplet<double> > values;
+	values.reserve(nnz);
+
+	/* map every table's indices to this, with its values appended */
+	appendTable(*this, values); /* identical indices */
+	for(vector<OTUTable>::iterator other = others.begin(); other != others.end(); ++other) {
+		appendTable(*other, values);
+		other->clear(); /* release memory early */
 	}
 
+	/* build the merged metric once */
+	setValues(values);
+
+	return *this;
+}
+
+OTUTable& OTUTable::operator+=(const OTUTable& other) {
+	vector<Triplet<double> > values;
+	values.reserve(metric.nonZeros() + other.metric.nonZeros());
+	appendTable(*this, values); /* identical indices */
+	appendTable(other, values);
+	setValues(values);
 	return *this;
 }
 
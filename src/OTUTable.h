@@ -31,13 +31,14 @@
 #include <vector>
 #include <map>
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 #include <iostream>
 #include <stdexcept>
 #include <algorithm>
+#include <ctime>
 #include <boost/algorithm/string.hpp> /* for boost::split */
+#include <boost/unordered_map.hpp>
 #include <boost/random/mersenne_twister.hpp>
-#include <boost/range/algorithm/random_shuffle.hpp>
-#include <boost/random/discrete_distribution.hpp>
 #include "ProgLog.h"
 #include "OTUObserved.h"
 
@@ -55,27 +56,37 @@ using Eigen::MatrixXd;
 using Eigen::VectorXd;
 using Eigen::RowVectorXd;
 
+/**
+ * An OTU table of M OTUs by N samples, stored as a sparse matrix so study-wide tables with mostly zero counts fit in memory
+ * the metric is stored in CSR format (one row per OTU), as OTUs are added and written one by one,
+ * and the OTU and sample indices are hashed by their names
+ */
 class OTUTable {
 public:
 	/* typedefs */
 	typedef map<string, string> otuMap;
+	typedef Eigen::SparseMatrix<double, Eigen::RowMajor> SpMatrix; /* sparse M * N metric in CSR format */
+	typedef boost::unordered_map<string, size_t> IndexMap; /* name to index map */
 	typedef boost::random::mt11213b RNG; /* preferred random number generator type */
-	typedef boost::random::discrete_distribution<size_t> ReadDistrib; /* base (nucleotide) distribution */
-	typedef ReadDistrib::param_type ReadParam; /* read distribution parameters */
 
 	/** constructors */
 	/** default constructor */
-	OTUTable() {  }
+	OTUTable() : rngSeed(std::time(NULL)) {  }
 
 	/** construct an OTUTable with given samples and OTU list */
 	OTUTable(const vector<string>& samples, const vector<string>& otus, const otuMap& otu2Taxon, const MatrixXd& otuMetric) :
-		samples(samples), otus(otus), otu2Taxon(otu2Taxon), metric(otuMetric)
-	{  }
+		samples(samples), otus(otus), otu2Taxon(otu2Taxon), metric(otuMetric.sparseView()), rngSeed(std::time(NULL))
+	{
+		indexSamples();
+		indexOTUs();
+	}
 
 	/** construct an OTUTable with initial samples only */
 	explicit OTUTable(const vector<string>& samples) :
-			samples(samples), metric(0, samples.size())
-	{  }
+			samples(samples), metric(0, samples.size()), rngSeed(std::time(NULL))
+	{
+		indexSamples();
+	}
 
 	/** destructor, do nothing */
 	virtual ~OTUTable() { }
@@ -122,30 +133,33 @@ public:
 	}
 
 	/** get entire OTU metric count */
-	const MatrixXd& getMetric() const {
+	const SpMatrix& getMetric() const {
 		return metric;
 	}
 
+	/** get number of non-zero metrics */
+	size_t numNonZeros() const {
+		return metric.nonZeros();
+	}
+
 	/**
 	 * test whether this OTUTable is relative abundance
 	 * @return  true only if all metrics are no greater than 1
 	 */
-	bool isRelative() const {
-		return (metric.array() <= 1.0).all();
-	}
+	bool isRelative() const;
 
 	/**
 	 * test whether this OTUTable contains a specific sample
 	 */
 	bool hasSample(const string& sampleName) const {
-		return find(samples.begin(), samples.end(), sampleName) != samples.end();
+		return sampleIdx.count(sampleName) > 0;
 	}
 
 	/**
 	 * test whether this OTUTable contains a specific OTU
 	 */
 	bool hasOTU(const string& otuID) const {
-		return find(otus.begin(), otus.end(), otuID) != otus.end();
+		return otuIdx.count(otuID) > 0;
 	}
 
 	/**
@@ -153,7 +167,8 @@ public:
 	 * @return  0..numSamples-1 if found, or numSamples if not
 	 */
 	size_t getSampleIndex(const string& sampleName) const {
-		return find(samples.begin(), samples.end(), sampleName) - samples.begin();
+		IndexMap::const_iterator result = sampleIdx.find(sampleName);
+		return result != sampleIdx.end() ? result->second : numSamples();
 	}
 
 	/**
@@ -161,7 +176,8 @@ public:
 	 * @return  0..numOTUs-1 if found, or numOTUs if not
 	 */
 	size_t getOTUIndex(const string& otuID) const {
-		return find(otus.begin(), otus.end(), otuID) - otus.begin();
+		IndexMap::const_iterator result = otuIdx.find(otuID);
+		return result != otuIdx.end() ? result->second : numOTUs();
 	}
 
 	/**
@@ -198,7 +214,7 @@ public:
 
 	/** get count of given OTU and sample idx */
 	double numMetric(size_t i, size_t j) const {
-		return metric(i, j);
+		return metric.coeff(i, j);
 	}
 
 	/** get count of given OTU and sample */
@@ -254,7 +270,13 @@ public:
 	/** delete an existing sample from this OTUTable using its index
 	 * @param j  sample index
 	 */
-	void removeSample(size_t j);
+	void removeSample(size_t j) {
+		if(j >= numSamples())
+			return;
+		vector<bool> keep(numSamples(), true);
+		keep[j] = false;
+		keepSamples(keep);
+	}
 
 	/**
 	 * add a new OTU into this OTUTable, ignored if already exists
@@ -287,7 +309,13 @@ public:
 	/** delete an existing otuID from this OTUTable at index i, ignored if outside range
 	 * @param i  OTU index
 	 */
-	void removeOTU(size_t i);
+	void removeOTU(size_t i) {
+		if(i >= numOTUs())
+			return;
+		vector<bool> keep(numOTUs(), true);
+		keep[i] = false;
+		keepOTUs(keep);
+	}
 
 	/** delete an existing otuID from this OTUTable, ignored if not exists
 	 * @param otuID  existing OTU ID
@@ -331,9 +359,11 @@ public:
 
 	/**
 	 * set seed for subset functions
+	 * each sample is subset with its own random stream derived from this seed,
+	 * so the results do not depend on the order or the number of threads samples are subset in
 	 */
 	void seed(unsigned newSeed) {
-		rng.seed(newSeed);
+		rngSeed = newSeed;
 	}
 
 	/**
@@ -342,26 +372,31 @@ public:
 	 * samples that have more than min reads will be subsampled
 	 * @param min  min read requirement
 	 * @param method  sampleing method
+	 * @param nIter  number of subsamplings averaged for each sample
 	 * @throw  invalid_argument if the sampling method is not supported
 	 */
-	void subset(size_t min, const string& method) {
+	void subset(size_t min, const string& method, int nIter = 1) {
 		if(method == "uniform")
-			subsetUniform(min);
+			subsetUniform(min, nIter);
 		else if(method == "multinomial")
-			subsetMultinom(min);
+			subsetMultinom(min, nIter);
 		else
 			throw invalid_argument("Unsupported subsetting method '" + method + "'");
 	}
 
 	/**
-	 * subset this OTU table to a minimum read count using uniform sampling
+	 * subset this OTU table to a minimum read count using uniform sampling (without replacement),
+	 * by drawing the reads of each OTU from a sequential multivariate hypergeometric distribution
+	 * samples are subset in parallel if OpenMP is enabled
 	 */
-	void subsetUniform(size_t min);
+	void subsetUniform(size_t min, int nIter = 1);
 
 	/**
-	 * subset this OTU table to a minimum read count using Multinomial sampling
+	 * subset this OTU table to a minimum read count using Multinomial sampling (with replacement),
+	 * by splitting the reads with sequential binomial draws
+	 * samples are subset in parallel if OpenMP is enabled
 	 */
-	void subsetMultinom(size_t min);
+	void subsetMultinom(size_t min, int nIter = 1);
 
 	/**
 	 * load raw table object from input in given format
@@ -393,6 +428,12 @@ public:
 	 */
 	ostream& saveHdf5(ostream& out) const;
 
+	/**
+	 * merge other OTUTables into this one, with their samples and OTUs added in order,
+	 * the merged metric is built only once, and every other table is cleared once merged to release its memory
+	 */
+	OTUTable& merge(vector<OTUTable>& others);
+
 	/** merge this OTUTable with another */
 	OTUTable& operator+=(const OTUTable& other);
 
@@ -400,16 +441,52 @@ public:
 	friend OTUTable operator+(const OTUTable& lhs, const OTUTable& rhs);
 
 private:
+	/** rebuild the sample index */
+	void indexSamples();
+
+	/** rebuild the OTU index */
+	void indexOTUs();
+
+	/** keep only the samples with keep[j] set, in one pass of the metric */
+	void keepSamples(const vector<bool>& keep);
+
+	/** keep only the OTUs with keep[i] set, in one pass of the metric */
+	void keepOTUs(const vector<bool>& keep);
+
+	/**
+	 * add the samples and OTUs of other not in this table, without resizing the metric
+	 * @param sampleTo, otuTo  set to the index in this table of each sample and OTU of other
+	 */
+	void addIndices(const OTUTable& other, vector<size_t>& sampleTo, vector<size_t>& otuTo);
+
+	/** append the non-zero values of a metric as triplets, with its indices mapped */
+	static void appendValues(const SpMatrix& otuMetric, const vector<size_t>& sampleTo, const vector<size_t>& otuTo,
+			vector<Eigen::Triplet<double> >& values);
+
+	/**
+	 * add the samples and OTUs of other not in this table, and append its non-zero values as triplets
+	 * indexed in this table, without resizing the metric
+	 */
+	void appendTable(const OTUTable& other, vector<Eigen::Triplet<double> >& values);
+
+	/** rebuild the metric from the appended triplets, with duplicated values summed */
+	void setValues(const vector<Eigen::Triplet<double> >& values);
+
+	/** get the random number generator of sample j */
+	RNG sampleRNG(size_t j) const;
+
 	/** member fields */
 	vector<string> samples; /* 0..N sample names */
 	vector<string> otus;    /* 0..M OTUs */
 	otuMap otu2Taxon;
-	MatrixXd metric; /* M * N matrix of OTU (relative) abundance metric */
+	IndexMap sampleIdx; /* sample name to index */
+	IndexMap otuIdx;    /* OTU ID to index */
+	SpMatrix metric; /* M * N sparse matrix of OTU (relative) abundance metric, with no explicit zeros */
+	unsigned rngSeed; /* seed of the per-sample random streams */
 
 	/** static fields */
 	static const Eigen::IOFormat dblTabFmt;
 	static const Eigen::IOFormat fltTabFmt;
-	static RNG rng;
 };
 
 inline std::istream& OTUTable::load(istream& in, const string& format) {
@@ -0,0 +1,53 @@
+/*******************************************************************************
+ * This file is part of HmmUFOtu, an HMM and Phylogenetic placement
+ * based tool for Ultra-fast taxonomy assignment and OTU organization
+ * of microbiome sequencing data with species level accuracy.
+ * Copyright (C) 2017  Qi Zheng
+ *
+ * HmmUFOtu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HmmUFOtu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with AlignerBoost.  If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+/*
+ * PDistIndex.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: zhengqi
+ */
+
+#include "PDistIndex.h"
+
+namespace EGriceLab {
+namespace HmmUFOtu {
+
+void PDistIndex::addRef(long id, const DigitalSeq& ref) {
+	assert(ref.getAbc() == seq.getAbc());
+	assert(ref.length() == seq.length());
+	if(hasRef(id))
+		return;
+
+	refIdx[id] = nDiff.size();
+	nDiff.push_back(vector<int>(end - start + 2));
+	nSite.push_back(vector<int>(end - start + 2));
+	vector<int>& d = nDiff.back();
+	vector<int>& N = nSite.back();
+	for(int i = start; i <= end; ++i) {
+		int b1 = seq[i];
+		int b2 = ref[i];
+		bool valid = b1 >= 0 && b2 >= 0;
+		d[i - start + 1] = d[i - start] + (valid && b1 != b2);
+		N[i - start + 1] = N[i - start] + valid;
+	}
+}
+
+} /* namespace HmmUFOtu */
+} /* namespace EGriceLab */
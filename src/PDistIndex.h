@@ -0,0 +1,91 @@
+/*******************************************************************************
+ * This file is part of HmmUFOtu, an HMM and Phylogenetic placement
+ * based tool for Ultra-fast taxonomy assignment and OTU organization
+ * of microbiome sequencing data with species level accuracy.
+ * Copyright (C) 2017  Qi Zheng
+ *
+ * HmmUFOtu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HmmUFOtu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with AlignerBoost.  If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+/*
+ * PDistIndex.h
+ *  cumulative mismatch counts of a seq against a set of reference seqs,
+ *  for p-distances of any sub-region in constant time
+ *  Created on: Oct 19, 2026
+ *      Author: zhengqi
+ */
+
+#ifndef SRC_PDISTINDEX_H_
+#define SRC_PDISTINDEX_H_
+
+#include <vector>
+#include <map>
+#include <cassert>
+#include "DigitalSeq.h"
+
+namespace EGriceLab {
+namespace HmmUFOtu {
+
+using std::vector;
+using std::map;
+
+/**
+ * A per-seq index of the p-distances to a set of aligned reference seqs in a fixed region,
+ * gives the same values as SeqUtils::pDist() on any sub-region
+ */
+class PDistIndex {
+public:
+	/* constructors */
+	/** construct an empty index of seq in region [start, end] */
+	PDistIndex(const DigitalSeq& seq, int start, int end)
+	: seq(seq), start(start), end(end)
+	{  }
+
+	/* member methods */
+	/** test whether a reference seq is indexed */
+	bool hasRef(long id) const {
+		return refIdx.count(id) > 0;
+	}
+
+	/**
+	 * add a reference seq, ignored if already indexed
+	 * @param id  reference id
+	 * @param ref  reference seq, aligned to seq
+	 */
+	void addRef(long id, const DigitalSeq& ref);
+
+	/**
+	 * get the p-distance to an indexed reference seq in sub-region [from, to]
+	 */
+	double pDist(long id, int from, int to) const;
+
+private:
+	const DigitalSeq& seq;
+	int start;
+	int end;
+	map<long, vector<int>::size_type> refIdx; /* index of each reference id */
+	vector<vector<int> > nDiff; /* cumulative number of different sites, with nDiff[k][i] for region [start, start + i) */
+	vector<vector<int> > nSite; /* cumulative number of valid sites */
+};
+
+inline double PDistIndex::pDist(long id, int from, int to) const {
+	assert(start <= from && from <= to && to <= end);
+	const vector<int>::size_type k = refIdx.find(id)->second;
+	return static_cast<double>(nDiff[k][to - start + 1] - nDiff[k][from - start]) /
+			(nSite[k][to - start + 1] - nSite[k][from - start]);
+}
+
+} /* namespace HmmUFOtu */
+} /* namespace EGriceLab */
+
+#endif /* SRC_PDISTINDEX_H_ */
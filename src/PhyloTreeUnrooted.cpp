@@ -67,6 +67,9 @@ const double PhyloTreeUnrooted::MIN_LOGLIK_EXP = DBL_MIN_EXP / 2; /* use half of
 const double PhyloTreeUnrooted::INVALID_LOGLIK = 1;
 const double PhyloTreeUnrooted::LOGLIK_REL_EPS = 1e-6;
 const double PhyloTreeUnrooted::BRANCH_EPS = 1e-5;
+const double PhyloTreeUnrooted::MAX_PLACE_LENGTH = 1;
+const double PhyloTreeUnrooted::BOUND_MIN_LENGTH = 1e-3;
+const double PhyloTreeUnrooted::BOUND_LENGTH_STEP = 1.2;
 
 const string PhyloTreeUnrooted::DOMAIN_PREFIX = "d__";
 const string PhyloTreeUnrooted::KINDOM_PREFIX = "k__";
@@ -293,6 +296,34 @@ void PhyloTreeUnrooted::fixBranchLength(double minLen) {
 	}
 }
 
+PTUnrooted& PTUnrooted::slice(int start, int end) {
+	if(!(0 <= start && start <= end && end < csLen))
+		throw out_of_range("Invalid tree slicing region");
+	const int len = end - start + 1;
+	if(len == csLen) /* nothing to do */
+		return *this;
+
+	/* slice node seqs in place, keeping their abc and names */
+	for(vector<PTUNodePtr>::iterator node = id2node.begin(); node != id2node.end(); ++node) {
+		DigitalSeq& seq = (*node)->seq;
+		if(seq.length() == csLen) {
+			seq.erase(end + 1);
+			seq.erase(0, start);
+		}
+	}
+
+	/* slice all cached messages, including the root one */
+	for(BranchMap::iterator u = node2branch.begin(); u != node2branch.end(); ++u)
+		for(boost::unordered_map<PTUNodePtr, PTUBranch>::iterator v = u->second.begin(); v != u->second.end(); ++v) {
+			Matrix4Xd& loglik = v->second.loglik;
+			if(loglik.cols() == csLen)
+				loglik = loglik.middleCols(start, len).eval();
+		}
+
+	csLen = len;
+	return *this;
+}
+
 void PTUnrooted::updateRootLoglik() {
 	for(int j = 0; j < csLen; ++j)
 		node2branch[root][nullNode].loglik.col(j) = loglik(root, j);
@@ -423,6 +454,7 @@ vector<Matrix4d> PTUnrooted::getModelTraningSetGoldman() const {
 
 vector<Matrix4d> PTUnrooted::getModelTraningSetGojobori() const {
 	vector<Matrix4d> data; // store observed base transition counts
+	RNG rng; /* default seeded for reproducible training data */
 	/* check every node of this tree */
 	for(vector<PTUNodePtr>::const_iterator node = id2node.begin(); node != id2node.end(); ++node) {
 		const vector<PTUNodePtr> children = (*node)->getChildren();
@@ -433,7 +465,7 @@ vector<Matrix4d> PTUnrooted::getModelTraningSetGojobori() const {
 			if(!tipChild->isTip())
 				tipChild.swap(outerChild);
 
-			const DigitalSeq& seq0 = PTUnrooted::randomLeaf(outerChild)->seq;
+			const DigitalSeq& seq0 = PTUnrooted::randomLeaf(outerChild, rng)->seq;
 			const DigitalSeq& seq1 = tipChild->firstChild()->seq;
 			const DigitalSeq& seq2 = tipChild->lastChild()->seq;
 			if(SeqUtils::pDist(seq0, seq1) <= DNASubModel::MAX_PDIST &&
@@ -758,7 +790,7 @@ double PTUnrooted::optimizeBranchLength(const PTUNodePtr& u, const PTUNodePtr& v
 }
 
 double PTUnrooted::optimizeBranchLength(const PTUNodePtr& u, const PTUNodePtr& v, const PTUNodePtr& r, const PTUNodePtr& n,
-		int start, int end) {
+		int start, int end, int* nIter) {
 	assert(root == r && isParent(r, u) && isParent(r, v) && isParent(r, n));
 
 	double wur0 = getBranchLength(u, r);
@@ -773,13 +805,14 @@ double PTUnrooted::optimizeBranchLength(const PTUNodePtr& u, const PTUNodePtr& v
 	double wnr = wnr0;
 
 	/* every outgoing loglik(r,u), loglik(r,v) and loglik(r,n) depends on the other two incoming loglik */
-	for(int iter = 0; iter < MAX_ITER && 0 <= wur && wur <= w0; ++iter) {
+	int iter;
+	for(iter = 0; iter < MAX_ITER && 0 <= wur && wur <= w0; ++iter) {
 //		debugLog << "i: " << iter << " wur: " << wur << " wvr: " << wvr << " wnr: " << wnr << " w0: " << w0 << endl;
 		/* evaluate loglik(r, n) and update wnr */
 		setRoot(n);
 		resetLoglik(r, n, start, end);
 		evaluate(n, start, end);
-		wnr = optimizeBranchLength(r, n, start, end, 1); /* do not use branch length > 1 */
+		wnr = optimizeBranchLength(r, n, start, end, MAX_PLACE_LENGTH); /* do not use too long branch */
 		/* update loglik(r,u) and wur */
 		setRoot(u);
 		resetLoglik(r, u, start, end);
@@ -794,24 +827,31 @@ double PTUnrooted::optimizeBranchLength(const PTUNodePtr& u, const PTUNodePtr& v
 
 		setRoot(r);
 
-		if(::abs(wur - wur0) < BRANCH_EPS && ::abs(wnr - wnr0) < BRANCH_EPS)
+		if(::abs(wur - wur0) < BRANCH_EPS && ::abs(wnr - wnr0) < BRANCH_EPS) {
+			iter++;
 			break;
+		}
 
 		wur0 = wur;
 		wvr0 = wvr;
 		wnr0 = wnr;
 	}
+	if(nIter != NULL)
+		*nIter = iter;
 //	cerr << "Estimated ratio: " << wur / w0 << endl;
 
 	return wur / w0;
 }
 
 PTUnrooted::PTPlacement PTUnrooted::estimateSeq(const DigitalSeq& seq, const PTLoc& loc, const string& method) const {
+	return estimateSeq(seq, loc, SeqUtils::pDist(getNode(loc.id)->getParent()->getSeq(), seq, loc.start, loc.end), method);
+}
+
+PTUnrooted::PTPlacement PTUnrooted::estimateSeq(const DigitalSeq& seq, const PTLoc& loc, double pDist, const string& method) const {
 	assert(seq.length() == csLen);
 	PTUnrooted::PTUNodePtr u = getNode(loc.id);
 	PTUnrooted::PTUNodePtr v = u->getParent();
 	double cDist = loc.dist;
-	double pDist = SeqUtils::pDist(v->getSeq(), seq, loc.start, loc.end);
 	/* estimate ratio */
 	double ratio = cDist / (cDist + pDist);
 	if(::isnan(ratio)) // unable to estimate the ratio
@@ -836,8 +876,63 @@ PTUnrooted::PTPlacement PTUnrooted::estimateSeq(const DigitalSeq& seq, const PTL
 	return PTPlacement(loc.start, loc.end, u, v, ratio, wnr, loglik);
 }
 
+double PTUnrooted::boundLoglik(const DigitalSeq& seq, const PTPlacement& place, double minLoglik) const {
+	assert(seq.length() == csLen);
+	const Vector4d& pi = model->getPi();
+	const Matrix4Xd& U = getBranchLoglik(place.cNode, place.pNode);
+	const Matrix4Xd& V = getBranchLoglik(place.pNode, place.cNode);
+	const int L = place.end - place.start + 1;
+
+	/* branch lengths are scaled by the rates of the dG model, if any */
+	double rMin = 1;
+	double rMax = 1;
+	if(dG != nulldG) {
+		rMin = dG->rate().minCoeff();
+		rMax = dG->rate().maxCoeff();
+	}
+
+	/* bound the incoming messages of u and v at any point of the branch, P(x)U and P(w0 - x)V with x in [0, w0] */
+	const Vector4d pStay0 = Vector4d::Ones();
+	const Vector4d pStay1 = model->Pr(getBranchLength(place.cNode, place.pNode) * rMax).diagonal();
+	Matrix4Xd W(4, L); /* pi * bound(U) * bound(V) at each site, scaled */
+	Matrix4Xd X(4, L); /* scaled N at each site */
+	Matrix4Xd O(4, L); /* max_other of X at each site */
+	double scale = 0;
+	for(int j = place.start; j <= place.end; ++j) {
+		const Vector4d& Uj = U.col(j);
+		const Vector4d& Vj = V.col(j);
+		const Vector4d& Nj = getLeafLoglik(seq, j);
+		const Vector4d u = (Uj.array() - Uj.maxCoeff()).exp();
+		const Vector4d v = (Vj.array() - Vj.maxCoeff()).exp();
+		W.col(j - place.start) = pi.cwiseProduct(bound_conv(u, max_other(u), pStay0, pStay1)).cwiseProduct(bound_conv(v, max_other(v), pStay0, pStay1));
+		X.col(j - place.start) = (Nj.array() - Nj.maxCoeff()).exp();
+		O.col(j - place.start) = max_other(X.col(j - place.start));
+		scale += Uj.maxCoeff() + Vj.maxCoeff() + Nj.maxCoeff();
+	}
+
+	/* bound the incoming message of n P(wnr)N with wnr in each length interval, and take the max,
+	 * starting from the interval of the estimated wnr, which is the most likely one to reach minLoglik */
+	vector<double> lens(1, 0.0); /* interval ends */
+	for(double hi = BOUND_MIN_LENGTH; lens.back() < MAX_PLACE_LENGTH; hi *= BOUND_LENGTH_STEP)
+		lens.push_back(std::min(hi, MAX_PLACE_LENGTH));
+	const size_t nInterval = lens.size() - 1;
+	const size_t first = std::upper_bound(lens.begin(), lens.end() - 1, place.wnr) - lens.begin() - 1;
+	double bound = infV;
+	for(size_t n = 0; n < nInterval && bound < minLoglik; ++n) {
+		const size_t i = n == 0 ? first : n <= first ? n - 1 : n; /* the estimated interval first, then all others in order */
+		const Vector4d pStayLo = model->Pr(lens[i] * rMin).diagonal();
+		const Vector4d pStayHi = model->Pr(lens[i + 1] * rMax).diagonal();
+		double loglik = scale;
+		for(int k = 0; k < L; ++k)
+			loglik += ::log(W.col(k).dot(bound_conv(X.col(k), O.col(k), pStayLo, pStayHi)));
+		if(loglik > bound)
+			bound = loglik;
+	}
+	return bound;
+}
+
 double PTUnrooted::placeSeq(const DigitalSeq& seq, const PTUNodePtr& u, const PTUNodePtr& v,
-		int start, int end, double ratio0, double wnr0) {
+		int start, int end, double ratio0, double wnr0, int* nIter) {
 //	cerr << "Placing seq " << seq.getName() << " at " << u->getId() << "->" << v->getId() <<
 //			" start: " << start << " end: " << end << " ratio0: " << ratio0 << " wnr0: " << wnr0 << endl;
 	assert(seq.length() == csLen); /* make sure this is an aligned seq */
@@ -876,10 +971,10 @@ double PTUnrooted::placeSeq(const DigitalSeq& seq, const PTUNodePtr& u, const PT
 	evaluate(r, start, end); /* n->r evaluated */
 
 	/* joint optimization */
-	optimizeBranchLength(u, v, r, n, start, end);
+	optimizeBranchLength(u, v, r, n, start, end, nIter);
 	initRootLoglik();
-	for(int j = start; j <= end; ++j) /* calculate root loglik */
-		loglik(r, j);
+	for(int j = start; j <= end; ++j) /* calculate and cache root loglik */
+		setBranchLoglik(r, nullNode, j, loglik(r, j));
 
 	return treeLoglik(start, end);
 }
@@ -895,7 +990,7 @@ PTUnrooted PTUnrooted::placeSeq(const DigitalSeq& seq, PTPlacement& place) const
 	double w0 = subtree.getBranchLength(u, v);
 
 	/* update loglik */
-	place.loglik = subtree.placeSeq(seq, u, v, place.start, place.end, ratio0, wnr0);
+	place.loglik = subtree.placeSeq(seq, u, v, place.start, place.end, ratio0, wnr0, &place.nIter);
 	const PTUnrooted::PTUNodePtr& r = subtree.getNode(2);
 	const PTUnrooted::PTUNodePtr& n = subtree.getNode(3);
 
@@ -47,6 +47,8 @@
 #include <boost/unordered_set.hpp>
 #include <boost/iterator.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
 
 #include "AlphabetFactory.h"
 #include "HmmUFOtuConst.h"
@@ -109,6 +111,8 @@ public:
 	typedef boost::unordered_map<PTUNodePtr, boost::unordered_map<PTUNodePtr, PTUBranch> > BranchMap;
 	typedef boost::unordered_map<PTUNodePtr, double> HeightMap;
 
+	typedef boost::random::mt11213b RNG; /* random number generator type used for random node access */
+
 	/**
 	 * A PTUnrooed node that stores its basic information and neighbors
 	 */
@@ -308,26 +312,26 @@ public:
 
 		/**
 		 * get a random leaf as an offspring of this node
-		 * you need to call srand() in your main program
+		 * @param rng  random number generator used to pick children
 		 */
-		const PTUNode* randomLeaf() const {
+		const PTUNode* randomLeaf(RNG& rng) const {
 			const PTUNode* node = this; /* search from this node */
 			while(!node->isLeaf()) {
 				const vector<PTUNodePtr>& children = node->getChildren();
-				node = children[rand() % children.size()].get();
+				node = children[boost::random::uniform_int_distribution<size_t>(0, children.size() - 1)(rng)].get();
 			}
 			return node;
 		}
 
 		/**
 		 * get a random leaf as an offspring of this node
-		 * you need to call srand() in your main program
+		 * @param rng  random number generator used to pick children
 		 */
-		PTUNode* randomLeaf() {
+		PTUNode* randomLeaf(RNG& rng) {
 			PTUNode* node = this; /* search from this node */
 			while(!node->isLeaf()) {
 				const vector<PTUNodePtr>& children = node->getChildren();
-				node = children[rand() % children.size()].get();
+				node = children[boost::random::uniform_int_distribution<size_t>(0, children.size() - 1)(rng)].get();
 			}
 			return node;
 		}
@@ -411,7 +415,7 @@ public:
 		/* constructors */
 	//	/** default constructor */
 		PTPlacement() : start(0), end(0), ratio(nan), wnr(nan), loglik(nan),
-				height(nan), annoDist(nan), qPlace(nan), qTaxon(nan)
+				height(nan), annoDist(nan), qPlace(nan), qTaxon(nan), nIter(0)
 		{  }
 
 		/** construct a placement with basic info and optionally auxilary info */
@@ -422,7 +426,7 @@ public:
 				double qPlace = 0, double qTaxonomy = 0)
 		: start(start), end(end), cNode(cNode), pNode(pNode),
 		  ratio(ratio), wnr(wnr), loglik(loglik),
-		  height(height), annoDist(annoDist), qPlace(qPlace), qTaxon(qTaxonomy)
+		  height(height), annoDist(annoDist), qPlace(qPlace), qTaxon(qTaxonomy), nIter(0)
 		{  }
 
 		/** destructor */
@@ -485,6 +489,7 @@ public:
 		double height;
 		double qPlace;
 		double qTaxon;
+		int nIter; /* iterations used for optimizing branch lengths by placeSeq(), 0 if not placed */
 //		VectorXd treeLoglik; /* optional entire placement tree loglik at every site */
 
 		/** static member fields */
@@ -780,6 +785,14 @@ public:
 	 */
 	void fixBranchLength(double minLen = BRANCH_EPS);
 
+	/**
+	 * slice this tree to the CS columns [start, end] (0-based, inclusive)
+	 * all node sequences and cached branch messages are cut to the region,
+	 * which is exact since the per-site messages are independent
+	 * @return the modified tree
+	 */
+	PTUnrooted& slice(int start, int end);
+
 	/**
 	 * test whether the loglik (message) of node u -> v of all site j has been evaluated
 	 */
@@ -1089,9 +1102,10 @@ public:
 	 * in given CSRegion [start-end], so the total length wur + wrv won't changed, and wnr update accordingly
 	 * before calling this method, all incoming loglik n->r, u->r and v->r should be evaluated
 	 * return the optimized branch ratio (wur / wrv)
+	 * @param nIter  if not NULL, set to the number of iterations used
 	 */
 	double optimizeBranchLength(const PTUNodePtr& u, const PTUNodePtr& v, const PTUNodePtr& r, const PTUNodePtr& n,
-			int start, int end);
+			int start, int end, int* nIter = NULL);
 
 	/**
 	 * iteratively optimize the branch n->r, u->r and v->r jointly
@@ -1112,6 +1126,24 @@ public:
 	 */
 	PTPlacement estimateSeq(const DigitalSeq& seq, const PTLoc& loc, const string& method = "weighted") const;
 
+	/**
+	 * estimate placement given a potential placement loc, with a known p-distance between seq and the parent of the loc node
+	 * @param pDist  p-distance to the parent in the loc region
+	 */
+	PTPlacement estimateSeq(const DigitalSeq& seq, const PTLoc& loc, double pDist, const string& method = "weighted") const;
+
+	/**
+	 * get an upper bound of the loglik that placing seq anywhere on the branch of a placement can reach,
+	 * with any ratio and any new branch length up to MAX_PLACE_LENGTH, as it would be found by placeSeq()
+	 * each incoming message P(w)X is bounded using the diagonal of P(w), which never increases with w in a reversible model,
+	 * the new branch length is bounded in a series of intervals, and the best of them is used
+	 * @param seq  new seq to be placed
+	 * @param place  placement of the branch and region
+	 * @param minLoglik  if given, stop as soon as the bound is known to be no less than it
+	 * @return  a bound no less than the loglik of any placement on this branch, or a partial bound no less than minLoglik
+	 */
+	double boundLoglik(const DigitalSeq& seq, const PTPlacement& place, double minLoglik = inf) const;
+
 	/**
 	 * place an additional seq (n) at given branch in given region [start,end]
 	 * by introducing a new internal root r, which will be placed at the initial ratio0 = wur / (wuv)
@@ -1125,10 +1157,11 @@ public:
 	 * @param end  seq end position (non-gap end)
 	 * @param ratio0  insert point
 	 * @param wnr0  new branch initial length
+	 * @param nIter  if not NULL, set to the number of iterations used in the joint optimization
 	 * @return  the final treeLoglik after placing this read
 	 */
 	double placeSeq(const DigitalSeq& seq, const PTUNodePtr& u, const PTUNodePtr& v,
-			int start, int end, double ratio0, double wnr0);
+			int start, int end, double ratio0, double wnr0, int* nIter = NULL);
 
 	/**
 	 * place an additional seq (n) at given placement position,
@@ -1254,7 +1287,7 @@ public:
 
 	static PTUNodePtr firstLeaf(PTUNodePtr node);
 	static PTUNodePtr lastLeaf(PTUNodePtr node);
-	static PTUNodePtr randomLeaf(PTUNodePtr node);
+	static PTUNodePtr randomLeaf(PTUNodePtr node, RNG& rng);
 
 	/*
 	 * return dot product between two matrix in given region [start, end],
@@ -1274,6 +1307,18 @@ public:
 	/* return dot product between a pi vector and a loglik vector, scale the second vector if necessary */
 	static double dot_product_scaled(const Vector4d& P, const Vector4d& V);
 
+	/** return the max of the other states for each state of a probability vector */
+	static Vector4d max_other(const Vector4d& x);
+
+	/**
+	 * return an upper bound of the transition P(w) * x of a probability vector x, given its max_other() and the diagonal of P(w) at both ends of the range of w,
+	 * as each state keeps between pStay0 and pStay1 of its own value, and gets the rest at most from the best other state
+	 */
+	static Vector4d bound_conv(const Vector4d& x, const Vector4d& other, const Vector4d& pStay0, const Vector4d& pStay1) {
+		return (pStay0.array() * x.array() + (1 - pStay0.array()) * other.array()).max(
+				pStay1.array() * x.array() + (1 - pStay1.array()) * other.array()).matrix();
+	}
+
 	/* return dot product between two loglik vectors, scale both if necessary */
 	static double dot_product_double_scaled(const Vector4d& V1, const Vector4d& V2);
 
@@ -1362,6 +1407,9 @@ public:
 
 	static const double LOGLIK_REL_EPS;
 	static const double BRANCH_EPS;
+	static const double MAX_PLACE_LENGTH; /* max branch length of a newly placed seq */
+	static const double BOUND_MIN_LENGTH; /* first new branch length interval used by boundLoglik() */
+	static const double BOUND_LENGTH_STEP; /* ratio of the consecutive new branch length intervals used by boundLoglik() */
 	static const int MAX_ITER = 100;
 	static const char ANNO_FIELD_SEP = '\t';
 	static const string DOMAIN_PREFIX;
@@ -1461,10 +1509,10 @@ inline PTUnrooted::PTUNodePtr PhyloTreeUnrooted::lastLeaf(PTUNodePtr node) {
 	return node;
 }
 
-inline PTUnrooted::PTUNodePtr PhyloTreeUnrooted::randomLeaf(PTUNodePtr node) {
+inline PTUnrooted::PTUNodePtr PhyloTreeUnrooted::randomLeaf(PTUNodePtr node, RNG& rng) {
 	while(!node->isLeaf()) {
 		const vector<PTUNodePtr>& children = node->getChildren();
-		node = children[rand() % children.size()];
+		node = children[boost::random::uniform_int_distribution<size_t>(0, children.size() - 1)(rng)];
 	}
 	return node;
 }
@@ -1493,6 +1541,15 @@ inline double PTUnrooted::dot_product_scaled(const Vector4d& P, const Vector4d&
 	return ::log(P.dot((V.array() + scale).exp().matrix())) - scale;
 }
 
+inline Vector4d PTUnrooted::max_other(const Vector4d& x) {
+	Vector4d other = Vector4d::Zero();
+	for(Vector4d::Index i = 0; i < x.rows(); ++i)
+		for(Vector4d::Index k = 0; k < x.rows(); ++k)
+			if(k != i && x(k) > other(i))
+				other(i) = x(k);
+	return other;
+}
+
 inline double PTUnrooted::dot_product_double_scaled(const Vector4d& V1, const Vector4d& V2) {
 	double maxV1 = V1.maxCoeff();
 	double maxV2 = V2.maxCoeff();
@@ -76,7 +76,6 @@ int main(int argc, char* argv[]) {
 	/* variable declarations */
 	string dbName, seqFn, msaFn, csfmFn, hmmFn, ptuFn;
 	string outFn;
-	ifstream msaIn, csfmIn, hmmIn, ptuIn;
 	const string seqFmt = "fasta";
 	ofstream of;
 	ifstream seqIn;
@@ -133,32 +132,36 @@ int main(int argc, char* argv[]) {
 		return EXIT_FAILURE;
 	}
 
-	/* set filenames */
-	msaFn = dbName + MSA_FILE_SUFFIX;
-	csfmFn = dbName + CSFM_FILE_SUFFIX;
-	hmmFn = dbName + HMM_FILE_SUFFIX;
-	ptuFn = dbName + PHYLOTREE_FILE_SUFFIX;
+	/* open database */
+	HmmUFOtuDB db;
+	if(!db.open(dbName)) {
+		cerr << "Unable to open HmmUFOtu database '" << dbName << "'" << endl;
+		return EXIT_FAILURE;
+	}
+	msaFn = db.sectionFn(MSA_FILE_SUFFIX);
+	csfmFn = db.sectionFn(CSFM_FILE_SUFFIX);
+	hmmFn = db.sectionFn(HMM_FILE_SUFFIX);
+	ptuFn = db.sectionFn(PHYLOTREE_FILE_SUFFIX);
 
-	/* open inputs */
-	msaIn.open(msaFn.c_str(), ios_base::in | ios_base::binary);
+	istream& msaIn = db.openSection(MSA_FILE_SUFFIX);
 	if(!msaIn) {
 		cerr << "Unable to open MSA data '" << msaFn << "': " << ::strerror(errno) << endl;
 		return EXIT_FAILURE;
 	}
 
-	csfmIn.open(csfmFn.c_str(), ios_base::in | ios_base::binary);
+	istream& csfmIn = db.openSection(CSFM_FILE_SUFFIX);
 	if(!csfmIn) {
 		cerr << "Unable to open CSFM-index '" << csfmFn << "': " << ::strerror(errno) << endl;
 		return EXIT_FAILURE;
 	}
 
-	hmmIn.open(hmmFn.c_str());
+	istream& hmmIn = db.openSection(HMM_FILE_SUFFIX);
 	if(!hmmIn) {
 		cerr << "Unable to open HMM profile '" << hmmFn << "': " << ::strerror(errno) << endl;
 		return EXIT_FAILURE;
 	}
 
-	ptuIn.open(ptuFn.c_str(), ios_base::in | ios_base::binary);
+	istream& ptuIn = db.openSection(PHYLOTREE_FILE_SUFFIX);
 	if(!ptuIn) {
 		cerr << "Unable to open PTU data '" << ptuFn << "': " << ::strerror(errno) << endl;
 		return EXIT_FAILURE;
@@ -20,13 +20,14 @@
 /*
  * hmmufotu-build.cpp
  * Build HmmUFOtu index files from a MSA file
- * Index files include an optional msa file, an hmm file, a csfm file and a ptu file
+ * Index files include an optional msa file, an hmm file and its compiled binary copy, a csfm file and a ptu file
  *  Created on: Feb 2, 2017
  *      Author: zhengqi
  */
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <boost/iostreams/filtering_stream.hpp> /* basic boost streams */
 #include <boost/iostreams/device/file.hpp> /* file sink and source */
@@ -104,7 +105,7 @@ int main(int argc, char* argv[]) {
 	string seqFn, treeFn, dbName, annoFn;
 	ifstream dmIn, smIn, treeIn, annoIn;
 	boost::iostreams::filtering_istream seqIn;
-	ofstream msaOut, csfmOut, hmmOut, ptuOut;
+	ofstream msaOut, csfmOut, hmmOut, hmmbOut, ptuOut;
 	string fmt;
 	string rootName = PhyloTreeUnrooted::DEFAULT_ROOT_NAME;
 	string smType = DEFAULT_SM_TYPE;
@@ -280,6 +281,7 @@ int main(int argc, char* argv[]) {
 	string msaFn = dbName + MSA_FILE_SUFFIX;
 	string csfmFn = dbName + CSFM_FILE_SUFFIX;
 	string hmmFn = dbName + HMM_FILE_SUFFIX;
+	string hmmbFn = dbName + HMM_BIN_FILE_SUFFIX;
 	string ptuFn = dbName + PHYLOTREE_FILE_SUFFIX;
 
 	/* open output files */
@@ -298,6 +300,13 @@ int main(int argc, char* argv[]) {
 		cerr << "Unable to write to '" << hmmFn << "': " << ::strerror(errno) << endl;
 		return EXIT_FAILURE;
 	}
+	if(!noHmm) {
+		hmmbOut.open(hmmbFn.c_str(), ios_base::out | ios_base::binary);
+		if(!hmmbOut.is_open()) {
+			cerr << "Unable to write to '" << hmmbFn << "': " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+	}
 	ptuOut.open(ptuFn.c_str(), ios_base::out | ios_base::binary);
 	if(!ptuOut.is_open()) {
 		cerr << "Unable to write to '" << ptuFn << "': " << ::strerror(errno) << endl;
@@ -485,12 +494,27 @@ int main(int argc, char* argv[]) {
 	infoLog << "CSFM saved" << endl;
 
 	if(!noHmm) {
-		hmmOut << hmm;
+		/* compile the profile as read back from the hmm file, so the costs are identical to loading the hmm file */
+		stringstream hmmBuf;
+		hmmBuf << hmm;
+		const string hmmText = hmmBuf.str();
+		hmmOut << hmmText;
 		if(hmmOut.bad()) {
 			cerr << "Unable to save HMM profile: " << ::strerror(errno) << endl;
 			return EXIT_FAILURE;
 		}
 		infoLog << "Banded HMM profile saved" << endl;
+
+		BandedHMMP7 hmmc;
+		hmmBuf >> hmmc;
+		saveProgInfo(hmmbOut);
+		HmmUFOtuDB::checksum(hmmText.data(), hmmText.length()).save(hmmbOut); /* the hmm file it is compiled from */
+		hmmc.save(hmmbOut);
+		if(hmmbOut.bad()) {
+			cerr << "Unable to save compiled HMM profile: " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+		infoLog << "Compiled HMM profile saved" << endl;
 	}
 
 	saveProgInfo(ptuOut);
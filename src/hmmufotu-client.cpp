@@ -0,0 +1,254 @@
+/*******************************************************************************
+ * This file is part of HmmUFOtu, an HMM and Phylogenetic placement
+ * based tool for Ultra-fast taxonomy assignment and OTU organization
+ * of microbiome sequencing data with species level accuracy.
+ * Copyright (C) 2017  Qi Zheng
+ *
+ * HmmUFOtu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HmmUFOtu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with AlignerBoost.  If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+/*
+ * hmmufotu-client.cpp
+ * Send reads to an hmmufotu server with a pre-loaded database, and write the assignment outputs
+ *  Created on: Oct 19, 2026
+ *      Author: zhengqi
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <boost/iostreams/filtering_stream.hpp> /* basic boost streams */
+#include <boost/iostreams/device/file.hpp> /* file sink and source */
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/device/file_descriptor.hpp> /* for socket connections */
+#include <boost/iostreams/stream.hpp>
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/filter/zlib.hpp> /* for zlib support */
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filter/bzip2.hpp> /* for bzip2 support */
+#include "HmmUFOtu_common.h"
+
+using namespace std;
+using namespace EGriceLab;
+using namespace EGriceLab::HmmUFOtu;
+
+/**
+ * Print introduction of this program
+ */
+void printIntro(void) {
+	cerr << "Assign reads by a running hmmufotu server, which has its database loaded only once at start-up" << endl;
+}
+
+/**
+ * Print the usage information
+ */
+void printUsage(const string& progName) {
+	string ZLIB_SUPPORT;
+#ifdef HAVE_LIBZ
+	ZLIB_SUPPORT = ", support .gz or .bz2 compressed file";
+#endif
+
+	cerr << "Usage:    " << progName << "  <SOCKET> <READ-FILE1> [READ-FILE2] [options]" << endl
+		 << "SOCKET  FILE                   : Unix socket of a server started by 'hmmufotu <HmmUFOtu-DB> --server --listen SOCKET'" << endl
+		 << "READ-FILE1  FILE               : sequence read file for the assembled/forward read" << ZLIB_SUPPORT << endl
+		 << "READ-FILE2  FILE               : sequence read file for the reverse read" << ZLIB_SUPPORT << endl
+		 << "Options:    -o  FILE           : write the assignment output to FILE instead of stdout" << ZLIB_SUPPORT << endl
+		 << "            -a  FILE           : in addition to the assignment output, write the read alignment to FILE" << ZLIB_SUPPORT << endl
+		 << "            --chimera-out  FILE: keep assignment output of chimera reads in FILE" << ZLIB_SUPPORT << endl
+		 << "            -v  FLAG           : enable verbose information, you may set multiple -v for more details" << endl
+		 << "            --version          : show program version and exit" << endl
+		 << "            -h|--help          : print this message and exit" << endl
+		 << "All other options are passed to the server, and have the same meaning as in hmmufotu" << endl;
+}
+
+/**
+ * read the whole content of a (compressed) file
+ * @return  true if success
+ */
+bool readFile(const string& fn, string& data) {
+	boost::iostreams::filtering_istream in;
+#ifdef HAVE_LIBZ
+	if(StringUtils::endsWith(fn, GZIP_FILE_SUFFIX))
+		in.push(boost::iostreams::gzip_decompressor());
+	else if(StringUtils::endsWith(fn, BZIP2_FILE_SUFFIX))
+		in.push(boost::iostreams::bzip2_decompressor());
+	else { }
+#endif
+	in.push(boost::iostreams::file_source(fn));
+	if(in.bad())
+		return false;
+	boost::iostreams::copy(in, boost::iostreams::back_inserter(data));
+	return !in.bad();
+}
+
+/**
+ * write data to a (compressed) file, or stdout if fn is empty
+ * @return  true if success
+ */
+bool writeFile(const string& fn, const string& data) {
+	boost::iostreams::filtering_ostream out;
+#ifdef HAVE_LIBZ
+	if(StringUtils::endsWith(fn, GZIP_FILE_SUFFIX)) /* empty fn won't match */
+		out.push(boost::iostreams::gzip_compressor());
+	else if(StringUtils::endsWith(fn, BZIP2_FILE_SUFFIX)) /* empty fn won't match */
+		out.push(boost::iostreams::bzip2_compressor());
+	else { }
+#endif
+	if(!fn.empty())
+		out.push(boost::iostreams::file_sink(fn));
+	else
+		out.push(std::cout);
+	if(out.bad())
+		return false;
+	out.write(data.c_str(), data.length());
+	out.reset(); /* flush and close */
+	return !out.bad();
+}
+
+int main(int argc, char* argv[]) {
+	/* variable declarations */
+	string sockFn, fwdFn, revFn;
+	string outFn, alnFn, chiOutFn;
+
+	/* parse options */
+	CommandOptions cmdOpts(argc, argv);
+	if(cmdOpts.empty() || cmdOpts.hasOpt("-h") || cmdOpts.hasOpt("--help")) {
+		printIntro();
+		printUsage(argv[0]);
+		return EXIT_SUCCESS;
+	}
+
+	if(cmdOpts.hasOpt("--version")) {
+		printVersion(argv[0]);
+		return EXIT_SUCCESS;
+	}
+
+	if(!(cmdOpts.numMainOpts() == 2 || cmdOpts.numMainOpts() == 3)) {
+		cerr << "Error:" << endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	sockFn = cmdOpts.getMainOpt(0);
+	fwdFn = cmdOpts.getMainOpt(1);
+	if(cmdOpts.numMainOpts() == 3)
+		revFn = cmdOpts.getMainOpt(2);
+
+	if(cmdOpts.hasOpt("-o"))
+		outFn = cmdOpts.getOpt("-o");
+
+	if(cmdOpts.hasOpt("-a"))
+		alnFn = cmdOpts.getOpt("-a");
+
+	if(cmdOpts.hasOpt("--chimera-out"))
+		chiOutFn = cmdOpts.getOpt("--chimera-out");
+
+	if(cmdOpts.hasOpt("-v"))
+		INCREASE_LEVEL(cmdOpts.getOpt("-v").length());
+
+	/* forward the command line without SOCKET to the server, parsed as CommandOptions does */
+	vector<string> args;
+	args.push_back(argv[0]);
+	bool sockSeen = false;
+	for(int i = 1; i < argc; ++i) {
+		if(*argv[i] == '-') { /* a tag name */
+			args.push_back(argv[i]);
+			if(i < argc - 1 && *argv[i+1] != '-') /* a tag value */
+				args.push_back(argv[++i]);
+		}
+		else if(!sockSeen && argv[i] == sockFn) /* the first main opt */
+			sockSeen = true;
+		else
+			args.push_back(argv[i]);
+	}
+
+	/* read inputs */
+	string fwdData, revData;
+	if(!readFile(fwdFn, fwdData)) {
+		cerr << "Unable to read forward seq file '" << fwdFn << "' " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	if(!revFn.empty() && !readFile(revFn, revData)) {
+		cerr << "Unable to read reverse seq file '" << revFn << "' " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+
+	/* connect to server */
+	int fd = connectSocket(sockFn);
+	if(fd < 0) {
+		cerr << "Unable to connect to server socket '" << sockFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	boost::iostreams::stream<boost::iostreams::file_descriptor_source> in(fd, boost::iostreams::never_close_handle);
+	boost::iostreams::stream<boost::iostreams::file_descriptor_sink> out(fd, boost::iostreams::never_close_handle);
+	debugLog << "Connected to server socket '" << sockFn << "'" << endl;
+
+	/* send request */
+	writeBlock(out, ARGS_BLOCK, joinArgs(args));
+	writeBlock(out, FWD_BLOCK, fwdData);
+	if(!revFn.empty())
+		writeBlock(out, REV_BLOCK, revData);
+	writeEndBlock(out);
+	if(!out) {
+		cerr << "Unable to send request to server socket '" << sockFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	fwdData.clear();
+	revData.clear();
+	infoLog << "Request sent, waiting for server response ..." << endl;
+
+	/* get response */
+	string name, data;
+	string assignData, alnData, chiData, errMsg;
+	while(readBlock(in, name, data) && name != END_BLOCK) {
+		if(name == ASSIGN_BLOCK)
+			assignData.swap(data);
+		else if(name == ALIGN_BLOCK)
+			alnData.swap(data);
+		else if(name == CHIMERA_BLOCK)
+			chiData.swap(data);
+		else if(name == ERROR_BLOCK)
+			errMsg.swap(data);
+		else
+			warningLog << "Ignoring unknown response block '" << name << "'" << endl;
+	}
+	::close(fd);
+	if(!in) {
+		cerr << "Incomplete response from server socket '" << sockFn << "'" << endl;
+		return EXIT_FAILURE;
+	}
+	if(!errMsg.empty()) {
+		cerr << errMsg << endl;
+		return EXIT_FAILURE;
+	}
+
+	/* write outputs */
+	if(!writeFile(outFn, assignData)) {
+		cerr << "Unable to write to "
+				<< (!outFn.empty() ? " out file '" + outFn + "' " : "stdout ")
+				<< ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	if(!alnFn.empty() && !writeFile(alnFn, alnData)) {
+		cerr << "Unable to write to align file '" << alnFn << "' " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	if(!chiOutFn.empty() && (cmdOpts.hasOpt("-C") || cmdOpts.hasOpt("--chimera"))) { /* only written in chimera checking */
+		if(!writeFile(chiOutFn, chiData)) {
+			cerr << "Unable to write to '" + chiOutFn + "' " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+	}
+	infoLog << "Assignment done" << endl;
+}
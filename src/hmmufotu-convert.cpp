@@ -0,0 +1,246 @@
+/*******************************************************************************
+ * This file is part of HmmUFOtu, an HMM and Phylogenetic placement
+ * based tool for Ultra-fast taxonomy assignment and OTU organization
+ * of microbiome sequencing data with species level accuracy.
+ * Copyright (C) 2017  Qi Zheng
+ *
+ * HmmUFOtu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HmmUFOtu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with AlignerBoost.  If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+/*
+ * hmmufotu-convert.cpp
+ * Convert hmmufotu assignment outputs between the TSV and the binary format
+ *  Created on: Oct 19, 2026
+ *      Author: zhengqi
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <boost/algorithm/string.hpp> /* for boost string split and join */
+#include <boost/iostreams/filtering_stream.hpp> /* basic boost streams */
+#include <boost/iostreams/device/file.hpp> /* file sink and source */
+#include <boost/iostreams/filter/zlib.hpp> /* for zlib support */
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filter/bzip2.hpp> /* for bzip2 support */
+#include "HmmUFOtu_common.h"
+#include "HmmUFOtu_hmm.h"
+
+using namespace std;
+using namespace EGriceLab;
+using namespace EGriceLab::HmmUFOtu;
+
+/**
+ * Print introduction of this program
+ */
+void printIntro(void) {
+	cerr << "Convert HmmUFOtu assignment outputs between the TSV format and the binary columnar format (" << ASSIGN_BIN_FILE_SUFFIX << ")" << endl;
+}
+
+/**
+ * Print the usage information
+ */
+void printUsage(const string& progName) {
+	string ZLIB_SUPPORT;
+#ifdef HAVE_LIBZ
+	ZLIB_SUPPORT = ", support .gz or .bz2 compressed file";
+#endif
+	cerr << "Usage:    " << progName << "  <INPUT> [options]" << endl
+		 << "INPUT  FILE                   : assignment file, in the binary format if it ends with " << ASSIGN_BIN_FILE_SUFFIX << ", or TSV format otherwise" << ZLIB_SUPPORT << endl
+		 << "Options:    -o  FILE           : write the converted output to FILE instead of stdout, in the binary format if it ends with " << ASSIGN_BIN_FILE_SUFFIX << ", or TSV format otherwise" << ZLIB_SUPPORT << endl
+		 << "            --start  INT       : only convert records from the INT-th (0-based), using the block index of a binary input [0]" << endl
+		 << "            --num  INT         : only convert at most INT records, 0 for all [0]" << endl
+		 << "            --compact-align  FLAG: keep the aligned seqs encoded in the TSV output, as by hmmufotu --compact-align" << endl
+		 << "            -v  FLAG           : enable verbose information, you may set multiple -v for more details" << endl
+		 << "            --version          : show program version and exit" << endl
+		 << "            -h|--help          : print this message and exit" << endl;
+}
+
+/**
+ * Convert a binary input to TSV records
+ * @return  number of records converted
+ */
+long convertBin(istream& in, ostream& out, long start, long num, bool compact) {
+	AssignBinReader reader(in);
+	if(!reader.readHeader())
+		throw std::runtime_error("Not a valid binary assignment file");
+	out << reader.getComments() << reader.getColHeader() << endl;
+
+	long i = 0; /* index of the first record to write in the current block */
+	if(start > 0) {
+		if(!reader.loadIndex())
+			throw std::runtime_error("Unable to load the block index");
+		i = reader.seekRecord(start);
+		if(i < 0) /* beyond the last record */
+			return 0;
+	}
+	long nRecord = 0;
+	AssignBinBlock block;
+	while((num == 0 || nRecord < num) && reader.nextBlock(block)) {
+		for(; i < static_cast<long> (block.size()) && (num == 0 || nRecord < num); ++i) {
+			block.writeTSV(out, i, compact) << endl;
+			nRecord++;
+		}
+		i = 0;
+	}
+	return nRecord;
+}
+
+/**
+ * Convert a TSV input to TSV records
+ * @return  number of records converted
+ */
+long convertTSV(istream& in, ostream& out, long start, long num, bool compact) {
+	string line;
+	int alnIdx = -1; /* column index of the alignment */
+	while(std::getline(in, line) && !line.empty() && line[0] == TSVScanner::COMMENT_CHAR)
+		out << line << endl;
+	if(line.empty())
+		throw std::runtime_error("Missing column header");
+	out << line << endl;
+	vector<string> names;
+	boost::split(names, line, boost::is_any_of("\t"));
+	for(vector<string>::size_type j = 0; j < names.size(); ++j)
+		if(names[j] == "alignment")
+			alnIdx = j;
+
+	long nRecord = 0;
+	for(long k = 0; (num == 0 || nRecord < num) && std::getline(in, line); ++k) {
+		if(k < start)
+			continue;
+		if(compact && alnIdx >= 0) {
+			vector<string> fields;
+			boost::split(fields, line, boost::is_any_of("\t"));
+			if(alnIdx < static_cast<int> (fields.size()))
+				fields[alnIdx] = BandedHMMP7::HmmAlignment::encodeAlign(fields[alnIdx]);
+			line = boost::join(fields, "\t");
+		}
+		out << line << endl;
+		nRecord++;
+	}
+	return nRecord;
+}
+
+int main(int argc, char* argv[]) {
+	/* variable declarations */
+	string inFn, outFn;
+	long start = 0;
+	long num = 0;
+	bool compact = false;
+
+	/* parse options */
+	CommandOptions cmdOpts(argc, argv);
+	if(cmdOpts.empty() || cmdOpts.hasOpt("-h") || cmdOpts.hasOpt("--help")) {
+		printIntro();
+		printUsage(argv[0]);
+		return EXIT_SUCCESS;
+	}
+
+	if(cmdOpts.hasOpt("--version")) {
+		printVersion(argv[0]);
+		return EXIT_SUCCESS;
+	}
+
+	if(cmdOpts.numMainOpts() != 1) {
+		cerr << "Error:" << endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	inFn = cmdOpts.getMainOpt(0);
+
+	if(cmdOpts.hasOpt("-o"))
+		outFn = cmdOpts.getOpt("-o");
+
+	if(cmdOpts.hasOpt("--start"))
+		start = ::atol(cmdOpts.getOptStr("--start"));
+	if(start < 0) {
+		cerr << "--start must be non-negative" << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(cmdOpts.hasOpt("--num"))
+		num = ::atol(cmdOpts.getOptStr("--num"));
+	if(num < 0) {
+		cerr << "--num must be non-negative" << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(cmdOpts.hasOpt("--compact-align"))
+		compact = true;
+
+	if(cmdOpts.hasOpt("-v"))
+		INCREASE_LEVEL(cmdOpts.getOpt("-v").length());
+
+	/* open input */
+	const bool isBinIn = AssignBinIO::isBinFile(inFn);
+	ifstream binIn; /* seekable binary input */
+	boost::iostreams::filtering_istream tsvIn;
+	if(isBinIn) {
+		binIn.open(inFn.c_str(), ios_base::in | ios_base::binary);
+		if(!binIn.is_open()) {
+			cerr << "Unable to open '" << inFn << "': " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+	}
+	else {
+#ifdef HAVE_LIBZ
+		if(StringUtils::endsWith(inFn, GZIP_FILE_SUFFIX))
+			tsvIn.push(boost::iostreams::gzip_decompressor());
+		else if(StringUtils::endsWith(inFn, BZIP2_FILE_SUFFIX))
+			tsvIn.push(boost::iostreams::bzip2_decompressor());
+		else { }
+#endif
+		tsvIn.push(boost::iostreams::file_source(inFn));
+		if(tsvIn.bad()) {
+			cerr << "Unable to open '" << inFn << "': " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* open output */
+	boost::iostreams::filtering_ostream out;
+	if(AssignBinIO::isBinFile(outFn))
+		out.push(AssignBinWriter());
+#ifdef HAVE_LIBZ
+	else if(StringUtils::endsWith(outFn, GZIP_FILE_SUFFIX))
+		out.push(boost::iostreams::gzip_compressor());
+	else if(StringUtils::endsWith(outFn, BZIP2_FILE_SUFFIX))
+		out.push(boost::iostreams::bzip2_compressor());
+#endif
+	else { }
+	if(!outFn.empty())
+		out.push(boost::iostreams::file_sink(outFn, ios_base::out | ios_base::binary));
+	else
+		out.push(std::cout);
+	if(out.bad()) {
+		cerr << "Unable to write to "
+				<< (!outFn.empty() ? "out file '" + outFn + "' " : "stdout ")
+				<< ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+
+	/* convert */
+	try {
+		long nRecord = isBinIn ? convertBin(binIn, out, start, num, compact) : convertTSV(tsvIn, out, start, num, compact);
+		out.reset(); /* finish output */
+		infoLog << nRecord << " assignment records converted" << endl;
+	}
+	catch(const std::exception& e) {
+		cerr << "Unable to convert '" << inFn << "': " << e.what() << endl;
+		return EXIT_FAILURE;
+	}
+}
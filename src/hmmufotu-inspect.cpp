@@ -63,7 +63,6 @@ int main(int argc, char* argv[]) {
 	/* variable declarations */
 	string dbName, msaFn, csfmFn, hmmFn, ptuFn;
 	string treeFn, annoFn, seqFn;
-	ifstream msaIn, csfmIn, hmmIn, ptuIn;
 	ofstream treeOut, annoOut, seqOut;
 	SeqIO seqO;
 	bool showSm = false;
@@ -121,33 +120,39 @@ int main(int argc, char* argv[]) {
 	if(cmdOpts.hasOpt("-n") || cmdOpts.hasOpt("--node"))
 		leafOnly = false;
 
-	msaFn = dbName + MSA_FILE_SUFFIX;
-	csfmFn = dbName + CSFM_FILE_SUFFIX;
-	hmmFn = dbName + HMM_FILE_SUFFIX;
-	ptuFn = dbName + PHYLOTREE_FILE_SUFFIX;
 	string nodePrefix = !useDBName ? "" : dbName + "_";
 
-	/* open inputs */
-	msaIn.open(msaFn.c_str(), ios_base::in | ios_base::binary);
-	if(!msaIn.is_open()) {
+	/* open database */
+	HmmUFOtuDB db;
+	if(!db.open(dbName, true)) { /* verify all sections */
+		cerr << "Unable to open HmmUFOtu database '" << dbName << "'" << endl;
+		return EXIT_FAILURE;
+	}
+	msaFn = db.sectionFn(MSA_FILE_SUFFIX);
+	csfmFn = db.sectionFn(CSFM_FILE_SUFFIX);
+	hmmFn = db.sectionFn(HMM_FILE_SUFFIX);
+	ptuFn = db.sectionFn(PHYLOTREE_FILE_SUFFIX);
+
+	istream& msaIn = db.openSection(MSA_FILE_SUFFIX);
+	if(!msaIn) {
 		cerr << "Unable to open MSA data '" << msaFn << "': " << ::strerror(errno) << endl;
 		return EXIT_FAILURE;
 	}
 
-	csfmIn.open(csfmFn.c_str(), ios_base::in | ios_base::binary);
-	if(!csfmIn.is_open()) {
+	istream& csfmIn = db.openSection(CSFM_FILE_SUFFIX);
+	if(!csfmIn) {
 		cerr << "Unable to open CSFM-index '" << csfmFn << "': " << ::strerror(errno) << endl;
 		return EXIT_FAILURE;
 	}
 
-	hmmIn.open(hmmFn.c_str());
-	if(!hmmIn.is_open()) {
+	istream& hmmIn = db.openSection(HMM_FILE_SUFFIX);
+	if(!hmmIn) {
 		cerr << "Unable to open HMM profile '" << hmmFn << "': " << ::strerror(errno) << endl;
 		return EXIT_FAILURE;
 	}
 
-	ptuIn.open(ptuFn.c_str(), ios_base::in | ios_base::binary);
-	if(!ptuIn.is_open()) {
+	istream& ptuIn = db.openSection(PHYLOTREE_FILE_SUFFIX);
+	if(!ptuIn) {
 		cerr << "Unable to open PTU data '" << ptuFn << "': " << ::strerror(errno) << endl;
 		return EXIT_FAILURE;
 	}
@@ -182,6 +187,14 @@ int main(int argc, char* argv[]) {
 	int csLen;
 	VersionSequence pver;
 
+	if(db.isPacked()) {
+		cout << "Packed database file '" << dbName + DB_FILE_SUFFIX << "'. Format version: " << HmmUFOtuDB::DB_FORMAT_VERSION
+				<< " # of sections: " << db.getSections().size() << endl;
+		for(vector<HmmUFOtuDB::Section>::const_iterator sec = db.getSections().begin(); sec != db.getSections().end(); ++sec)
+			cout << "Section: " << sec->name << " offset: " << sec->offset << " size: " << sec->size
+				 << " CRC32: " << std::hex << sec->crc << std::dec << endl;
+	}
+
 	infoLog << "Inspecting MSA data ..." << endl;
 	if(loadProgInfo(msaIn, pver).bad())
 		return EXIT_FAILURE;
@@ -220,6 +233,11 @@ int main(int argc, char* argv[]) {
 	}
 	cout << "HMM profile read. Name: " << hmm.getName() << " Alphabet: "
 		 << hmm.getNuclAbc()->getAlias() << " Profile size: " << hmm.getProfileSize() << endl;
+	if(!hmm.getOptTag(HMM_CS_OFFSET_TAG).empty()) { /* a sliced database */
+		int csOffset = ::atoi(hmm.getOptTag(HMM_CS_OFFSET_TAG).c_str());
+		cout << "Sliced database. Source CS region: " << (csOffset + 1) << "-" << (csOffset + csLen)
+			 << " Source CS length: " << hmm.getOptTag(HMM_CS_SRCLEN_TAG) << endl;
+	}
 	if(hmm.getProfileSize() > csLen) {
 		cerr << "Error: HMM profile size is found greater than the MSA CS length" << endl;
 		return EXIT_FAILURE;
@@ -8,6 +8,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <cctype>
 #include <cfloat>
 #include <cstdio>
@@ -16,10 +17,8 @@
 #include <cerrno>
 #include <limits>
 #include <vector>
-#include <map>
+#include <utility>
 #include <boost/unordered_map.hpp>
-#include <boost/unordered_set.hpp>
-#include <boost/algorithm/string.hpp> /* for boost string join */
 #include <boost/lexical_cast.hpp>
 #include <boost/iostreams/filtering_stream.hpp> /* basic boost streams */
 #include <boost/iostreams/device/file.hpp> /* file sink and source */
@@ -30,6 +29,10 @@
 #include "HmmUFOtu.h"
 #include "HmmUFOtu_main.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace std;
 using namespace EGriceLab;
 using namespace EGriceLab::HmmUFOtu;
@@ -39,6 +42,8 @@ using namespace Eigen;
 static const double DEFAULT_MIN_Q = 0;
 static const double DEFAULT_MIN_ALN_IDENTITY = 0;
 static const double DEFAULT_MIN_HMM_IDENTITY = 0;
+static const int DEFAULT_NUM_THREADS = 1;
+static const size_t OUTPUT_CHUNK_SIZE = 1 << 16; /* size of formatted placements written at once by each input */
 static const int JPLACE_VERSION = 3;
 static const char *field_names[] = { "edge_num", "likelihood", "like_weight_ratio", "distal_length", "proximal_length", "pendant_length" };
 static const string TREE_NODE_NAME = "tree";
@@ -53,12 +58,57 @@ static const string SM_NODE_NAME = "substitution_model";
 static const string VAR_NODE_NAME = "among_site_rate_variation";
 static const string ANNO_NODE_NAME = "node_taxonomy_annotations";
 
+/** key of identical placements, by edge ID, distal length and like_weight_ratio */
+typedef std::pair<int, std::pair<double, double> > PlaceKey;
+
+/**
+ * Placements collapsed by identical placements, each with all its read names
+ */
+struct PlaceGroups {
+	/** add a placement */
+	void add(const JPlace& place) {
+		const PlaceKey key(place.edgeID, std::make_pair(place.distal_length, place.like_ratio));
+		boost::unordered_map<PlaceKey, size_t>::const_iterator result = index.find(key);
+		if(result == index.end()) {
+			index[key] = places.size();
+			places.push_back(place);
+			names.push_back(vector<string>(1, place.readName));
+		}
+		else
+			names[result->second].push_back(place.readName);
+	}
+
+	/** merge another groups into this, and clear it */
+	void merge(PlaceGroups& other) {
+		for(size_t i = 0; i < other.places.size(); ++i) {
+			const JPlace& place = other.places[i];
+			const PlaceKey key(place.edgeID, std::make_pair(place.distal_length, place.like_ratio));
+			boost::unordered_map<PlaceKey, size_t>::const_iterator result = index.find(key);
+			if(result == index.end()) {
+				index[key] = places.size();
+				places.push_back(place);
+				names.push_back(vector<string>());
+				names.back().swap(other.names[i]);
+			}
+			else
+				names[result->second].insert(names[result->second].end(), other.names[i].begin(), other.names[i].end());
+		}
+		other.places.clear();
+		other.names.clear();
+		other.index.clear();
+	}
+
+	vector<JPlace> places; /* first placement of each group */
+	vector<vector<string> > names; /* read names of each group */
+	boost::unordered_map<PlaceKey, size_t> index;
+};
+
 /**
  * Print introduction of this program
  */
 void printIntro(void) {
 	cerr << "Generate JPlace (JSON phylogenetic-placement) file from HmmUFOtu taxonomy assignment files" << endl
-		 <<	"Warning:  this program need go store all records in memory and could take large amount of RAM, proceed with causion" << endl;
+		 << "Placements are written as they are read, only collapsed placements are kept in memory" << endl;
 }
 
 /**
@@ -70,35 +120,256 @@ void printUsage(const string& progName) {
 	ZLIB_SUPPORT = ", support .gz or .bz2 compressed file";
 	#endif
 	cerr << "Usage:    " << progName << "  <HmmUFOtu-DB> <(INFILE [INFILE2 ...]> [options]" << endl
-		 << "INFILE          INFILE         : assignment file(s) from hmmufotu" << ZLIB_SUPPORT << endl
+		 << "INFILE          INFILE         : assignment file(s) from hmmufotu" << ZLIB_SUPPORT << ", or in the binary format if it ends with " << ASSIGN_BIN_FILE_SUFFIX << endl
 		 << "Options:    -o  FILE           : write the jplace output to FILE instead of stdout" << endl
 		 << "            -q  DBL            : minimum qPlace score (negative log10 posterior error rate) required [" << DEFAULT_MIN_Q << "]" << endl
 		 << "            --aln-iden  DBL    : minimum alignment identity required for assignment result [" << DEFAULT_MIN_ALN_IDENTITY << "]" << endl
 		 << "            --hmm-iden  DBL    : minimum profile-HMM identity required for assignment result [" << DEFAULT_MIN_HMM_IDENTITY << "]" << endl
+		 << "            --collapse  FLAG   : collapse identical placements (same edge, distal length and like_weight_ratio) into one entry with multiple names, reporting the likelihood and pendant length of the first read;" << endl
+		 << "                                 collapsed placements are kept in memory and written after all other placements" << endl
 		 << "            -sm  FLAG          : report the DNA Substitution Model name in metadata used for the phylogenetic placement" << endl
 		 << "            -V|--var  FLAG     : report the among site rate variation model in metadata used for the phylogenetic placement" << endl
 		 << "            -a|--anno  FLAG    : report all node taxonomic annotations in metadata" << endl
+#ifdef _OPENMP
+		 << "            -p|--process INT   : number of threads/cpus used for reading the assignment files, each file is read by one thread;" << endl
+		 << "                                 placements of different files may be interleaved if INT > 1 [" << DEFAULT_NUM_THREADS << "]" << endl
+#endif
 		 << "            -v  FLAG           : enable verbose information, you may set multiple -v for more details" << endl
 		 << "            --version          : show program version and exit" << endl
 		 << "            -h|--help          : print this message and exit" << endl;
 }
 
+/**
+ * Get the placement of an assignment record
+ * @return  true if it is a valid assignment
+ */
+bool getPlacement(JPlace& place, const PTUnrooted& ptu, const BandedHMMP7& hmm, double minQ,
+		const string& rid, int csStart, int csEnd, const string& aln, const string& branch_id,
+		double branch_ratio, long taxon_id, double annoDist, double loglik, double q) {
+	if(!(taxon_id >= 0 && q >= minQ
+			&& alignIdentity(AlphabetFactory::nuclAbc, aln, csStart - 1, csEnd -1)
+	&& hmmIdentity(hmm, aln, csStart - 1, csEnd - 1))) /* not a valid assignment */
+		return false;
+	long pNodeId = 0;
+	long cNodeId = 0;
+	sscanf(branch_id.c_str(), "%ld->%ld", &cNodeId, &pNodeId);
+	PTUnrooted::PTUNodePtr cNode = ptu.getNode(cNodeId);
+	PTUnrooted::PTUNodePtr pNode = ptu.getNode(pNodeId);
+	place = JPlace(ptu.getEdgeID(cNode, pNode), rid, ptu.getBranchLength(cNode, pNode),
+			branch_ratio, loglik, annoDist, q);
+	return true;
+}
+
+/**
+ * Append a placement entry with a one-row placement matrix and the given read names to buf
+ */
+void appendPlacement(string& buf, const JPlace& place, const string* nameBegin, const string* nameEnd) {
+	buf += "\t\t{\"" + PLACEMENT_NODE_NAME + "\" : [[";
+	buf += Json::valueToString(static_cast<Json::LargestInt> (place.edgeID));
+	buf += ", " + Json::valueToString(place.likelihood);
+	buf += ", " + Json::valueToString(place.like_ratio);
+	buf += ", " + Json::valueToString(place.distal_length);
+	buf += ", " + Json::valueToString(place.proximal_length);
+	buf += ", " + Json::valueToString(place.pendant_length);
+	buf += "]], \"" + READNAME_NODE_NAME + "\" : [";
+	for(const string* name = nameBegin; name != nameEnd; ++name) {
+		if(name != nameBegin)
+			buf += ", ";
+		buf += Json::valueToQuotedString(name->c_str());
+	}
+	buf += "]}";
+}
+
+/**
+ * Writer of the placements of one input, formatting them into a buffer and writing it to the shared output in chunks,
+ * or adding them to its own groups if collapsing
+ */
+class PlacementWriter {
+public:
+	/** construct a writer to out, with nWritten the total placements written to out by all writers */
+	PlacementWriter(ostream& out, long& nWritten, bool collapse)
+	: out(out), nWritten(nWritten), collapse(collapse), nBuffered(0)
+	{  }
+
+	/** destructor, flush remaining placements */
+	~PlacementWriter() {
+		flush();
+	}
+
+	/** add a valid placement */
+	void add(const JPlace& place) {
+		if(collapse) {
+			groups.add(place);
+			return;
+		}
+		if(nBuffered > 0)
+			buf += ",\n";
+		appendPlacement(buf, place, &place.readName, &place.readName + 1);
+		nBuffered++;
+		if(buf.length() >= OUTPUT_CHUNK_SIZE)
+			flush();
+	}
+
+	/** write buffered placements to the output */
+	void flush();
+
+	/** get the collapsed placements */
+	PlaceGroups& getGroups() {
+		return groups;
+	}
+
+private:
+	ostream& out;
+	long& nWritten;
+	bool collapse;
+	string buf;
+	long nBuffered;
+	PlaceGroups groups;
+};
+
+void PlacementWriter::flush() {
+	if(nBuffered == 0)
+		return;
+#pragma omp critical(writeOutput)
+	{
+		if(nWritten > 0)
+			out << ",\n";
+		out << buf;
+		nWritten += nBuffered;
+	}
+	buf.clear();
+	nBuffered = 0;
+}
+
+/**
+ * Add placements of all valid records in a binary assignment input, only the required columns are loaded
+ * @throw std::runtime_error if the input is corrupted or misses required columns
+ */
+void addBinPlacements(AssignBinReader& reader, PlacementWriter& writer, const PTUnrooted& ptu, const BandedHMMP7& hmm, double minQ) {
+	const char* names[] = { "id", "CS_start", "CS_end", "alignment", "branch_id", "branch_ratio", "taxon_id", "anno_dist", "loglik", "Q_placement" };
+	const int N = sizeof(names) / sizeof(*names);
+	int cols[N];
+	for(int k = 0; k < N; ++k)
+		if((cols[k] = reader.getColIdx(names[k])) < 0)
+			throw std::runtime_error(string("Missing required column '") + names[k] + "'");
+	reader.selectCols(vector<string>(names, names + N));
+
+	string aln;
+	JPlace place;
+	AssignBinBlock block;
+	while(reader.nextBlock(block)) {
+		for(size_t i = 0; i < block.size(); ++i) {
+			const char* code = block.getStr(cols[3], i);
+			BandedHMMP7::HmmAlignment::decodeAlign(code, code + block.getStrLen(cols[3], i), aln);
+			if(getPlacement(place, ptu, hmm, minQ, block.getStr(cols[0], i),
+					block.getInts(cols[1])[i], block.getInts(cols[2])[i], aln, block.getStr(cols[4], i),
+					block.getReals(cols[5])[i], block.getInts(cols[6])[i], block.getReals(cols[7])[i],
+					block.getReals(cols[8])[i], block.getReals(cols[9])[i]))
+				writer.add(place);
+		}
+	}
+}
+
+/**
+ * Add placements of all valid records in an assignment input file
+ * @return  true if the file is processed successfully
+ */
+bool addPlacements(const string& infn, PlacementWriter& writer, const PTUnrooted& ptu, const BandedHMMP7& hmm, double minQ) {
+#pragma omp critical(writeLog)
+	infoLog << "Processing " << infn << " ..." << endl;
+	if(AssignBinIO::isBinFile(infn)) {
+		ifstream binIn(infn.c_str(), ios_base::in | ios_base::binary);
+		if(!binIn.is_open()) {
+#pragma omp critical(writeLog)
+			cerr << "Unable to open assignment input file '" << infn << "' " << ::strerror(errno) << endl;
+			return false;
+		}
+		AssignBinReader reader(binIn);
+		if(!reader.readHeader()) {
+#pragma omp critical(writeLog)
+			cerr << "Invalid binary assignment input file '" << infn << "'" << endl;
+			return false;
+		}
+		/* check program info */
+		std::istringstream infoIn(reader.getComments());
+		bool isValid;
+#pragma omp critical(writeLog)
+		isValid = !readProgInfo(infoIn).bad();
+		if(!isValid)
+			return false;
+		try {
+			addBinPlacements(reader, writer, ptu, hmm, minQ);
+		}
+		catch(const std::runtime_error& e) {
+#pragma omp critical(writeLog)
+			cerr << "Invalid binary assignment input file '" << infn << "': " << e.what() << endl;
+			return false;
+		}
+		return true;
+	}
+
+	boost::iostreams::filtering_istream in;
+
+#ifdef HAVE_LIBZ
+	if(StringUtils::endsWith(infn, GZIP_FILE_SUFFIX))
+		in.push(boost::iostreams::gzip_decompressor());
+	else if(StringUtils::endsWith(infn, BZIP2_FILE_SUFFIX))
+		in.push(boost::iostreams::bzip2_decompressor());
+	else { }
+#endif
+
+	in.push(boost::iostreams::file_source(infn));
+	if(in.bad()) {
+#pragma omp critical(writeLog)
+		cerr << "Unable to open assignment input file '" << infn << "' " << ::strerror(errno) << endl;
+		return false;
+	}
+
+	/* check program info */
+	bool isValid;
+#pragma omp critical(writeLog)
+	isValid = !readProgInfo(in).bad();
+	if(!isValid)
+		return false;
+
+	JPlace place;
+	TSVScanner tsvIn(in, true);
+	while(tsvIn.hasNext()) {
+		const TSVRecord& record = tsvIn.nextRecord();
+
+		const string& rid = record.getFieldByName("id");
+		int csStart = ::atoi(record.getFieldByName("CS_start").c_str());
+		int csEnd = ::atoi(record.getFieldByName("CS_end").c_str());
+		const string& aln = BandedHMMP7::HmmAlignment::decodeAlign(record.getFieldByName("alignment"));
+		const string& branch_id = record.getFieldByName("branch_id");
+		double branch_ratio = ::atof(record.getFieldByName("branch_ratio").c_str());
+		const long taxon_id = ::atol(record.getFieldByName("taxon_id").c_str());
+		double annoDist = ::atof(record.getFieldByName("anno_dist").c_str());
+		double loglik = ::atof(record.getFieldByName("loglik").c_str());
+		double q = ::atof(record.getFieldByName("Q_placement").c_str());
+
+		if(getPlacement(place, ptu, hmm, minQ, rid, csStart, csEnd, aln, branch_id,
+				branch_ratio, taxon_id, annoDist, loglik, q))
+			writer.add(place);
+	} /* end each record */
+	return true;
+}
+
 int main(int argc, char* argv[]) {
 	/* variable declarations */
 	string dbName, hmmFn, ptuFn;
 	vector<string> inFiles;
 	string outFn;
-	ifstream hmmIn, ptuIn;
 	ofstream of;
 
-	Json::Value jptree; /* create the root */
-
 	double minQ = DEFAULT_MIN_Q;
 	double minAlnIden = DEFAULT_MIN_ALN_IDENTITY;
 	double minHmmIden = DEFAULT_MIN_HMM_IDENTITY;
+	bool collapse = false;
 	bool showSm = false;
 	bool showVar = false;
 	bool showAnno = false;
+	int nThreads = DEFAULT_NUM_THREADS;
 
 	/* parse options */
 	CommandOptions cmdOpts(argc, argv);
@@ -135,6 +406,9 @@ int main(int argc, char* argv[]) {
 	if(cmdOpts.hasOpt("--hmm-iden"))
 		minHmmIden = ::atof(cmdOpts.getOptStr("--hmm-iden"));
 
+	if(cmdOpts.hasOpt("--collapse"))
+		collapse = true;
+
 	if(cmdOpts.hasOpt("-sm"))
 		showSm = true;
 	if(cmdOpts.hasOpt("-V") || cmdOpts.hasOpt("--var"))
@@ -143,6 +417,13 @@ int main(int argc, char* argv[]) {
 	if(cmdOpts.hasOpt("-a") || cmdOpts.hasOpt("--anno"))
 		showAnno = true;
 
+#ifdef _OPENMP
+	if(cmdOpts.hasOpt("-p"))
+		nThreads = ::atoi(cmdOpts.getOptStr("-p"));
+	if(cmdOpts.hasOpt("--process"))
+		nThreads = ::atoi(cmdOpts.getOptStr("--process"));
+#endif
+
 	if(cmdOpts.hasOpt("-v"))
 		INCREASE_LEVEL(cmdOpts.getOpt("-v").length());
 
@@ -151,19 +432,32 @@ int main(int argc, char* argv[]) {
 		cerr << "-q must be non-negative" << endl;
 		return EXIT_FAILURE;
 	}
+#ifdef _OPENMP
+	if(!(nThreads > 0)) {
+		cerr << "-p|--process must be positive" << endl;
+		return EXIT_FAILURE;
+	}
+	omp_set_num_threads(nThreads);
+#endif
 
 	/* set filenames */
-	hmmFn = dbName + HMM_FILE_SUFFIX;
-	ptuFn = dbName + PHYLOTREE_FILE_SUFFIX;
 
-	/* open inputs */
-	hmmIn.open(hmmFn.c_str());
+	/* open database */
+	HmmUFOtuDB db;
+	if(!db.open(dbName)) {
+		cerr << "Unable to open HmmUFOtu database '" << dbName << "'" << endl;
+		return EXIT_FAILURE;
+	}
+	hmmFn = db.sectionFn(HMM_FILE_SUFFIX);
+	ptuFn = db.sectionFn(PHYLOTREE_FILE_SUFFIX);
+
+	istream& hmmIn = db.openSection(HMM_FILE_SUFFIX);
 	if(!hmmIn) {
 		cerr << "Unable to open HMM profile '" << hmmFn << "': " << ::strerror(errno) << endl;
 		return EXIT_FAILURE;
 	}
 
-	ptuIn.open(ptuFn.c_str(), ios_base::in | ios_base::binary);
+	istream& ptuIn = db.openSection(PHYLOTREE_FILE_SUFFIX);
 	if(!ptuIn) {
 		cerr << "Unable to open PTU data '" << ptuFn << "': " << ::strerror(errno) << endl;
 		return EXIT_FAILURE;
@@ -198,112 +492,77 @@ int main(int argc, char* argv[]) {
 	}
 	infoLog << "Phylogenetic tree loaded" << endl;
 
-	/* add tree structure */
-	jptree[TREE_NODE_NAME] = ptu.toJPlaceTreeStr(ptu.getRoot()) + ";";
-	Json::Value placements_list;
-
-	/* process input files */
-	for(vector<string>::const_iterator infn = inFiles.begin(); infn != inFiles.end(); ++infn) {
-		infoLog << "Processing " << *infn << " ..." << endl;
-		boost::iostreams::filtering_istream in;
-
-#ifdef HAVE_LIBZ
-		if(StringUtils::endsWith(*infn, GZIP_FILE_SUFFIX))
-			in.push(boost::iostreams::gzip_decompressor());
-		else if(StringUtils::endsWith(*infn, BZIP2_FILE_SUFFIX))
-			in.push(boost::iostreams::bzip2_decompressor());
-		else { }
-#endif
-
-		in.push(boost::iostreams::file_source(*infn));
-		if(in.bad()) {
-			cerr << "Unable to open assignment input file '" << *infn << "' " << ::strerror(errno) << endl;
-			return EXIT_FAILURE;
+	/* write tree structure and start the placements list */
+	out << "{" << endl
+		<< "\t\"" << TREE_NODE_NAME << "\" : " << Json::valueToQuotedString((ptu.toJPlaceTreeStr(ptu.getRoot()) + ";").c_str()) << "," << endl
+		<< "\t\"" << PLACEMENT_LIST_NODE_NAME << "\" : [" << endl;
+
+	/* process input files, writing placements as they are read */
+	const int K = inFiles.size();
+	long nWritten = 0;
+	PlaceGroups groups;
+	bool isFailed = false;
+#pragma omp parallel for schedule(dynamic)
+	for(int k = 0; k < K; ++k) {
+		PlacementWriter writer(out, nWritten, collapse);
+		if(!addPlacements(inFiles[k], writer, ptu, hmm, minQ)) {
+#pragma omp critical(writeLog)
+			isFailed = true;
+		}
+		else if(collapse) {
+#pragma omp critical(mergeGroups)
+			groups.merge(writer.getGroups());
 		}
+	}
+	if(isFailed)
+		return EXIT_FAILURE;
 
-		/* check program info */
-		if(readProgInfo(in).bad())
-			return EXIT_FAILURE;
+	/* write collapsed placements */
+	if(collapse) {
+		string buf;
+		for(size_t i = 0; i < groups.places.size(); ++i) {
+			if(nWritten++ > 0)
+				buf += ",\n";
+			appendPlacement(buf, groups.places[i], &groups.names[i][0], &groups.names[i][0] + groups.names[i].size());
+			if(buf.length() >= OUTPUT_CHUNK_SIZE) {
+				out << buf;
+				buf.clear();
+			}
+		}
+		out << buf;
+		infoLog << groups.places.size() << " collapsed placements written" << endl;
+	}
+	else
+		infoLog << nWritten << " placements written" << endl;
 
-		TSVScanner tsvIn(in, true);
-		while(tsvIn.hasNext()) {
-			const TSVRecord& record = tsvIn.nextRecord();
-
-			string rid = record.getFieldByName("id");
-			int csStart = ::atoi(record.getFieldByName("CS_start").c_str());
-			int csEnd = ::atoi(record.getFieldByName("CS_end").c_str());
-			const string& aln = record.getFieldByName("alignment");
-			const string& branch_id = record.getFieldByName("branch_id");
-			double branch_ratio = ::atof(record.getFieldByName("branch_ratio").c_str());
-			const long taxon_id = ::atol(record.getFieldByName("taxon_id").c_str());
-			double annoDist = ::atof(record.getFieldByName("anno_dist").c_str());
-			double loglik = ::atof(record.getFieldByName("loglik").c_str());
-			double q = ::atof(record.getFieldByName("Q_placement").c_str());
-
-			if(taxon_id >= 0 && q >= minQ
-					&& alignIdentity(AlphabetFactory::nuclAbc, aln, csStart - 1, csEnd -1)
-			&& hmmIdentity(hmm, aln, csStart - 1, csEnd - 1)) { /* a valid assignment */
-				long pNodeId = 0;
-				long cNodeId = 0;
-				sscanf(branch_id.c_str(), "%d->%d", &cNodeId, &pNodeId);
-				PTUnrooted::PTUNodePtr cNode = ptu.getNode(cNodeId);
-				PTUnrooted::PTUNodePtr pNode = ptu.getNode(pNodeId);
-				JPlace place(ptu.getEdgeID(cNode, pNode), rid, ptu.getBranchLength(cNode, pNode),
-						branch_ratio, loglik, annoDist, q);
-
-				Json::Value place_node;
-
-				/* add a one-row placement matrix */
-				Json::Value pmatrix;
-				pmatrix[0].append(place.edgeID);
-				pmatrix[0].append(place.likelihood);
-				pmatrix[0].append(place.like_ratio);
-				pmatrix[0].append(place.distal_length);
-				pmatrix[0].append(place.proximal_length);
-				pmatrix[0].append(place.pendant_length);
-
-				place_node[PLACEMENT_NODE_NAME] = pmatrix;
-
-				/* add a one-element read name list */
-				Json::Value read_node;
-				read_node.append(place.readName);
-				place_node[READNAME_NODE_NAME] = read_node;
-
-				/* add this place_node to place_list */
-				placements_list.append(place_node);
-			} /* end if */
-		} /* end each record */
-	} /* end eachi file */
-	/* add placements_list */
-	jptree[PLACEMENT_LIST_NODE_NAME] = placements_list;
-
-	/* add mendatory metadata */
-	jptree[VERSION_NODE_NAME] = JPLACE_VERSION;
+	/* end the placements list and write mendatory metadata */
+	out << endl << "\t]," << endl
+		<< "\t\"" << VERSION_NODE_NAME << "\" : " << JPLACE_VERSION << "," << endl
+		<< "\t\"" << FIELD_NODE_NAME << "\" : [";
 	for(const char** name = field_names; name != field_names + sizeof(field_names)/sizeof(*field_names); ++name)
-		jptree[FIELD_NODE_NAME].append(*name);
+		out << (name != field_names ? ", " : "") << Json::valueToQuotedString(*name);
+	out << "]," << endl;
 
-	/* add optional metadata */
-	Json::Value metadata;
-	metadata[INVOCATION_NODE_NAME] = cmdOpts.getCmdStr();
+	/* write optional metadata */
+	out << "\t\"" << METADATA_NODE_NAME << "\" : {" << endl
+		<< "\t\t\"" << INVOCATION_NODE_NAME << "\" : " << Json::valueToQuotedString(cmdOpts.getCmdStr().c_str());
 	if(showSm)
-		metadata[SM_NODE_NAME] = ptu.getModel()->modelType();
+		out << "," << endl << "\t\t\"" << SM_NODE_NAME << "\" : " << Json::valueToQuotedString(ptu.getModel()->modelType().c_str());
 
-	if(showSm)
-		metadata[VAR_NODE_NAME] = ptu.isVar() ? "Discrete Gamma model" : "none";
+	if(showVar)
+		out << "," << endl << "\t\t\"" << VAR_NODE_NAME << "\" : " << Json::valueToQuotedString(ptu.isVar() ? "Discrete Gamma model" : "none");
 
 	if(showAnno) {
 		const vector<PTUnrooted::PTUNodePtr>& allNodes = ptu.getNodes();
-		Json::Value anno_list;
+		out << "," << endl << "\t\t\"" << ANNO_NODE_NAME << "\" : {";
 		for(vector<PTUnrooted::PTUNodePtr>::const_iterator node = allNodes.begin(); node != allNodes.end(); ++node)
-			anno_list[boost::lexical_cast<string>((*node)->getId())] = (*node)->getAnno();
-		metadata[ANNO_NODE_NAME] = anno_list;
+			out << (node != allNodes.begin() ? "," : "") << endl << "\t\t\t\"" << (*node)->getId() << "\" : "
+				<< Json::valueToQuotedString((*node)->getAnno().c_str());
+		out << endl << "\t\t}";
+	}
+	out << endl << "\t}" << endl << "}" << endl;
+	if(out.bad()) {
+		cerr << "Unable to write the jplace output: " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
 	}
-	jptree[METADATA_NODE_NAME] = metadata;
-
-
-	/* write jptree */
-    out << jptree << endl;
 }
-
-
-
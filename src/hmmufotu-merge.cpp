@@ -18,12 +18,17 @@
 #include "HmmUFOtu.h"
 #include "HmmUFOtu_main.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace std;
 using namespace EGriceLab;
 using namespace EGriceLab::HmmUFOtu;
 
 /* default values */
 static const string TABLE_FORMAT = "table";
+static const int DEFAULT_NUM_THREADS = 1;
 typedef boost::unordered_set<PTUnrooted::PTUNodePtr> OTUSet;
 
 
@@ -43,6 +48,9 @@ void printUsage(const string& progName) {
 		 << "Options:    -o  FILE           : write merged OTU to FILE instead of stdout" << endl
 		 << "            -t  FILE           : OTU tree output" << endl
 		 << "            --db  STR          : database name (prefix) used to generate these OTUs, required only if -t is requested" << endl
+#ifdef _OPENMP
+		 << "            -p|--process INT   : number of threads/cpus used for reading the OTU files, each file is read by one thread [" << DEFAULT_NUM_THREADS << "]" << endl
+#endif
 		 << "            -v  FLAG           : enable verbose information, you may set multiple -v for more details" << endl
 		 << "            --version          : show program version and exit" << endl
 		 << "            -h|--help          : print this message and exit" << endl;
@@ -52,8 +60,8 @@ int main(int argc, char* argv[]) {
 	string dbName, ptuFn;
 	vector<string> inFiles;
 	string otuFn, treeFn;
-	ifstream ptuIn;
 	ofstream otuOut, treeOut;
+	int nThreads = DEFAULT_NUM_THREADS;
 
 	/* parse options */
 	CommandOptions cmdOpts(argc, argv);
@@ -85,6 +93,13 @@ int main(int argc, char* argv[]) {
 	if(cmdOpts.hasOpt("--db"))
 		dbName = cmdOpts.getOpt("--db");
 
+#ifdef _OPENMP
+	if(cmdOpts.hasOpt("-p"))
+		nThreads = ::atoi(cmdOpts.getOptStr("-p"));
+	if(cmdOpts.hasOpt("--process"))
+		nThreads = ::atoi(cmdOpts.getOptStr("--process"));
+#endif
+
 	if(cmdOpts.hasOpt("-v"))
 		INCREASE_LEVEL(cmdOpts.getOpt("-v").length());
 
@@ -93,12 +108,13 @@ int main(int argc, char* argv[]) {
 		cerr << "--db is required when -t is requested" << endl;
 		return EXIT_FAILURE;
 	}
-
-	/* set filenames */
-	ptuFn = dbName + PHYLOTREE_FILE_SUFFIX;
-
-	/* open inputs */
-
+#ifdef _OPENMP
+	if(!(nThreads > 0)) {
+		cerr << "-p|--process must be positive" << endl;
+		return EXIT_FAILURE;
+	}
+	omp_set_num_threads(nThreads);
+#endif
 
 	/* open outputs */
 	if(!otuFn.empty()) {
@@ -116,17 +132,22 @@ int main(int argc, char* argv[]) {
 			cerr << "Unable to write to '" << treeFn << "': " << ::strerror(errno) << endl;
 			return EXIT_FAILURE;
 		}
-		/* only open PTU when tree is requested */
-		ptuIn.open(ptuFn.c_str(), ios_base::in | ios_base::binary);
-		if(!ptuIn.is_open()) {
-			cerr << "Unable to open PTU data '" << ptuFn << "': " << ::strerror(errno) << endl;
-			return EXIT_FAILURE;
-		}
 	}
 
 	PTUnrooted ptu;
-	/* loading database file when required */
-	if(ptuIn.is_open()) {
+	/* only open and load PTU when tree is requested */
+	HmmUFOtuDB db;
+	if(!treeFn.empty()) {
+		if(!db.open(dbName)) {
+			cerr << "Unable to open HmmUFOtu database '" << dbName << "'" << endl;
+			return EXIT_FAILURE;
+		}
+		ptuFn = db.sectionFn(PHYLOTREE_FILE_SUFFIX);
+		istream& ptuIn = db.openSection(PHYLOTREE_FILE_SUFFIX);
+		if(!ptuIn) {
+			cerr << "Unable to open PTU data '" << ptuFn << "': " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
 		if(loadProgInfo(ptuIn).bad())
 			return EXIT_FAILURE;
 		ptu.load(ptuIn);
@@ -137,24 +158,43 @@ int main(int argc, char* argv[]) {
 		infoLog << "Phylogenetic tree loaded" << endl;
 	}
 
+	/* read OTUTables, each by one thread */
+	infoLog << "Reading OTUTables" << endl;
+	const int K = inFiles.size();
+	vector<OTUTable> otuTables(K);
+	bool isFailed = false;
+#pragma omp parallel for schedule(dynamic)
+	for(int k = 0; k < K; ++k) {
+		const string& inFn = inFiles[k];
+		ifstream otuIn(inFn.c_str());
+		bool isValid = otuIn.is_open();
+		if(!isValid) {
+#pragma omp critical(writeLog)
+			cerr << "Unable to open '" << inFn << "': " << ::strerror(errno) << endl;
+		}
+		else {
+#pragma omp critical(writeLog)
+			{
+				infoLog << inFn << endl;
+				isValid = !readProgInfo(otuIn).bad();
+			}
+		}
+		if(isValid && otuTables[k].load(otuIn, TABLE_FORMAT).fail()) {
+#pragma omp critical(writeLog)
+			cerr << "Invalid OTU table '" << inFn << "'" << endl;
+			isValid = false;
+		}
+		if(!isValid)
+#pragma omp critical(writeLog)
+			isFailed = true;
+	}
+	if(isFailed)
+		return EXIT_FAILURE;
+
 	/* merge OTUTables */
 	infoLog << "Merging OTUTables" << endl;
 	OTUTable otuMerged;
-	for(vector<string>::const_iterator inFn = inFiles.begin(); inFn != inFiles.end(); ++inFn) {
-		/* open input */
-		ifstream otuIn(inFn->c_str());
-		if(!otuIn.is_open()) {
-			cerr << "Unable to open '" << *inFn << "': " << ::strerror(errno) << endl;
-			return EXIT_FAILURE;
-		}
-		infoLog << *inFn << endl;
-		if(readProgInfo(otuIn).bad())
-			return EXIT_FAILURE;
-		OTUTable otuTable;
-		otuTable.load(otuIn, TABLE_FORMAT);
-
-		otuMerged += otuTable;
-	}
+	otuMerged.merge(otuTables);
 
 	/* write output */
 	infoLog << "Writing merged OTUTable" << endl;
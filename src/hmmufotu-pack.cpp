@@ -0,0 +1,106 @@
+/*******************************************************************************
+ * This file is part of HmmUFOtu, an HMM and Phylogenetic placement
+ * based tool for Ultra-fast taxonomy assignment and OTU organization
+ * of microbiome sequencing data with species level accuracy.
+ * Copyright (C) 2017  Qi Zheng
+ *
+ * HmmUFOtu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HmmUFOtu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with AlignerBoost.  If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+/*
+ * hmmufotu-pack.cpp
+ * Pack an HmmUFOtu database of separate msa, csfm, hmm, hmmb and ptu files into a single memory-mappable file
+ *  Created on: Oct 19, 2026
+ *      Author: zhengqi
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include "HmmUFOtu_common.h"
+
+using namespace std;
+using namespace EGriceLab;
+using namespace EGriceLab::HmmUFOtu;
+
+/**
+ * Print introduction of this program
+ */
+void printIntro(void) {
+	cerr << "Pack an HmmUFOtu database into a single memory-mappable database file, which is used by all HmmUFOtu programs if present" << endl;
+}
+
+/**
+ * Print the usage information
+ */
+void printUsage(const string& progName) {
+	cerr << "Usage:    " << progName << "  <DBNAME> [options]" << endl
+		 << "DBNAME  STR                    : HmmUFOtu database name (prefix) of the msa, csfm, hmm, (optional) hmmb and ptu files" << endl
+		 << "Options:    -o  FILE           : write the packed database to FILE instead of DBNAME" << DB_FILE_SUFFIX << endl
+		 << "            -v  FLAG           : enable verbose information, you may set multiple -v for more details" << endl
+		 << "            --version          : show program version and exit" << endl
+		 << "            -h|--help          : print this message and exit" << endl;
+}
+
+int main(int argc, char* argv[]) {
+	/* variable declarations */
+	string dbName, outFn;
+	ofstream out;
+
+	/* parse options */
+	CommandOptions cmdOpts(argc, argv);
+	if(cmdOpts.empty() || cmdOpts.hasOpt("-h") || cmdOpts.hasOpt("--help")) {
+		printIntro();
+		printUsage(argv[0]);
+		return EXIT_SUCCESS;
+	}
+
+	if(cmdOpts.hasOpt("--version")) {
+		printVersion(argv[0]);
+		return EXIT_SUCCESS;
+	}
+
+	if(cmdOpts.numMainOpts() != 1) {
+		cerr << "Error:" << endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	dbName = cmdOpts.getMainOpt(0);
+	outFn = dbName + DB_FILE_SUFFIX;
+
+	if(cmdOpts.hasOpt("-o"))
+		outFn = cmdOpts.getOpt("-o");
+
+	if(cmdOpts.hasOpt("-v"))
+		INCREASE_LEVEL(cmdOpts.getOpt("-v").length());
+
+	/* open output */
+	out.open(outFn.c_str(), ios_base::out | ios_base::binary);
+	if(!out.is_open()) {
+		cerr << "Unable to write to '" << outFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+
+	/* pack database */
+	HmmUFOtuDB::pack(dbName, out);
+	out.close();
+	if(!out) {
+		cerr << "Unable to pack database '" << dbName << "' into '" << outFn << "'" << endl;
+		std::remove(outFn.c_str()); /* do not leave a partial database behind */
+		return EXIT_FAILURE;
+	}
+	infoLog << "Database packed into '" << outFn << "'" << endl;
+}
@@ -0,0 +1,346 @@
+/*******************************************************************************
+ * This file is part of HmmUFOtu, an HMM and Phylogenetic placement
+ * based tool for Ultra-fast taxonomy assignment and OTU organization
+ * of microbiome sequencing data with species level accuracy.
+ * Copyright (C) 2017  Qi Zheng
+ *
+ * HmmUFOtu is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * HmmUFOtu is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with AlignerBoost.  If not, see <http://www.gnu.org/licenses/>.
+ *******************************************************************************/
+/*
+ * hmmufotu-slice.cpp
+ * Slice an existing HmmUFOtu database to a consensus column region (i.e. an amplicon)
+ * The sliced database has a smaller msa, csfm and ptu file and a re-trained hmm profile
+ *  Created on: Oct 19, 2026
+ *      Author: zhengqi
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <boost/lexical_cast.hpp>
+#include "HmmUFOtu.h"
+
+#ifndef SRC_DATADIR
+#define SRC_DATADIR "."
+#endif
+
+#ifndef PKG_DATADIR
+#define PKG_DATADIR "."
+#endif
+
+using namespace std;
+using namespace EGriceLab;
+using namespace EGriceLab::HmmUFOtu;
+
+/** default values */
+static const double DEFAULT_SYMFRAC = 0.5;
+static const string DEFAULT_DM_FILE = "gg_97_otus.dm";
+static const int DEFAULT_MARGIN = 0;
+
+/**
+ * Print introduction of this program
+ */
+void printIntro(void) {
+	cerr << "Slice an HmmUFOtu database to a consensus column region, i.e. an amplicon such as V4" << endl;
+}
+
+/**
+ * Print the usage information
+ */
+void printUsage(const string& progName) {
+	cerr << "Usage:    " << progName << "  <DBNAME> <-s INT> <-e INT> <-n STR> [options]" << endl
+		 << "DBNAME  STR                      : HmmUFOtu database name (prefix)" << endl
+		 << "-s|--start  INT                  : start of the region, in 1-based consensus column (CS) positions" << endl
+		 << "-e|--end  INT                    : end of the region, in 1-based consensus column (CS) positions, inclusive" << endl
+		 << "-n  STR                          : name (prefix) of the sliced database" << endl
+		 << "Options:    --margin  INT        : extend the region by INT CS positions on both sides [" << DEFAULT_MARGIN << "]" << endl
+		 << "            -f|--symfrac  DOUBLE : conservation threshold for considering a site as a Match state in HMM [" << DEFAULT_SYMFRAC << "]" << endl
+		 << "            -dm  FILE            : use customized trained Dirichlet Model in FILE instead of the build-in file" << endl
+		 << "            -v  FLAG             : enable verbose information, you may set multiple -v for more details" << endl
+		 << "            --version            : show program version and exit" << endl
+		 << "            -h|--help            : print this message and exit" << endl
+		 << "Note: all CS positions reported with the sliced database are relative to the sliced region," << endl
+		 << "      the region offset and the source CS length are recorded in the HMM profile and shown by hmmufotu-inspect" << endl;
+}
+
+int main(int argc, char* argv[]) {
+	/* variable declarations */
+	string dbName, newName;
+	string msaFn, ptuFn;
+	ifstream dmIn;
+	ofstream msaOut, csfmOut, hmmOut, hmmbOut, ptuOut;
+	int start = 0;
+	int end = 0;
+	int margin = DEFAULT_MARGIN;
+	double symfrac = DEFAULT_SYMFRAC;
+	string dmFn;
+
+	/* parse options */
+	CommandOptions cmdOpts(argc, argv);
+	if(cmdOpts.empty() || cmdOpts.hasOpt("-h") || cmdOpts.hasOpt("--help")) {
+		printIntro();
+		printUsage(argv[0]);
+		return EXIT_SUCCESS;
+	}
+
+	if(cmdOpts.hasOpt("--version")) {
+		printVersion(argv[0]);
+		return EXIT_SUCCESS;
+	}
+
+	if(cmdOpts.numMainOpts() != 1) {
+		cerr << "Error:" << endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	dbName = cmdOpts.getMainOpt(0);
+
+	if(cmdOpts.hasOpt("-s"))
+		start = ::atoi(cmdOpts.getOptStr("-s"));
+	if(cmdOpts.hasOpt("--start"))
+		start = ::atoi(cmdOpts.getOptStr("--start"));
+
+	if(cmdOpts.hasOpt("-e"))
+		end = ::atoi(cmdOpts.getOptStr("-e"));
+	if(cmdOpts.hasOpt("--end"))
+		end = ::atoi(cmdOpts.getOptStr("--end"));
+
+	if(cmdOpts.hasOpt("-n"))
+		newName = cmdOpts.getOpt("-n");
+
+	if(cmdOpts.hasOpt("--margin"))
+		margin = ::atoi(cmdOpts.getOptStr("--margin"));
+
+	if(cmdOpts.hasOpt("-f"))
+		symfrac = ::atof(cmdOpts.getOptStr("-f"));
+	if(cmdOpts.hasOpt("--symfrac"))
+		symfrac = ::atof(cmdOpts.getOptStr("--symfrac"));
+
+	dmFn = PKG_DATADIR + string("/") + DEFAULT_DM_FILE;
+	if(!ifstream(dmFn.c_str()).good())
+		dmFn = SRC_DATADIR + string("/") + DEFAULT_DM_FILE;
+	if(cmdOpts.hasOpt("-dm"))
+		dmFn = cmdOpts.getOpt("-dm");
+
+	if(cmdOpts.hasOpt("-v"))
+		INCREASE_LEVEL(cmdOpts.getOpt("-v").length());
+
+	/* check options */
+	if(!(start > 0 && end >= start)) {
+		cerr << "-s|--start and -e|--end must be given as a positive region" << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(newName.empty()) {
+		cerr << "Error: option -n is required" << endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if(newName == dbName) {
+		cerr << "Error: the sliced database cannot overwrite the original database" << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(!(margin >= 0)) {
+		cerr << "--margin must be non-negative" << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(!(symfrac >= 0 && symfrac <= 1)) {
+		cerr << "-f|--symfrac must between 0 and 1" << endl;
+		return EXIT_FAILURE;
+	}
+
+	/* open database */
+	HmmUFOtuDB db;
+	if(!db.open(dbName)) {
+		cerr << "Unable to open HmmUFOtu database '" << dbName << "'" << endl;
+		return EXIT_FAILURE;
+	}
+	msaFn = db.sectionFn(MSA_FILE_SUFFIX);
+	ptuFn = db.sectionFn(PHYLOTREE_FILE_SUFFIX);
+
+	istream& msaIn = db.openSection(MSA_FILE_SUFFIX);
+	if(!msaIn) {
+		cerr << "Unable to open MSA data '" << msaFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+
+	istream& ptuIn = db.openSection(PHYLOTREE_FILE_SUFFIX);
+	if(!ptuIn) {
+		cerr << "Unable to open PTU data '" << ptuFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+
+	dmIn.open(dmFn.c_str());
+	if(!dmIn.is_open()) {
+		cerr << "Unable to open '" << dmFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+
+	/* open outputs */
+	string msaOutFn = newName + MSA_FILE_SUFFIX;
+	string csfmFn = newName + CSFM_FILE_SUFFIX;
+	string hmmFn = newName + HMM_FILE_SUFFIX;
+	string hmmbFn = newName + HMM_BIN_FILE_SUFFIX;
+	string ptuOutFn = newName + PHYLOTREE_FILE_SUFFIX;
+
+	msaOut.open(msaOutFn.c_str(), ios_base::out | ios_base::binary);
+	if(!msaOut.is_open()) {
+		cerr << "Unable to write to '" << msaOutFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	csfmOut.open(csfmFn.c_str(), ios_base::out | ios_base::binary);
+	if(!csfmOut.is_open()) {
+		cerr << "Unable to write to '" << csfmFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	hmmOut.open(hmmFn.c_str());
+	if(!hmmOut.is_open()) {
+		cerr << "Unable to write to '" << hmmFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	hmmbOut.open(hmmbFn.c_str(), ios_base::out | ios_base::binary);
+	if(!hmmbOut.is_open()) {
+		cerr << "Unable to write to '" << hmmbFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	ptuOut.open(ptuOutFn.c_str(), ios_base::out | ios_base::binary);
+	if(!ptuOut.is_open()) {
+		cerr << "Unable to write to '" << ptuOutFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+
+	/* load the original database */
+	if(loadProgInfo(msaIn).bad())
+		return EXIT_FAILURE;
+	MSA msa;
+	msa.load(msaIn);
+	if(msaIn.bad()) {
+		cerr << "Failed to load MSA data '" << msaFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	const int csLen = msa.getCSLen();
+	infoLog << "MSA loaded" << endl;
+
+	if(loadProgInfo(ptuIn).bad())
+		return EXIT_FAILURE;
+	PTUnrooted tree;
+	tree.load(ptuIn);
+	if(ptuIn.bad()) {
+		cerr << "Unable to load Phylogenetic tree data '" << ptuFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	infoLog << "Phylogenetic tree loaded" << endl;
+	if(tree.numAlignSites() != csLen) {
+		cerr << "Error: Unmatched CS length between Phylogenetic tree and MSA data" << endl;
+		return EXIT_FAILURE;
+	}
+
+	/* determine the 0-based sliced region */
+	if(start > csLen) {
+		cerr << "Error: the region start " << start << " is beyond the CS length " << csLen << endl;
+		return EXIT_FAILURE;
+	}
+	start = std::max(start - margin, 1) - 1;
+	end = std::min(end + margin, csLen) - 1;
+	infoLog << "Slicing database to CS region " << (start + 1) << "-" << (end + 1) << endl;
+
+	/* slice msa */
+	msa.slice(start, end);
+	msa.setName(newName);
+	infoLog << "MSA sliced to " << msa.getNumSeq() << " X " << msa.getCSLen() << " aligned sequences" << endl;
+
+	/* rebuild csfm */
+	CSFMIndex csfm;
+	csfm.build(msa);
+	if(csfm.isInitiated())
+		infoLog << "CSFM index built" << endl;
+	else {
+		cerr << "Unable to build CSFM index" << endl;
+		return EXIT_FAILURE;
+	}
+
+	/* retrain hmm on the sliced msa */
+	BandedHMMP7Prior hmmPrior;
+	dmIn >> hmmPrior;
+	if(dmIn.bad()) {
+		cerr << "Failed to read in the HMM Prior file '" << dmFn << "'" << endl;
+		return EXIT_FAILURE;
+	}
+	BandedHMMP7 hmm;
+	hmm.setName(newName);
+	hmm.setHmmVersion(getProgFullName(progName, progVer));
+	hmm.build(msa, symfrac, hmmPrior);
+	/* record the origin of the sliced CS positions */
+	hmm.setOptTag(HMM_CS_OFFSET_TAG, boost::lexical_cast<string>(start));
+	hmm.setOptTag(HMM_CS_SRCLEN_TAG, boost::lexical_cast<string>(csLen));
+	infoLog << "Banded HMM profile trained" << endl;
+
+	/* slice ptu */
+	tree.slice(start, end);
+	infoLog << "Phylogenetic tree sliced" << endl;
+
+	infoLog << "Saving database files ..." << endl;
+	/* write database files, all with prepend program info */
+	saveProgInfo(msaOut);
+	msa.save(msaOut);
+	if(msaOut.bad()) {
+		cerr << "Unable to save MSA: " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	infoLog << "MSA saved" << endl;
+
+	saveProgInfo(csfmOut);
+	csfm.save(csfmOut);
+	if(csfmOut.bad()) {
+		cerr << "Unable to save CSFM index: " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	infoLog << "CSFM saved" << endl;
+
+	/* compile the profile as read back from the hmm file, so the costs are identical to loading the hmm file */
+	stringstream hmmBuf;
+	hmmBuf << hmm;
+	const string hmmText = hmmBuf.str();
+	hmmOut << hmmText;
+	if(hmmOut.bad()) {
+		cerr << "Unable to save HMM profile: " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	infoLog << "Banded HMM profile saved" << endl;
+
+	BandedHMMP7 hmmc;
+	hmmBuf >> hmmc;
+	saveProgInfo(hmmbOut);
+	HmmUFOtuDB::checksum(hmmText.data(), hmmText.length()).save(hmmbOut); /* the hmm file it is compiled from */
+	hmmc.save(hmmbOut);
+	if(hmmbOut.bad()) {
+		cerr << "Unable to save compiled HMM profile: " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	infoLog << "Compiled HMM profile saved" << endl;
+
+	saveProgInfo(ptuOut);
+	tree.save(ptuOut);
+	if(ptuOut.bad()) {
+		cerr << "Unable to save Phylogenetic tree: " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	infoLog << "Phylogenetic tree saved" << endl;
+}
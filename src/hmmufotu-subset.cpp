@@ -35,6 +35,10 @@
 #include "HmmUFOtu_common.h"
 #include "HmmUFOtu_OTU.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace std;
 using namespace EGriceLab;
 using namespace EGriceLab::HmmUFOtu;
@@ -44,6 +48,8 @@ using namespace Eigen;
 static const string TABLE_FORMAT = "table";
 static const unsigned long DEFAULT_SIZE = 0;
 static const string DEFAULT_METHOD = "uniform";
+static const int DEFAULT_NUM_ITER = 1;
+static const int DEFAULT_NUM_THREADS = 1;
 
 /**
  * Print introduction of this program
@@ -62,6 +68,10 @@ void printUsage(const string& progName) {
 		 << "-s  LONG                       : subset sample size for each sample" << endl
 		 << "Options:    --method  STR      : subsetting method, either 'uniform' (wo/ replacement) or 'multinomial' (w/ placement) [" << DEFAULT_METHOD << "]" << endl
 		 << "            -S|--seed  INT     : random seed used for subsetting, for debug purpose" << endl
+		 << "            --iter  INT        : number of subsamplings averaged for each sample, the averaged metrics may be fractional [" << DEFAULT_NUM_ITER << "]" << endl
+#ifdef _OPENMP
+		 << "            -p|--process INT   : number of threads/cpus used for subsetting, the results are identical with any number of threads [" << DEFAULT_NUM_THREADS << "]" << endl
+#endif
 		 << "            -v  FLAG           : enable verbose information, you may set multiple -v for more details" << endl
 		 << "            --version          : show program version and exit" << endl
 		 << "            -h|--help          : print this message and exit" << endl;
@@ -77,6 +87,8 @@ int main(int argc, char* argv[]) {
 	unsigned long size = DEFAULT_SIZE;
 	string method = DEFAULT_METHOD;
 	unsigned seed = time(NULL); // using time as default seed
+	int nIter = DEFAULT_NUM_ITER;
+	int nThreads = DEFAULT_NUM_THREADS;
 
 	/* parse options */
 	CommandOptions cmdOpts(argc, argv);
@@ -115,6 +127,16 @@ int main(int argc, char* argv[]) {
 	if(cmdOpts.hasOpt("--seed"))
 		seed = ::atoi(cmdOpts.getOptStr("--seed"));
 
+	if(cmdOpts.hasOpt("--iter"))
+		nIter = ::atoi(cmdOpts.getOptStr("--iter"));
+
+#ifdef _OPENMP
+	if(cmdOpts.hasOpt("-p"))
+		nThreads = ::atoi(cmdOpts.getOptStr("-p"));
+	if(cmdOpts.hasOpt("--process"))
+		nThreads = ::atoi(cmdOpts.getOptStr("--process"));
+#endif
+
 	if(cmdOpts.hasOpt("-v"))
 		INCREASE_LEVEL(cmdOpts.getOpt("-v").length());
 
@@ -123,6 +145,17 @@ int main(int argc, char* argv[]) {
 		cerr << "-s must be positive integer" << endl;
 		return EXIT_FAILURE;
 	}
+	if(!(nIter > 0)) {
+		cerr << "--iter must be positive" << endl;
+		return EXIT_FAILURE;
+	}
+#ifdef _OPENMP
+	if(!(nThreads > 0)) {
+		cerr << "-p|--process must be positive" << endl;
+		return EXIT_FAILURE;
+	}
+	omp_set_num_threads(nThreads);
+#endif
 
 	/* open inputs */
 	in.open(inFn.c_str());
@@ -145,12 +178,14 @@ int main(int argc, char* argv[]) {
 	OTUTable otuTable;
 	otuTable.load(in, TABLE_FORMAT);
 
+	/* prune samples first, so the averaged metrics are not pruned by rounding errors */
+	otuTable.pruneSamples(size);
+
 	infoLog << "Subsetting OTUTable" << endl;
 	otuTable.seed(seed);
-	otuTable.subset(size, method);
+	otuTable.subset(size, method, nIter);
 
 	/* prune OTUTable */
-	otuTable.pruneSamples(size);
 	otuTable.pruneOTUs();
 
 	/* write the OTU table */
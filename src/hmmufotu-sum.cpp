@@ -28,13 +28,17 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <cctype>
 #include <cfloat>
 #include <cstdlib>
 #include <cstring>
 #include <cerrno>
+#include <climits>
 #include <limits>
+#include <stdexcept>
 #include <map>
+#include <algorithm>
 #include <boost/unordered_map.hpp>
 #include <boost/unordered_set.hpp>
 #include <boost/algorithm/string.hpp> /* for boost string join */
@@ -47,6 +51,10 @@
 #include "HmmUFOtu.h"
 #include "HmmUFOtu_main.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace std;
 using namespace EGriceLab;
 using namespace EGriceLab::HmmUFOtu;
@@ -61,6 +69,7 @@ static const int DEFAULT_MIN_NSAMPLE = 0;
 static const double DEFAULT_MIN_Q = 0;
 static const double DEFAULT_MIN_ALN_IDENTITY = 0;
 static const double DEFAULT_MIN_HMM_IDENTITY = 0;
+static const int DEFAULT_NUM_THREADS = 1;
 typedef boost::unordered_map<PTUnrooted::PTUNodePtr, OTUObserved> OTUMap;
 typedef boost::unordered_set<PTUnrooted::PTUNodePtr> OTUSet;
 typedef boost::unordered_map<string, vector<string> > OTU2ReadMap;
@@ -81,7 +90,7 @@ void printUsage(const string& progName) {
 	ZLIB_SUPPORT = ", support .gz or .bz2 compressed file";
 	#endif
 	cerr << "Usage:    " << progName << "  <HmmUFOtu-DB> <(INFILE [INFILE2 ...]> <-o OTU-OUT> [options]" << endl
-		 << "INFILE          FILE           : assignment file(s) from hmmufotu" << ZLIB_SUPPORT << endl
+		 << "INFILE          FILE           : assignment file(s) from hmmufotu" << ZLIB_SUPPORT << ", or in the binary format if it ends with " << ASSIGN_BIN_FILE_SUFFIX << endl
 		 << "Options:    -o  FILE           : OTU summary output, required" << endl
 		 << "            -r  FILE           : output the read IDs for each OTU" << endl
 		 << "            -l  FILE           : sample name list, with 1st field sample-name and 2nd field assignment filename" << endl
@@ -95,11 +104,261 @@ void printUsage(const string& progName) {
 		 << "            -n  INT            : minimum number of observed reads required to define an OTU across all samples, 0 for no filtering [" << DEFAULT_MIN_NREAD << "]" << endl
 		 << "            -s  INT            : minimum number of observed samples required to define an OTU, 0 for no filtering [" << DEFAULT_MIN_NSAMPLE << "]" << endl
 		 << "            --no-gap  FLAG     : if -c is set, this will output the non-gapped OTU sequences instead of aligned CS alignment" << endl
+#ifdef _OPENMP
+		 << "            -p|--process INT   : number of threads/cpus used for reading the assignment files, each file is read by one thread" << endl
+#endif
 		 << "            -v  FLAG           : enable verbose information, you may set multiple -v for more details" << endl
 		 << "            --version          : show program version and exit" << endl
 		 << "            -h|--help          : print this message and exit" << endl;
 }
 
+/** column indices of an hmmufotu assignment file, resolved once from its header */
+struct AssignColumns {
+	/** default constructor, with all columns not found */
+	AssignColumns() : id(-1), csStart(-1), csEnd(-1), alignment(-1), taxonId(-1), qTaxon(-1) {  }
+
+	/**
+	 * resolve column indices from the header line, skipping the comment lines before it
+	 * @return  true if all required columns are found
+	 */
+	bool parseHeader(istream& in);
+
+	/** max index of all required columns */
+	int maxIdx() const {
+		return std::max(std::max(std::max(id, csStart), std::max(csEnd, alignment)), std::max(taxonId, qTaxon));
+	}
+
+	int id;
+	int csStart;
+	int csEnd;
+	int alignment;
+	int taxonId;
+	int qTaxon;
+};
+
+bool AssignColumns::parseHeader(istream& in) {
+	string line;
+	while(std::getline(in, line) && !line.empty() && line[0] == TSVScanner::COMMENT_CHAR)
+		continue;
+	vector<string> names;
+	boost::split(names, line, boost::is_any_of("\t"));
+	for(vector<string>::size_type i = 0; i < names.size(); ++i) {
+		if(names[i] == "id")
+			id = i;
+		else if(names[i] == "CS_start")
+			csStart = i;
+		else if(names[i] == "CS_end")
+			csEnd = i;
+		else if(names[i] == "alignment")
+			alignment = i;
+		else if(names[i] == "taxon_id")
+			taxonId = i;
+		else if(names[i] == "Q_taxon")
+			qTaxon = i;
+	}
+	return id >= 0 && csStart >= 0 && csEnd >= 0 && alignment >= 0 && taxonId >= 0 && qTaxon >= 0;
+}
+
+/**
+ * get the length of an aligned seq encoded by BandedHMMP7::HmmAlignment::encodeAlign, without decoding it
+ */
+long encodedAlignLength(const char* aln, const char* alnEnd) {
+	long len = 0;
+	for(const char* p = aln; p < alnEnd; ++p) {
+		if(::isdigit(*p)) { /* a run */
+			char* q;
+			len += ::strtol(p, &q, 10);
+			p = q;
+		}
+		else
+			len++;
+	}
+	return len;
+}
+
+/**
+ * Add a valid assignment of sample s of total S samples to its OTU
+ * @param aln, alnEnd  aligned seq of the database alignment length, optionally encoded by BandedHMMP7::HmmAlignment::encodeAlign
+ * @param rid, ridEnd  read ID, only used if otu2Read is not NULL
+ */
+void addAssignment(int s, int S, const PTUnrooted& ptu, const int8_t* code, const string& otuPrefix,
+		long taxonId, const char* aln, const char* alnEnd, bool encoded, const char* rid, const char* ridEnd,
+		OTUMap& otuData, OTU2ReadMap* otu2Read) {
+	const int L = ptu.numAlignSites();
+	const PTUnrooted::PTUNodePtr& node = ptu.getNode(taxonId);
+	OTUMap::iterator otuIt = otuData.find(node);
+	if(otuIt == otuData.end()) /* not initiated */
+		otuIt = otuData.insert(std::make_pair(node,
+				OTUObserved(otuPrefix + boost::lexical_cast<string>(node->getId()), node->getTaxon(), L, S))).first;
+	OTUObserved& otu = otuIt->second;
+	otu.count(s)++;
+	if(otu2Read != NULL)
+		(*otu2Read)[otu.id].push_back(string(rid, ridEnd));
+	if(!encoded) {
+		for(int j = 0; j < L; ++j) {
+			int8_t b = code[static_cast<unsigned char> (aln[j])];
+			if(b >= 0)
+				otu.freq(b, j)++;
+			else
+				otu.gap(j)++;
+		}
+		return;
+	}
+	/* add each run of an encoded aligned seq */
+	int j = 0;
+	for(const char* p = aln; p < alnEnd; ++p) {
+		long n = 1;
+		if(::isdigit(*p)) {
+			char* q;
+			n = ::strtol(p, &q, 10);
+			p = q;
+		}
+		int8_t b = code[static_cast<unsigned char> (*p)];
+		if(b >= 0)
+			otu.freq.row(b).segment(j, n).array() += 1;
+		else
+			otu.gap.segment(j, n).array() += 1;
+		j += n;
+	}
+}
+
+/**
+ * Read assignment records of sample s of total S samples, and add the valid assignments to their OTUs
+ * only the required fields of each record are located and parsed
+ * @param code  encoded base of each character, negative for gaps
+ * @param otuData  observed OTUs to be added to
+ * @param otu2Read  if not NULL, read IDs are also added to their OTUs
+ * @return  number of valid assignments
+ * @throw std::runtime_error if the input is not a valid assignment file of this database
+ */
+long readAssignment(istream& in, int s, int S, const PTUnrooted& ptu, const BandedHMMP7& hmm,
+		const DegenAlphabet* abc, const int8_t* code, const string& otuPrefix,
+		double minQ, double minAlnIden, double minHmmIden,
+		OTUMap& otuData, OTU2ReadMap* otu2Read) {
+	AssignColumns cols;
+	if(!cols.parseHeader(in))
+		throw std::runtime_error("Missing required columns in the header");
+	const int nField = cols.maxIdx() + 1;
+	const int L = ptu.numAlignSites();
+	vector<const char*> fields(nField); /* start of each field */
+	long nValid = 0;
+	string line;
+	string decoded; /* decoded aligned seq of compact records */
+	while(std::getline(in, line)) {
+		if(line.empty() || line[0] == TSVScanner::COMMENT_CHAR)
+			continue;
+		/* locate the required fields */
+		const char* p = line.c_str();
+		const char* end = p + line.length();
+		int k = 0;
+		fields[k++] = p;
+		while(k < nField && (p = static_cast<const char*> (::memchr(p, '\t', end - p))) != NULL)
+			fields[k++] = ++p;
+		if(k < nField)
+			throw std::runtime_error("Missing fields in record '" + line.substr(0, line.find('\t')) + "'");
+
+		const long taxonId = ::strtol(fields[cols.taxonId], NULL, 10);
+		const double qTaxon = ::strtod(fields[cols.qTaxon], NULL);
+		if(!(taxonId >= 0 && qTaxon >= minQ))
+			continue;
+		if(taxonId >= static_cast<long> (ptu.numNodes()))
+			throw std::runtime_error("Invalid taxon_id found in record '" + line.substr(0, line.find('\t')) + "'");
+		const char* aln = fields[cols.alignment];
+		const char* alnEnd = static_cast<const char*> (::memchr(aln, '\t', end - aln));
+		if(alnEnd == NULL)
+			alnEnd = end;
+		if(std::find_if(aln, alnEnd, ::isdigit) != alnEnd) { /* written with --compact-align */
+			BandedHMMP7::HmmAlignment::decodeAlign(aln, alnEnd, decoded);
+			aln = decoded.c_str();
+			alnEnd = aln + decoded.length();
+		}
+		if(alnEnd - aln != L)
+			throw std::runtime_error("Alignment length of record '" + line.substr(0, line.find('\t')) + "' does not match the database");
+		if(minAlnIden != 0 || minHmmIden != 0) {
+			const int csStart = ::atoi(fields[cols.csStart]);
+			const int csEnd = ::atoi(fields[cols.csEnd]);
+			const string align(aln, L);
+			if(!((minAlnIden == 0 || alignIdentity(abc, align, csStart - 1, csEnd - 1) >= minAlnIden)
+					&& (minHmmIden == 0 || hmmIdentity(hmm, align, csStart - 1, csEnd - 1) >= minHmmIden)))
+				continue;
+		}
+
+		/* a valid assignment */
+		const char* rid = NULL;
+		const char* ridEnd = NULL;
+		if(otu2Read != NULL) {
+			rid = fields[cols.id];
+			ridEnd = static_cast<const char*> (::memchr(rid, '\t', end - rid));
+			if(ridEnd == NULL)
+				ridEnd = end;
+		}
+		addAssignment(s, S, ptu, code, otuPrefix, taxonId, aln, alnEnd, false, rid, ridEnd, otuData, otu2Read);
+		nValid++;
+	}
+	return nValid;
+}
+
+/**
+ * Read assignment records of sample s of total S samples from a binary input, as readAssignment,
+ * only the required columns are loaded
+ * @return  number of valid assignments
+ * @throw std::runtime_error if the input is not a valid binary assignment file of this database
+ */
+long readAssignmentBin(AssignBinReader& reader, int s, int S, const PTUnrooted& ptu, const BandedHMMP7& hmm,
+		const DegenAlphabet* abc, const int8_t* code, const string& otuPrefix,
+		double minQ, double minAlnIden, double minHmmIden,
+		OTUMap& otuData, OTU2ReadMap* otu2Read) {
+	const int idCol = reader.getColIdx("id");
+	const int csStartCol = reader.getColIdx("CS_start");
+	const int csEndCol = reader.getColIdx("CS_end");
+	const int alnCol = reader.getColIdx("alignment");
+	const int taxonCol = reader.getColIdx("taxon_id");
+	const int qCol = reader.getColIdx("Q_taxon");
+	if(idCol < 0 || csStartCol < 0 || csEndCol < 0 || alnCol < 0 || taxonCol < 0 || qCol < 0)
+		throw std::runtime_error("Missing required columns in the header");
+	const bool checkIden = minAlnIden != 0 || minHmmIden != 0;
+	reader.selectCols(vector<string>()); /* only load required columns */
+	reader.selectCol(alnCol);
+	reader.selectCol(taxonCol);
+	reader.selectCol(qCol);
+	reader.selectCol(csStartCol, checkIden);
+	reader.selectCol(csEndCol, checkIden);
+	reader.selectCol(idCol, otu2Read != NULL);
+
+	const int L = ptu.numAlignSites();
+	long nValid = 0;
+	long nRecord = 0;
+	string decoded;
+	AssignBinBlock block;
+	for(; reader.nextBlock(block); nRecord += block.size()) {
+		const int64_t* taxonIds = block.getInts(taxonCol);
+		const double* qTaxons = block.getReals(qCol);
+		for(size_t i = 0; i < block.size(); ++i) {
+			if(!(taxonIds[i] >= 0 && qTaxons[i] >= minQ))
+				continue;
+			if(taxonIds[i] >= static_cast<long> (ptu.numNodes()))
+				throw std::runtime_error("Invalid taxon_id found in record " + boost::lexical_cast<string>(nRecord + i + 1));
+			const char* aln = block.getStr(alnCol, i);
+			const char* alnEnd = aln + block.getStrLen(alnCol, i);
+			if(encodedAlignLength(aln, alnEnd) != L)
+				throw std::runtime_error("Alignment length of record " + boost::lexical_cast<string>(nRecord + i + 1) + " does not match the database");
+			if(checkIden) {
+				BandedHMMP7::HmmAlignment::decodeAlign(aln, alnEnd, decoded);
+				const int csStart = block.getInts(csStartCol)[i];
+				const int csEnd = block.getInts(csEndCol)[i];
+				if(!((minAlnIden == 0 || alignIdentity(abc, decoded, csStart - 1, csEnd - 1) >= minAlnIden)
+						&& (minHmmIden == 0 || hmmIdentity(hmm, decoded, csStart - 1, csEnd - 1) >= minHmmIden)))
+					continue;
+			}
+			const char* rid = otu2Read != NULL ? block.getStr(idCol, i) : NULL;
+			addAssignment(s, S, ptu, code, otuPrefix, taxonIds[i], aln, alnEnd, true,
+					rid, rid != NULL ? rid + block.getStrLen(idCol, i) : NULL, otuData, otu2Read);
+			nValid++;
+		}
+	}
+	return nValid;
+}
+
 int main(int argc, char* argv[]) {
 	/* variable declarations */
 	string dbName, msaFn, hmmFn, ptuFn;
@@ -107,7 +366,6 @@ int main(int argc, char* argv[]) {
 	map<string, string> sampleFn2Name;
 	string listFn;
 	string otuFn, readFn, csFn, treeFn;
-	ifstream msaIn, hmmIn, ptuIn;
 	ofstream otuOut, readOut, treeOut, csOut;
 	SeqIO csO;
 	OTU2ReadMap otu2Read;
@@ -120,6 +378,7 @@ int main(int argc, char* argv[]) {
 	int minSample = DEFAULT_MIN_NSAMPLE;
 	bool noGap = false;
 	bool useDBName = false;
+	int nThreads = DEFAULT_NUM_THREADS;
 
 	/* parse options */
 	CommandOptions cmdOpts(argc, argv);
@@ -185,6 +444,13 @@ int main(int argc, char* argv[]) {
 	if(cmdOpts.hasOpt("--no-gap"))
 		noGap = true;
 
+#ifdef _OPENMP
+	if(cmdOpts.hasOpt("-p"))
+		nThreads = ::atoi(cmdOpts.getOptStr("-p"));
+	if(cmdOpts.hasOpt("--process"))
+		nThreads = ::atoi(cmdOpts.getOptStr("--process"));
+#endif
+
 	if(cmdOpts.hasOpt("-v"))
 		INCREASE_LEVEL(cmdOpts.getOpt("-v").length());
 
@@ -201,11 +467,15 @@ int main(int argc, char* argv[]) {
 		cerr << "-s must be non-negative integer" << endl;
 		return EXIT_FAILURE;
 	}
+#ifdef _OPENMP
+	if(!(nThreads > 0)) {
+		cerr << "-p|--process must be positive" << endl;
+		return EXIT_FAILURE;
+	}
+	omp_set_num_threads(nThreads);
+#endif
 
 	/* set filenames */
-	msaFn = dbName + MSA_FILE_SUFFIX;
-	hmmFn = dbName + HMM_FILE_SUFFIX;
-	ptuFn = dbName + PHYLOTREE_FILE_SUFFIX;
 	string otuPrefix = !useDBName ? "" : dbName + "_";
 
 	/* open inputs */
@@ -239,19 +509,29 @@ int main(int argc, char* argv[]) {
 		infoLog << nRead << " user-provided sample names read" << endl;
 	}
 
-	msaIn.open(msaFn.c_str(), ios_base::in | ios_base::binary);
+	/* open database */
+	HmmUFOtuDB db;
+	if(!db.open(dbName)) {
+		cerr << "Unable to open HmmUFOtu database '" << dbName << "'" << endl;
+		return EXIT_FAILURE;
+	}
+	msaFn = db.sectionFn(MSA_FILE_SUFFIX);
+	hmmFn = db.sectionFn(HMM_FILE_SUFFIX);
+	ptuFn = db.sectionFn(PHYLOTREE_FILE_SUFFIX);
+
+	istream& msaIn = db.openSection(MSA_FILE_SUFFIX);
 	if(!msaIn) {
 		cerr << "Unable to open MSA data '" << msaFn << "': " << ::strerror(errno) << endl;
 		return EXIT_FAILURE;
 	}
 
-	hmmIn.open(hmmFn.c_str());
+	istream& hmmIn = db.openSection(HMM_FILE_SUFFIX);
 	if(!hmmIn) {
 		cerr << "Unable to open HMM profile '" << hmmFn << "': " << ::strerror(errno) << endl;
 		return EXIT_FAILURE;
 	}
 
-	ptuIn.open(ptuFn.c_str(), ios_base::in | ios_base::binary);
+	istream& ptuIn = db.openSection(PHYLOTREE_FILE_SUFFIX);
 	if(!ptuIn) {
 		cerr << "Unable to open PTU data '" << ptuFn << "': " << ::strerror(errno) << endl;
 		return EXIT_FAILURE;
@@ -329,61 +609,110 @@ int main(int argc, char* argv[]) {
 	const int L = ptu.numAlignSites();
 	const size_t N = ptu.numNodes();
 
-	/* process input files */
-	OTUMap otuData;
+	/* process input files, each by one thread with its own OTUs, merged after all files are read */
 	vector<string> sampleNames;
-	for(int s = 0; s < inFiles.size(); ++s) {
-		string infn = inFiles[s];
-		string sample = sampleFn2Name[infn];
-		infoLog << "Processing sample " << sampleFn2Name[infn] << " ..." << endl;
+	for(int s = 0; s < S; ++s)
+		sampleNames.push_back(sampleFn2Name[inFiles[s]]);
+	int8_t code[UCHAR_MAX + 1]; /* encoded base of every character */
+	for(int c = 0; c <= UCHAR_MAX; ++c)
+		code[c] = abc->encode(::toupper(c));
+#ifdef _OPENMP
+	vector<OTUMap> threadData(omp_get_max_threads());
+#else
+	vector<OTUMap> threadData(1);
+#endif
+	vector<OTU2ReadMap> sampleReads(readOut.is_open() ? S : 0); /* read IDs of each sample, merged in sample order */
+	bool isFailed = false;
+#pragma omp parallel for schedule(dynamic)
+	for(int s = 0; s < S; ++s) {
+		const string& infn = inFiles[s];
+#ifdef _OPENMP
+		OTUMap& otuData = threadData[omp_get_thread_num()];
+#else
+		OTUMap& otuData = threadData[0];
+#endif
+#pragma omp critical(writeLog)
+		infoLog << "Processing sample " << sampleNames[s] << " ..." << endl;
+		const bool isBin = AssignBinIO::isBinFile(infn);
+		ifstream binIn; /* seekable binary input, so unused columns are skipped without reading */
+		AssignBinReader binReader(binIn);
 		boost::iostreams::filtering_istream in;
+		bool isValid = true;
+		if(isBin) {
+			binIn.open(infn.c_str(), ios_base::in | ios_base::binary);
+			isValid = binIn.is_open();
+		}
+		else {
 #ifdef HAVE_LIBZ
-		if(StringUtils::endsWith(infn, GZIP_FILE_SUFFIX))
-			in.push(boost::iostreams::gzip_decompressor());
-		else if(StringUtils::endsWith(infn, BZIP2_FILE_SUFFIX))
-			in.push(boost::iostreams::bzip2_decompressor());
-		else { }
+			if(StringUtils::endsWith(infn, GZIP_FILE_SUFFIX))
+				in.push(boost::iostreams::gzip_decompressor());
+			else if(StringUtils::endsWith(infn, BZIP2_FILE_SUFFIX))
+				in.push(boost::iostreams::bzip2_decompressor());
+			else { }
 #endif
-		in.push(boost::iostreams::file_source(infn));
-		if(in.bad()) {
+			in.push(boost::iostreams::file_source(infn));
+			isValid = !in.bad();
+		}
+		if(!isValid) {
+#pragma omp critical(writeLog)
 			cerr << "Unable to open assignment input file '" << infn << "' " << ::strerror(errno) << endl;
-			return EXIT_FAILURE;
 		}
 
 		/* check program info */
-		if(readProgInfo(in).bad())
-			return EXIT_FAILURE;
-		TSVScanner tsvIn(in, true);
-		sampleNames.push_back(sample);
-		while(tsvIn.hasNext()) {
-			const TSVRecord& record = tsvIn.nextRecord();
-			string rid = record.getFieldByName("id");
-			int csStart = ::atoi(record.getFieldByName("CS_start").c_str());
-			int csEnd = ::atoi(record.getFieldByName("CS_end").c_str());
-			const string& aln = record.getFieldByName("alignment");
-			const long taxon_id = ::atol(record.getFieldByName("taxon_id").c_str());
-			double qTaxon = ::atof(record.getFieldByName("Q_taxon").c_str());
-
-			if(taxon_id >= 0 && qTaxon >= minQ
-					&& (minAlnIden == 0 || alignIdentity(abc, aln, csStart - 1, csEnd -1) >= minAlnIden)
-					&& (minHmmIden == 0 || hmmIdentity(hmm, aln, csStart - 1, csEnd - 1) >= minHmmIden )) { /* a valid assignment */
-				const PTUnrooted::PTUNodePtr& node = ptu.getNode(taxon_id);
-				string otuID = otuPrefix + boost::lexical_cast<string>(node->getId());
-				if(otuData.count(node) == 0) /* not initiated */
-					otuData[node] = OTUObserved(otuID, node->getTaxon(), L, S);
-				OTUObserved& otu = otuData.find(node)->second;
-				otu.count(s)++;
-				if(readOut.is_open())
-					otu2Read[otuID].push_back(rid);
-				for(int j = 0; j < L; ++j) {
-					int8_t b = abc->encode(::toupper(aln[j]));
-					if(b >= 0)
-						otu.freq(b, j)++;
-					else
-						otu.gap(j)++;
-				}
+		if(isValid && isBin) {
+			if(!binReader.readHeader()) {
+#pragma omp critical(writeLog)
+				cerr << "Invalid binary assignment input file '" << infn << "'" << endl;
+				isValid = false;
+			}
+			else {
+				std::istringstream infoIn(binReader.getComments());
+#pragma omp critical(writeLog)
+				isValid = !readProgInfo(infoIn).bad();
+			}
+		}
+		else if(isValid) {
+#pragma omp critical(writeLog)
+			isValid = !readProgInfo(in).bad();
+		}
+		if(isValid) {
+			try {
+				OTU2ReadMap* otu2Read = readOut.is_open() ? &sampleReads[s] : NULL;
+				long nValid = isBin ? readAssignmentBin(binReader, s, S, ptu, hmm, abc, code, otuPrefix, minQ, minAlnIden, minHmmIden, otuData, otu2Read)
+						: readAssignment(in, s, S, ptu, hmm, abc, code, otuPrefix, minQ, minAlnIden, minHmmIden, otuData, otu2Read);
+#pragma omp critical(writeLog)
+				debugLog << nValid << " valid assignments found in sample " << sampleNames[s] << endl;
+			}
+			catch(const std::runtime_error& e) {
+#pragma omp critical(writeLog)
+				cerr << "Invalid assignment input file '" << infn << "': " << e.what() << endl;
+				isValid = false;
 			}
 		}
+		if(!isValid)
+#pragma omp critical(writeLog)
+			isFailed = true;
+	}
+	if(isFailed)
+		return EXIT_FAILURE;
+
+	OTUMap& otuData = threadData[0];
+	for(vector<OTUMap>::size_type t = 1; t < threadData.size(); ++t) {
+		for(OTUMap::const_iterator otu = threadData[t].begin(); otu != threadData[t].end(); ++otu) {
+			OTUMap::iterator otuIt = otuData.find(otu->first);
+			if(otuIt == otuData.end())
+				otuData.insert(*otu);
+			else
+				otuIt->second += otu->second;
+		}
+		threadData[t].clear();
+	}
+	for(vector<OTU2ReadMap>::iterator sampleRead = sampleReads.begin(); sampleRead != sampleReads.end(); ++sampleRead) {
+		for(OTU2ReadMap::iterator otuRead = sampleRead->begin(); otuRead != sampleRead->end(); ++otuRead) {
+			vector<string>& reads = otu2Read[otuRead->first];
+			reads.insert(reads.end(), otuRead->second.begin(), otuRead->second.end());
+		}
+		sampleRead->clear();
 	}
 
 	/* construct an OTU table and output alignment */
@@ -9,17 +9,28 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <stdexcept>
 #include <cfloat>
 #include <cstdlib>
+#include <cstdio>
 #include <cstring>
 #include <cerrno>
+#include <csignal>
 #include <algorithm>
+#include <map>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <boost/unordered_map.hpp>
 #include <boost/algorithm/string.hpp> /* for boost string split and join */
 #include <boost/iostreams/filtering_stream.hpp> /* basic boost streams */
 #include <boost/iostreams/device/file.hpp> /* file sink and source */
 #include <boost/iostreams/filter/zlib.hpp> /* for zlib support */
 #include <boost/iostreams/filter/gzip.hpp>
 #include <boost/iostreams/filter/bzip2.hpp> /* for bzip2 support */
+#include <boost/iostreams/stream.hpp>
+#include <boost/iostreams/device/array.hpp> /* for reading request data */
+#include <boost/iostreams/device/file_descriptor.hpp> /* for socket connections */
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -41,6 +52,7 @@ static const int DEFAULT_STRAND_TEST = MIN_STRAND_TEST;
 static const double STRAND_CONFIDENCE = 0.9;
 static const double DEFAULT_MAX_DIFF = inf;
 static const size_t DEFAULT_MAX_NSEED = 50;
+static const int DEFAULT_SEED_BEAM = 0;
 static const int DEFAULT_SEED_LEN = 20;
 static const int MAX_SEED_LEN = 25;
 static const int MIN_SEED_LEN = 15;
@@ -54,6 +66,11 @@ static const int DEFAULT_NUM_THREADS = 1;
 static const string ALIGN_OUT_FMT = "fasta";
 static const string DEFAULT_BRANCH_EST_METHOD = "unweighted";
 static const string CHIMERA_TSV_HEADER = "seg5_taxon_id\tseg3_taxon_id\tseg5_taxon_anno\tseg3_taxon_anno\tchimera_lod";
+static const string OTU_TABLE_FORMAT = "table";
+static const string CHECKPOINT_FILE_SUFFIX = ".ckpt";
+static const long DEFAULT_CHECKPOINT_INTERVAL = 0;
+static const double PROGRESS_INTERVAL = 10; /* seconds between progress lines */
+typedef boost::unordered_map<PTUnrooted::PTUNodePtr, OTUObserved> OTUMap;
 
 /**
  * Print introduction of this program
@@ -74,9 +91,12 @@ void printUsage(const string& progName) {
 	#endif
 
 	cerr << "Usage:    " << progName << "  <HmmUFOtu-DB> <READ-FILE1> [READ-FILE2] [options]" << endl
+		 << "          " << progName << "  <HmmUFOtu-DB> --manifest FILE [options]" << endl
+		 << "          " << progName << "  <HmmUFOtu-DB> --server [--listen SOCKET] [-p INT] [-v]" << endl
+		 << "          " << progName << "  --merge-shards <READ-FILE1> <SHARD-OUT1> [SHARD-OUT2 ...] [-o FILE]" << endl
 		 << "READ-FILE1  FILE                 : sequence read file for the assembled/forward read" << ZLIB_SUPPORT << endl
 		 << "READ-FILE2  FILE                 : sequence read file for the reverse read" << ZLIB_SUPPORT << endl
-		 << "Options:    -o  FILE             : write the assignment output to FILE instead of stdout" << ZLIB_SUPPORT << endl
+		 << "Options:    -o  FILE             : write the assignment output to FILE instead of stdout" << ZLIB_SUPPORT << ", or in the binary columnar format if FILE ends with " << ASSIGN_BIN_FILE_SUFFIX << endl
 		 << "            -a  FILE             : in addition to the assignment output, write the read alignment in " << ALIGN_OUT_FMT << " format" << ZLIB_SUPPORT << endl
 		 << "            --fmt  STR           : read file format (applied to all read files), supported format: 'fasta', 'fastq'" << endl
 		 << "            -L|--seed-len  INT   : seed length used for banded-Hmm search [" << DEFAULT_SEED_LEN << "]" << endl
@@ -86,6 +106,7 @@ void printUsage(const string& progName) {
 		 << "            -t|--test  INT       : use first # reads to detect the strandness of input reads/mates, ignored if -s is not 0 [" << DEFAULT_STRAND_TEST << "]" << endl
 		 << "            -i|--ignore  FLAG    : ignore forward/reverse orientation check, only recommended when your read size is larger than the expected amplicon size" << endl
 		 << "            -N  INT              : max # of seed nodes used in the 'Seed' stage of SEP algorithm [" << DEFAULT_MAX_NSEED << "]" << endl
+		 << "            --beam  INT          : find seed nodes by a top-down tree search expanding only the best INT subtrees at each level, instead of ranking all nodes, 0 for ranking all nodes [" << DEFAULT_SEED_BEAM << "]" << endl
 		 << "            -d  DBL              : max p-dist difference allowed for sub-optimal seeds used in the 'Estimate' stage of SEP algorithm [" << DEFAULT_MAX_DIFF << "]" << endl
 		 << "            -e|--err  DBL        : max placement error used in the 'Estimate' stage of SEP algorithm [" << DEFAULT_MAX_PLACE_ERROR << "]" << endl
 		 << "            -m|--method  STR     : branch length estimating method during the estimated-placement stage, must be one of 'unweighted' or 'weighted' [" << DEFAULT_BRANCH_EST_METHOD << "]" << endl
@@ -97,408 +118,503 @@ void printUsage(const string& progName) {
 		 << "            --chimera-lod  DBL   : min log-odd required for defining a chimera read between best- and alt- segment alignments [" << DEFAULT_MIN_CHIMERA_LOD << "]" << endl
 		 << "            --chimera-out  FILE  : keep assignment output of chimera reads in FILE" << ZLIB_SUPPORT << endl
 		 << "            --chimera-info  FLAG : report detailed chimera information in assignment outputs" << endl
-		 << "            -S|--seed  INT       : random seed used for CSFM-index seed searches, for debug only" << endl
+		 << "            -S|--seed  INT       : random seed used for CSFM-index seed searches, results are reproducible with the same seed regardless of -p" << endl
 #ifdef _OPENMP
 		 << "            -p|--process INT     : number of threads/cpus used for parallel processing" << endl
 #endif
 		 << "            --align-only  FLAG   : only align the read but not try to place it into the tree, this will make " + progName + " behaviors like an HMM aligner" << endl
+		 << "            --compact-align  FLAG: write the aligned seqs in assignment outputs compactly with runs of gaps/paddings as their lengths, which can be read by all downstream " + progName + " tools" << endl
+		 << "            --checkpoint  INT    : save progress to the checkpoint file OUTPUT" + CHECKPOINT_FILE_SUFFIX + " after about every INT reads/pairs are written, 0 for no checkpoints, requires uncompressed output files given by -o, -a and --chimera-out [" << DEFAULT_CHECKPOINT_INTERVAL << "]" << endl
+		 << "            --resume  FLAG       : resume an interrupted run from its checkpoint file, appending to the existing outputs; all other options must be the same as the interrupted run" << endl
+		 << "            --shard  STR         : only process reads/pairs with 0-based index % n == i, given as 'i/n', for splitting one run into n independent jobs; -S is required and the strand test always uses the first -t reads of the whole input" << endl
+		 << "            --merge-shards  FILE : merge assignment or chimera outputs of all shards, given in shard order 0 to n-1, back into the input order of READ-FILE1 FILE, with the header of the first shard" << endl
+		 << "            --manifest  FILE     : assign multiple samples with the database loaded once, FILE is a tab-delimited file with lines of 'SAMPLE READ-FILE1 [READ-FILE2] OUTPUT', -o, -a and --chimera-out are not allowed" << endl
+		 << "            --otu-table  FILE    : in addition to the assignment outputs, write the OTU table of all samples to FILE as 'hmmufotu-sum' does with its default filters" << ZLIB_SUPPORT << endl
+		 << "            --server  FLAG       : run as a server that loads the database once and assigns reads sent by hmmufotu-client, requests are read from stdin and responses written to stdout by default" << endl
+		 << "            --listen  FILE       : in server mode, accept client connections on the Unix socket FILE instead of using stdin/stdout" << endl
+		 << "            --stats  FILE        : write the time spent in each assignment stage and counters of all samples to FILE in JSON format, with -v progress is also reported every " << PROGRESS_INTERVAL << " seconds" << endl
 		 << "            -v  FLAG             : enable verbose information, you may set multiple -v for more details" << endl
 		 << "            --version            : show program version and exit" << endl
 		 << "            -h|--help            : print this message and exit" << endl;
 }
 
-int main(int argc, char* argv[]) {
-	/* variable declarations */
-	/* filenames */
-	string dbName, fwdFn, revFn, msaFn, csfmFn, hmmFn, ptuFn;
-	string outFn, alnFn;
-	string chiOutFn;
-	/* input */
-	ifstream msaIn, csfmIn, hmmIn, ptuIn;
-	boost::iostreams::filtering_istream fwdIn, revIn;
-	/* output */
-	boost::iostreams::filtering_ostream out, alnOut;
-	boost::iostreams::filtering_ostream chiOut;
-	/* other */
-	string seqFmt; /* seq file format */
-	string estMethod = DEFAULT_BRANCH_EST_METHOD;
-	SeqIO fwdSeqI, revSeqI, alnSeqO;
-
-	int rStrand = DEFAULT_READ_STRAND;
-	int nTest = DEFAULT_STRAND_TEST;
-
-	bool ignoreOrient = false; /* ignore orientation errors */
-	bool isAssembled = true; /* assume assembled seq if not paired-end */
-	bool alignOnly = false;
-	BandedHMMP7::align_mode mode;
-
-	int seedLen = DEFAULT_SEED_LEN;
-	int seedRegion = DEFAULT_SEED_REGION;
-	double maxDiff = DEFAULT_MAX_DIFF;
-	int maxNSeed = DEFAULT_MAX_NSEED;
-	double maxError = DEFAULT_MAX_PLACE_ERROR;
-	bool onlyML = false;
-	PTUnrooted::PRIOR_TYPE myPrior = PTUnrooted::UNIFORM;
-	bool checkChimera = false;
-	int numSeg = DEFAULT_NUM_SEGMENT;
-	double maxChimeraError = maxError / numSeg;
-	double minChimeraLod = DEFAULT_MIN_CHIMERA_LOD;
-	bool chimeraInfo = false;
-
-	int nThreads = DEFAULT_NUM_THREADS;
-
-	unsigned seed = time(NULL); // using time as default seed
-
-	/* parse options */
-	CommandOptions cmdOpts(argc, argv);
-	if(cmdOpts.empty() || cmdOpts.hasOpt("-h") || cmdOpts.hasOpt("--help")) {
-		printIntro();
-		printUsage(argv[0]);
-		return EXIT_SUCCESS;
-	}
 
-	if(cmdOpts.hasOpt("--version")) {
-		printVersion(argv[0]);
-		return EXIT_SUCCESS;
-	}
+/**
+ * Options of assigning reads, set by the command line or by a server request
+ */
+struct AssignOptions {
+	/** construct options with default values */
+	AssignOptions();
+
+	string fwdFn; /* forward/assembled read file */
+	string revFn; /* reverse read file, empty if not paired-end */
+	string alnFn; /* alignment output file */
+	string chiOutFn; /* chimera assignment output file */
+	string seqFmt; /* seq file format */
+	string estMethod;
+
+	int rStrand;
+	int nTest;
+
+	bool ignoreOrient; /* ignore orientation errors */
+	bool isAssembled; /* assume assembled seq if not paired-end */
+	bool alignOnly;
+	bool compactAlign; /* write encoded aligned seqs */
+
+	int seedLen;
+	int seedRegion;
+	double maxDiff;
+	int maxNSeed;
+	int seedBeam;
+	double maxError;
+	bool onlyML;
+	PTUnrooted::PRIOR_TYPE myPrior;
+	bool checkChimera;
+	int numSeg;
+	double maxChimeraError;
+	double minChimeraLod;
+	bool chimeraInfo;
+
+	unsigned seed;
+
+	int shardIdx; /* only process reads with index % numShard == shardIdx */
+	int numShard;
+};
+
+AssignOptions::AssignOptions() : estMethod(DEFAULT_BRANCH_EST_METHOD),
+		rStrand(DEFAULT_READ_STRAND), nTest(DEFAULT_STRAND_TEST),
+		ignoreOrient(false), isAssembled(true), alignOnly(false), compactAlign(false),
+		seedLen(DEFAULT_SEED_LEN), seedRegion(DEFAULT_SEED_REGION),
+		maxDiff(DEFAULT_MAX_DIFF), maxNSeed(DEFAULT_MAX_NSEED), seedBeam(DEFAULT_SEED_BEAM),
+		maxError(DEFAULT_MAX_PLACE_ERROR), onlyML(false), myPrior(PTUnrooted::UNIFORM),
+		checkChimera(false), numSeg(DEFAULT_NUM_SEGMENT), maxChimeraError(maxError / numSeg),
+		minChimeraLod(DEFAULT_MIN_CHIMERA_LOD), chimeraInfo(false),
+		seed(time(NULL)), // using time as default seed
+		shardIdx(0), numShard(1)
+{ }
 
-	if(!(cmdOpts.numMainOpts() == 2 || cmdOpts.numMainOpts() == 3)) {
-		cerr << "Error:" << endl;
-		printUsage(argv[0]);
-		return EXIT_FAILURE;
+/**
+ * Set the seq format of reads to the one given by --fmt, or guessed by the name of fwdFn
+ * @throw std::invalid_argument if the format is not supported
+ */
+void setReadFormat(AssignOptions& opts) {
+	if(opts.seqFmt.empty()) {
+		string seqPre = opts.fwdFn;
+		StringUtils::removeEnd(seqPre, GZIP_FILE_SUFFIX);
+		StringUtils::removeEnd(seqPre, BZIP2_FILE_SUFFIX);
+		opts.seqFmt = SeqUtils::guessSeqFileFormat(seqPre);
 	}
-	dbName = cmdOpts.getMainOpt(0);
-	fwdFn = cmdOpts.getMainOpt(1);
-	if(cmdOpts.numMainOpts() == 3)
-		revFn = cmdOpts.getMainOpt(2);
-
-	if(cmdOpts.hasOpt("-o"))
-		outFn = cmdOpts.getOpt("-o");
+	if(!(opts.seqFmt == "fasta" || opts.seqFmt == "fastq"))
+		throw std::invalid_argument("Unsupported sequence format '" + opts.seqFmt + "'");
+}
 
+/**
+ * Parse and validate the assignment options, fwdFn should be set before parsing for guessing the seq format
+ * @throw std::invalid_argument if any option is invalid
+ */
+void parseAssignOptions(const CommandOptions& cmdOpts, AssignOptions& opts) {
 	if(cmdOpts.hasOpt("-a"))
-		alnFn = cmdOpts.getOpt("-a");
+		opts.alnFn = cmdOpts.getOpt("-a");
 
 	if(cmdOpts.hasOpt("--fmt"))
-		seqFmt = cmdOpts.getOpt("--fmt");
+		opts.seqFmt = cmdOpts.getOpt("--fmt");
 
 	if(cmdOpts.hasOpt("-L"))
-		seedLen = ::atoi(cmdOpts.getOptStr("-L"));
+		opts.seedLen = ::atoi(cmdOpts.getOptStr("-L"));
 	if(cmdOpts.hasOpt("--seed-len"))
-		seedLen = ::atoi(cmdOpts.getOptStr("--seed-len"));
+		opts.seedLen = ::atoi(cmdOpts.getOptStr("--seed-len"));
 
 	if(cmdOpts.hasOpt("-R"))
-		seedRegion = ::atoi(cmdOpts.getOptStr("-R"));
+		opts.seedRegion = ::atoi(cmdOpts.getOptStr("-R"));
 
 	if(cmdOpts.hasOpt("-i") || cmdOpts.hasOpt("--ignore"))
-		ignoreOrient = true;
+		opts.ignoreOrient = true;
 
 	if(cmdOpts.hasOpt("--single"))
-		isAssembled = false;
+		opts.isAssembled = false;
 
 	if(cmdOpts.hasOpt("-s"))
-		rStrand = ::atoi(cmdOpts.getOptStr("-s"));
+		opts.rStrand = ::atoi(cmdOpts.getOptStr("-s"));
 	if(cmdOpts.hasOpt("--strand"))
-		rStrand = ::atoi(cmdOpts.getOptStr("--strand"));
+		opts.rStrand = ::atoi(cmdOpts.getOptStr("--strand"));
 
 	if(cmdOpts.hasOpt("-t"))
-		nTest = ::atoi(cmdOpts.getOptStr("-t"));
+		opts.nTest = ::atoi(cmdOpts.getOptStr("-t"));
 	if(cmdOpts.hasOpt("--test"))
-		nTest = ::atoi(cmdOpts.getOptStr("--test"));
+		opts.nTest = ::atoi(cmdOpts.getOptStr("--test"));
 
 	if(cmdOpts.hasOpt("-d"))
-		maxDiff = ::atof(cmdOpts.getOptStr("-d"));
+		opts.maxDiff = ::atof(cmdOpts.getOptStr("-d"));
 
 	if(cmdOpts.hasOpt("-N"))
-		maxNSeed = ::atoi(cmdOpts.getOptStr("-N"));
+		opts.maxNSeed = ::atoi(cmdOpts.getOptStr("-N"));
+
+	if(cmdOpts.hasOpt("--beam"))
+		opts.seedBeam = ::atoi(cmdOpts.getOptStr("--beam"));
 
 	if(cmdOpts.hasOpt("-e"))
-		maxError = ::atof(cmdOpts.getOptStr("-e"));
+		opts.maxError = ::atof(cmdOpts.getOptStr("-e"));
 	if(cmdOpts.hasOpt("--err"))
-		maxError = ::atof(cmdOpts.getOptStr("--err"));
+		opts.maxError = ::atof(cmdOpts.getOptStr("--err"));
 
 	if(cmdOpts.hasOpt("-m"))
-		estMethod = cmdOpts.getOpt("-m");
+		opts.estMethod = cmdOpts.getOpt("-m");
 	if(cmdOpts.hasOpt("--method"))
-		estMethod = cmdOpts.getOpt("--method");
+		opts.estMethod = cmdOpts.getOpt("--method");
 
 	if(cmdOpts.hasOpt("--ML"))
-		onlyML = true;
+		opts.onlyML = true;
 
 	if(cmdOpts.hasOpt("--prior")) {
 		if(cmdOpts.getOpt("--prior") == "uniform")
-			myPrior = PTUnrooted::UNIFORM;
+			opts.myPrior = PTUnrooted::UNIFORM;
 		else if(cmdOpts.getOpt("--prior") == "height")
-			myPrior = PTUnrooted::HEIGHT;
-		else {
-			cerr << "Unsupported prior specified, check the --prior option" << endl;
-			return EXIT_FAILURE;
-		}
+			opts.myPrior = PTUnrooted::HEIGHT;
+		else
+			throw std::invalid_argument("Unsupported prior specified, check the --prior option");
 	}
 
 	if(cmdOpts.hasOpt("-C") || cmdOpts.hasOpt("--chimera")) {
-		checkChimera = true;
+		opts.checkChimera = true;
 		if(cmdOpts.hasOpt("--num-segment"))
-			numSeg = ::atof(cmdOpts.getOptStr("--num-segment"));
+			opts.numSeg = ::atof(cmdOpts.getOptStr("--num-segment"));
 		if(cmdOpts.hasOpt("--chimera-err"))
-			maxChimeraError = ::atof(cmdOpts.getOptStr("--chimera-err"));
+			opts.maxChimeraError = ::atof(cmdOpts.getOptStr("--chimera-err"));
 		if(cmdOpts.hasOpt("--chimera-lod"))
-			minChimeraLod = ::atof(cmdOpts.getOptStr("--chimera-lod"));
+			opts.minChimeraLod = ::atof(cmdOpts.getOptStr("--chimera-lod"));
 		if(cmdOpts.hasOpt("--chimera-out"))
-			chiOutFn = cmdOpts.getOpt("--chimera-out");
+			opts.chiOutFn = cmdOpts.getOpt("--chimera-out");
 		if(cmdOpts.hasOpt("--chimera-info"))
-			chimeraInfo = true;
+			opts.chimeraInfo = true;
 	}
 
 	if(cmdOpts.hasOpt("-S"))
-		seed = ::atoi(cmdOpts.getOptStr("-S"));
+		opts.seed = ::atoi(cmdOpts.getOptStr("-S"));
 	if(cmdOpts.hasOpt("--seed"))
-		seed = ::atoi(cmdOpts.getOptStr("--seed"));
-	srand(seed);
-
-#ifdef _OPENMP
-	if(cmdOpts.hasOpt("-p"))
-		nThreads = ::atoi(cmdOpts.getOptStr("-p"));
-	if(cmdOpts.hasOpt("--process"))
-		nThreads = ::atoi(cmdOpts.getOptStr("--process"));
-#endif
+		opts.seed = ::atoi(cmdOpts.getOptStr("--seed"));
 
 	if(cmdOpts.hasOpt("--align-only"))
-		alignOnly = true;
-	if(cmdOpts.hasOpt("-v"))
-		INCREASE_LEVEL(cmdOpts.getOpt("-v").length());
-
-	/* guess fwdSeq format */
-	if(seqFmt.empty()) {
-		string seqPre = fwdFn;
-		StringUtils::removeEnd(seqPre, GZIP_FILE_SUFFIX);
-		StringUtils::removeEnd(seqPre, BZIP2_FILE_SUFFIX);
-		seqFmt = SeqUtils::guessSeqFileFormat(seqPre);
-	}
-	if(!(seqFmt == "fasta" || seqFmt == "fastq")) {
-		cerr << "Unsupported sequence format '" << seqFmt << "'" << endl;
-		return EXIT_FAILURE;
+		opts.alignOnly = true;
+
+	if(cmdOpts.hasOpt("--compact-align"))
+		opts.compactAlign = true;
+
+	if(cmdOpts.hasOpt("--shard")) {
+		const string& shard = cmdOpts.getOpt("--shard");
+		if(::sscanf(shard.c_str(), "%d/%d", &opts.shardIdx, &opts.numShard) != 2)
+			throw std::invalid_argument("--shard must be in the format of 'i/n'");
+		if(!(opts.numShard > 0 && 0 <= opts.shardIdx && opts.shardIdx < opts.numShard))
+			throw std::invalid_argument("--shard i/n must have 0 <= i < n");
+		if(!(cmdOpts.hasOpt("-S") || cmdOpts.hasOpt("--seed")))
+			throw std::invalid_argument("--shard requires -S|--seed so all shards use the same random seed");
 	}
 
+	if(!opts.fwdFn.empty()) /* samples in a manifest are set separately */
+		setReadFormat(opts);
+
 	/* validate options */
-	if(!(0 <= rStrand && rStrand <= 2)) {
-		cerr << "-s|--strand must be 0, 1, or 2" << endl;
-		return EXIT_FAILURE;
-	}
-	if(rStrand != 0 && !(MIN_STRAND_TEST <= nTest && nTest <= MAX_STRAND_TEST)) {
-		cerr << "-t|--test must between " << MIN_STRAND_TEST << " and " << MAX_STRAND_TEST << endl;
-		return EXIT_FAILURE;
-	}
-	if(!(MIN_SEED_LEN <= seedLen && seedLen <= MAX_SEED_LEN)) {
-		cerr << "-L|--seed-len must be in range [" << MIN_SEED_LEN << ", " << MAX_SEED_LEN << "]" << endl;
-		return EXIT_FAILURE;
-	}
-	if(seedRegion < seedLen) {
-		cerr << "-R cannot be smaller than -L" << endl;
-		return EXIT_FAILURE;
-	}
-	if(!(maxDiff >= 0)) {
-		cerr << "-d must be non-negative" << endl;
-		return EXIT_FAILURE;
-	}
-	if(!(maxNSeed > 0)) {
-		cerr << "-N must be positive" << endl;
-		return EXIT_FAILURE;
-	}
-	if(!(maxError > 0)) {
-		cerr << "-e|--err must be positive" << endl;
-		return EXIT_FAILURE;
-	}
-	if(!(MIN_NUM_SEGMENT <= numSeg && numSeg <= MAX_NUM_SEGMENT)) {
-		cerr << "--num-segment must be in [" << MIN_NUM_SEGMENT << ", " << MAX_NUM_SEGMENT << "]" << endl;
-		return EXIT_FAILURE;
-	}
-	if(numSeg % 2) {
-		cerr << "--num-segment must be an even number" << endl;
-		return EXIT_FAILURE;
-	}
-	if(!(maxChimeraError > 0)) {
-		cerr << "--chimera-err must be positive" << endl;
-		return EXIT_FAILURE;
-	}
-	if(!(minChimeraLod >= 0)) {
-		cerr << "--chimera-lod must be non-negative" << endl;
-		return EXIT_FAILURE;
-	}
+	if(!(0 <= opts.rStrand && opts.rStrand <= 2))
+		throw std::invalid_argument("-s|--strand must be 0, 1, or 2");
+	if(opts.rStrand != 0 && !(MIN_STRAND_TEST <= opts.nTest && opts.nTest <= MAX_STRAND_TEST))
+		throw std::invalid_argument("-t|--test must between " + boost::lexical_cast<string>(MIN_STRAND_TEST)
+				+ " and " + boost::lexical_cast<string>(MAX_STRAND_TEST));
+	if(!(MIN_SEED_LEN <= opts.seedLen && opts.seedLen <= MAX_SEED_LEN))
+		throw std::invalid_argument("-L|--seed-len must be in range [" + boost::lexical_cast<string>(MIN_SEED_LEN)
+				+ ", " + boost::lexical_cast<string>(MAX_SEED_LEN) + "]");
+	if(opts.seedRegion < opts.seedLen)
+		throw std::invalid_argument("-R cannot be smaller than -L");
+	if(!(opts.maxDiff >= 0))
+		throw std::invalid_argument("-d must be non-negative");
+	if(!(opts.maxNSeed > 0))
+		throw std::invalid_argument("-N must be positive");
+	if(!(opts.seedBeam >= 0))
+		throw std::invalid_argument("--beam must be non-negative");
+	if(!(opts.maxError > 0))
+		throw std::invalid_argument("-e|--err must be positive");
+	if(!(MIN_NUM_SEGMENT <= opts.numSeg && opts.numSeg <= MAX_NUM_SEGMENT))
+		throw std::invalid_argument("--num-segment must be in [" + boost::lexical_cast<string>(MIN_NUM_SEGMENT)
+				+ ", " + boost::lexical_cast<string>(MAX_NUM_SEGMENT) + "]");
+	if(opts.numSeg % 2)
+		throw std::invalid_argument("--num-segment must be an even number");
+	if(!(opts.maxChimeraError > 0))
+		throw std::invalid_argument("--chimera-err must be positive");
+	if(!(opts.minChimeraLod >= 0))
+		throw std::invalid_argument("--chimera-lod must be non-negative");
+}
 
-#ifdef _OPENMP
-	if(!(nThreads > 0)) {
-		cerr << "-p|--process must be positive" << endl;
-		return EXIT_FAILURE;
+/**
+ * Count an assigned read to its OTU in memory, as hmmufotu-sum does with its default filters
+ * @param s  sample index of this read
+ * @param S  total number of samples
+ */
+void addOTURead(OTUMap& otuData, const PTUnrooted& ptu, const DegenAlphabet* abc,
+		const PTUnrooted::PTPlacement& place, const string& align, int s, int S) {
+	const long taxonId = place.getTaxonId();
+	if(!(taxonId >= 0 && place.qTaxon >= 0)) /* not a valid assignment */
+		return;
+	const PTUnrooted::PTUNodePtr node = ptu.getNode(taxonId);
+	const int L = ptu.numAlignSites();
+	OTUMap::iterator it = otuData.find(node);
+	if(it == otuData.end()) /* not initiated */
+		it = otuData.insert(std::make_pair(node, OTUObserved(boost::lexical_cast<string>(taxonId), node->getTaxon(), L, S))).first;
+	OTUObserved& otu = it->second;
+	otu.count(s)++;
+	for(int j = 0; j < L; ++j) {
+		int8_t b = abc->encode(::toupper(align[j]));
+		if(b >= 0)
+			otu.freq(b, j)++;
+		else
+			otu.gap(j)++;
 	}
-	omp_set_num_threads(nThreads);
-#endif
+}
 
-	bool isSingle = revFn.empty();
-	/* set filenames */
-	msaFn = dbName + MSA_FILE_SUFFIX;
-	csfmFn = dbName + CSFM_FILE_SUFFIX;
-	hmmFn = dbName + HMM_FILE_SUFFIX;
-	ptuFn = dbName + PHYLOTREE_FILE_SUFFIX;
+/** Buffered outputs of a read/pair */
+struct ReadOutput {
+	ReadOutput() : endRead(0) {  }
+
+	ReadOutput(long endRead, const string& assign, const string& align, const string& chimera)
+	: endRead(endRead), assign(assign), align(align), chimera(chimera)
+	{  }
+
+	long endRead; /* reads/pairs consumed after this read/pair */
+	string assign;
+	string align;
+	string chimera;
+};
+
+/** Progress of an assignment run, saved periodically for resuming an interrupted run */
+struct Checkpoint {
+	Checkpoint() : nRead(0), rStrand(0), assignSize(0), alignSize(0), chimeraSize(0)
+	{  }
+
+	long nRead; /* reads/pairs consumed with all their outputs written, including reads of other shards */
+	int rStrand; /* determined read strand */
+	/* sizes of outputs written */
+	long assignSize;
+	long alignSize;
+	long chimeraSize;
+};
 
-	/* set HMM align mode */
-	mode = !revFn.empty() /* paired-end */ || isAssembled ? BandedHMMP7::GLOBAL : BandedHMMP7::NGCL;
+/**
+ * Save a checkpoint atomically by writing a temporary file and renaming it
+ * @return  true if success
+ */
+bool saveCheckpoint(const string& fn, const Checkpoint& ckpt) {
+	const string tmpFn = fn + ".tmp";
+	ofstream out(tmpFn.c_str());
+	writeProgInfo(out, " checkpoint");
+	out << "reads\t" << ckpt.nRead << endl
+		<< "strand\t" << ckpt.rStrand << endl
+		<< "assign\t" << ckpt.assignSize << endl
+		<< "align\t" << ckpt.alignSize << endl
+		<< "chimera\t" << ckpt.chimeraSize << endl;
+	out.close();
+	return !out.fail() && ::rename(tmpFn.c_str(), fn.c_str()) == 0;
+}
 
-	/* open inputs */
-	msaIn.open(msaFn.c_str(), ios_base::in | ios_base::binary);
-	if(!msaIn) {
-		cerr << "Unable to open MSA data '" << msaFn << "': " << ::strerror(errno) << endl;
-		return EXIT_FAILURE;
+/**
+ * Load a checkpoint
+ * @return  true if success
+ */
+bool loadCheckpoint(const string& fn, Checkpoint& ckpt) {
+	ifstream in(fn.c_str());
+	string line;
+	while(std::getline(in, line)) {
+		if(line.empty() || line[0] == '#')
+			continue;
+		std::istringstream fields(line);
+		string key;
+		long value;
+		if(!(fields >> key >> value))
+			return false;
+		if(key == "reads")
+			ckpt.nRead = value;
+		else if(key == "strand")
+			ckpt.rStrand = value;
+		else if(key == "assign")
+			ckpt.assignSize = value;
+		else if(key == "align")
+			ckpt.alignSize = value;
+		else if(key == "chimera")
+			ckpt.chimeraSize = value;
+		else { }
 	}
+	return in.eof() && ckpt.rStrand != 0;
+}
 
-	csfmIn.open(csfmFn.c_str(), ios_base::in | ios_base::binary);
-	if(!csfmIn) {
-		cerr << "Unable to open CSFM-index '" << csfmFn << "': " << ::strerror(errno) << endl;
-		return EXIT_FAILURE;
-	}
+/**
+ * Flush all outputs, then save a checkpoint of them
+ */
+void flushCheckpoint(const string& fn, const Checkpoint& ckpt, ostream& out, ostream* alnOut, ostream* chiOut) {
+	out.flush();
+	if(alnOut != NULL)
+		alnOut->flush();
+	if(chiOut != NULL)
+		chiOut->flush();
+	if(!saveCheckpoint(fn, ckpt))
+		warningLog << "Unable to save checkpoint file '" << fn << "': " << ::strerror(errno) << endl;
+}
 
-	hmmIn.open(hmmFn.c_str());
-	if(!hmmIn) {
-		cerr << "Unable to open HMM profile '" << hmmFn << "': " << ::strerror(errno) << endl;
-		return EXIT_FAILURE;
+/**
+ * Truncate an output file to the size recorded in a checkpoint, discarding data written after it
+ * @return  true if success, or false with errno set
+ */
+bool truncateOutput(const string& fn, long size) {
+	struct stat fileStat;
+	if(::stat(fn.c_str(), &fileStat) != 0)
+		return false;
+	if(fileStat.st_size < size) { /* outputs lost after the checkpoint */
+		errno = EINVAL;
+		return false;
 	}
+	return ::truncate(fn.c_str(), size) == 0;
+}
 
-	ptuIn.open(ptuFn.c_str(), ios_base::in | ios_base::binary);
-	if(!ptuIn) {
-		cerr << "Unable to open PTU data '" << ptuFn << "': " << ::strerror(errno) << endl;
-		return EXIT_FAILURE;
+/** A sample to be assigned */
+struct SampleInfo {
+	SampleInfo(const string& name, const string& fwdFn, const string& revFn, const string& outFn)
+	: name(name), fwdFn(fwdFn), revFn(revFn), outFn(outFn)
+	{  }
+
+	string name;
+	string fwdFn;
+	string revFn; /* empty if not paired-end */
+	string outFn; /* empty for stdout */
+};
+
+/**
+ * Read samples from a manifest file, with each non-comment line as 'SAMPLE READ-FILE1 [READ-FILE2] OUTPUT'
+ * @throw std::invalid_argument if a line is malformed
+ */
+vector<SampleInfo> readManifest(istream& in) {
+	vector<SampleInfo> samples;
+	string line;
+	for(size_t i = 1; std::getline(in, line); ++i) {
+		StringUtils::removeEnd(line, "\r");
+		if(line.empty() || line[0] == '#')
+			continue;
+		vector<string> fields;
+		boost::split(fields, line, boost::is_any_of("\t"));
+		if(!(fields.size() == 3 || fields.size() == 4))
+			throw std::invalid_argument("Malformed manifest line " + boost::lexical_cast<string>(i) + ", expecting 3 or 4 tab-delimited fields");
+		samples.push_back(SampleInfo(fields.front(), fields[1], fields.size() == 4 ? fields[2] : "", fields.back()));
 	}
+	return samples;
+}
 
-	/* open outputs */
+/**
+ * Open a (compressed) input file
+ * @return  true if success
+ */
+bool openInput(boost::iostreams::filtering_istream& in, const string& fn) {
 #ifdef HAVE_LIBZ
-	if(StringUtils::endsWith(outFn, GZIP_FILE_SUFFIX)) /* empty outFn won't match */
+	if(StringUtils::endsWith(fn, GZIP_FILE_SUFFIX))
+		in.push(boost::iostreams::gzip_decompressor());
+	else if(StringUtils::endsWith(fn, BZIP2_FILE_SUFFIX))
+		in.push(boost::iostreams::bzip2_decompressor());
+	else { }
+#endif
+	in.push(boost::iostreams::file_source(fn));
+	return !in.bad();
+}
+
+/**
+ * Open a (compressed) output file, or stdout if fn is empty
+ * @param append  append to an existing file
+ * @return  true if success
+ */
+bool openOutput(boost::iostreams::filtering_ostream& out, const string& fn, bool append = false) {
+#ifdef HAVE_LIBZ
+	if(StringUtils::endsWith(fn, GZIP_FILE_SUFFIX)) /* empty fn won't match */
 		out.push(boost::iostreams::gzip_compressor());
-	else if(StringUtils::endsWith(outFn, BZIP2_FILE_SUFFIX)) /* empty outFn won't match */
+	else if(StringUtils::endsWith(fn, BZIP2_FILE_SUFFIX)) /* empty fn won't match */
 		out.push(boost::iostreams::bzip2_compressor());
 	else { }
 #endif
-	if(!outFn.empty())
-		out.push(boost::iostreams::file_sink(outFn));
+	if(!fn.empty())
+		out.push(boost::iostreams::file_sink(fn, append ? std::ios_base::app : std::ios_base::out));
 	else
 		out.push(std::cout);
-	if(out.bad()) {
-		cerr << "Unable to write to "
-				<< (!outFn.empty() ? " out file '" + outFn + "' " : "stdout ")
-				<< ::strerror(errno) << endl;
-		return EXIT_FAILURE;
-	}
+	return !out.bad();
+}
 
-	if(!alnFn.empty()) {
-#ifdef HAVE_LIBZ
-		if(StringUtils::endsWith(alnFn, GZIP_FILE_SUFFIX))
-			alnOut.push(boost::iostreams::gzip_compressor());
-		else if(StringUtils::endsWith(alnFn, BZIP2_FILE_SUFFIX))
-			alnOut.push(boost::iostreams::bzip2_compressor());
-		else { }
-#endif
-		alnOut.push(boost::iostreams::file_sink(alnFn));
-		if(alnOut.bad()) {
-			cerr << "Unable to write to align file '" << alnFn << "' " << ::strerror(errno) << endl;
-			return EXIT_FAILURE;
-		}
-	}
+/**
+ * Open an assignment output as openOutput, in the binary format if fn ends with ASSIGN_BIN_FILE_SUFFIX
+ * @return  true if success
+ */
+bool openAssignOutput(boost::iostreams::filtering_ostream& out, const string& fn, bool append = false) {
+	if(AssignBinIO::isBinFile(fn))
+		out.push(AssignBinWriter());
+	return openOutput(out, fn, append);
+}
 
-	if(!chiOutFn.empty()) {
-#ifdef HAVE_LIBZ
-		if(StringUtils::endsWith(chiOutFn, GZIP_FILE_SUFFIX))
-			chiOut.push(boost::iostreams::gzip_compressor());
-		else if(StringUtils::endsWith(outFn, BZIP2_FILE_SUFFIX))
-			chiOut.push(boost::iostreams::bzip2_compressor());
-		else { }
+/** get the stats of the calling thread */
+/**
+ * write an alignment as in the assignment output, with the aligned seq optionally encoded
+ */
+ostream& writeAlign(ostream& out, const BandedHMMP7::HmmAlignment& aln, bool compact) {
+	if(!compact)
+		return out << aln;
+	return out << aln.seqStart << "\t" << aln.seqEnd << "\t" <<
+			aln.hmmStart << "\t" << aln.hmmEnd << "\t" <<
+			aln.csStart << "\t" << aln.csEnd << "\t" <<
+			aln.cost << "\t" << BandedHMMP7::HmmAlignment::encodeAlign(aln.align);
+}
+
+StageStats& getThreadStats(vector<StageStats>& threadStats) {
+#ifdef _OPENMP
+	return threadStats[omp_get_thread_num()];
+#else
+	return threadStats[0];
 #endif
-		chiOut.push(boost::iostreams::file_sink(chiOutFn));
-		if(chiOut.bad()) {
-			cerr << "Unable to write to '" + chiOutFn + "' " << ::strerror(errno) << endl;
-			return EXIT_FAILURE;
-		}
-	}
+}
 
-	/* loading database files */
-	if(loadProgInfo(msaIn).bad())
-		return EXIT_FAILURE;
-	MSA msa;
-	msa.load(msaIn);
-	if(msaIn.bad()) {
-		cerr << "Failed to load MSA data '" << msaFn << "': " << ::strerror(errno) << endl;
-		return EXIT_FAILURE;
-	}
-	int csLen = msa.getCSLen();
-	infoLog << "MSA loaded" << endl;
+/** add the accurate placements and their branch length iterations to stats */
+void addPlaceStats(StageStats& stats, const vector<PTUnrooted::PTPlacement>& places) {
+	stats.add(COUNTER_PLACED, places.size());
+	for(vector<PTUnrooted::PTPlacement>::const_iterator place = places.begin(); place != places.end(); ++place)
+		stats.add(COUNTER_BRANCH_ITER, place->nIter);
+}
 
-	BandedHMMP7 hmm;
-	hmmIn >> hmm;
-	if(hmmIn.bad()) {
-		cerr << "Unable to read HMM profile '" << hmmFn << "': " << ::strerror(errno) << endl;
-		return EXIT_FAILURE;
-	}
-	infoLog << "HMM profile read" << endl;
-	if(hmm.getProfileSize() > csLen) {
-		cerr << "Error: HMM profile size is found greater than the MSA CS length" << endl;
-		return EXIT_FAILURE;
-	}
+/**
+ * Assign reads using a loaded database, and write the assignment outputs
+ * @param cmdOpts  command line written to the output headers
+ * @param revIn  reverse read input, or NULL if not paired-end
+ * @param testIn  another forward read input for determining the read strand, only used if opts.rStrand is 0
+ * @param alnOut  alignment output, or NULL
+ * @param chiOut  chimera assignment output, or NULL
+ * @param otuData  if not NULL, assigned reads are also counted to their OTUs as sample s of total S samples
+ * @param ckptFn  checkpoint file saved after about every ckptInterval reads/pairs written, if ckptInterval > 0
+ * @param resumeFrom  if not NULL, resume from this checkpoint and append to outputs
+ * @param stats  if not NULL, stage times and counters of all threads are added to it
+ * @throw std::runtime_error if the read strand cannot be determined
+ */
+void assignReads(BandedHMMP7& hmm, const CSFMIndex& csfm, const PTUnrooted& ptu,
+		const AssignOptions& opts, const CommandOptions& cmdOpts,
+		istream* fwdIn, istream* revIn, istream* testIn,
+		ostream& out, ostream* alnOut, ostream* chiOut,
+		OTUMap* otuData = NULL, int s = 0, int S = 1,
+		const string& ckptFn = "", long ckptInterval = 0, const Checkpoint* resumeFrom = NULL,
+		StageStats* stats = NULL) {
 	const DegenAlphabet* abc = hmm.getNuclAbc();
-
-	if(loadProgInfo(csfmIn).bad())
-		return EXIT_FAILURE;
-	CSFMIndex csfm;
-	csfm.load(csfmIn);
-	if(csfmIn.bad()) {
-		cerr << "Failed to load CSFM-index '" << csfmFn << "': " << ::strerror(errno) << endl;
-		return EXIT_FAILURE;
-	}
-	infoLog << "CSFM-index loaded" << endl;
-	if(csfm.getCSLen() != csLen) {
-		cerr << "Error: Unmatched CS length between CSFM-index and MSA data" << endl;
-		return EXIT_FAILURE;
-	}
-
-	if(loadProgInfo(ptuIn).bad())
-		return EXIT_FAILURE;
-	PTUnrooted ptu;
-	if(!alignOnly) {
-		ptu.load(ptuIn);
-		if(ptuIn.bad()) {
-			cerr << "Unable to load Phylogenetic tree data '" << ptuFn << "': " << ::strerror(errno) << endl;
-			return EXIT_FAILURE;
-		}
-		infoLog << "Phylogenetic tree loaded" << endl;
-	}
-
-	/* configure HMM mode */
+	/* set HMM align mode */
+	const BandedHMMP7::align_mode mode = revIn != NULL /* paired-end */ || opts.isAssembled ? BandedHMMP7::GLOBAL : BandedHMMP7::NGCL;
 	hmm.setSequenceMode(mode);
-	hmm.wingRetract();
 
 	/* determine strandness if requested using forward reads */
+	Checkpoint ckpt = resumeFrom != NULL ? *resumeFrom : Checkpoint();
+	int rStrand = resumeFrom != NULL ? resumeFrom->rStrand : opts.rStrand;
 	if(rStrand == 0) {
 		infoLog << "Determining read strand by alignment cost ..." << endl;
-		/* open test input */
-		boost::iostreams::filtering_istream testIn;
-#ifdef HAVE_LIBZ
-		if(StringUtils::endsWith(fwdFn, GZIP_FILE_SUFFIX))
-			testIn.push(boost::iostreams::gzip_decompressor());
-		else if(StringUtils::endsWith(fwdFn, BZIP2_FILE_SUFFIX))
-			testIn.push(boost::iostreams::bzip2_decompressor());
-		else { }
-#endif
-
-		testIn.push(boost::iostreams::file_source(fwdFn));
-		if(testIn.bad()) {
-			cerr << "Unable to test forward seq file '" << fwdFn << "' " << ::strerror(errno) << endl;
-			return EXIT_FAILURE;
-		}
-
-		SeqIO testSeqI(dynamic_cast<istream*>(&testIn), abc, seqFmt);
+		SeqIO testSeqI(testIn, abc, opts.seqFmt);
+		CSFMIndex::RNG testRng(opts.seed);
 		double fwdScore = 0;
 		double revScore = 0;
-		for(int i = 0; i < nTest && testSeqI.hasNext(); ++i) {
+		for(int i = 0; i < opts.nTest && testSeqI.hasNext(); ++i) {
 			PrimarySeq fwdRead = testSeqI.nextSeq();
 			PrimarySeq revRead = fwdRead.revcom();
-			const BandedHMMP7::HmmAlignment& fwdAln = alignSeq(hmm, csfm, fwdRead, seedLen, seedRegion, mode);
-			const BandedHMMP7::HmmAlignment& revAln = alignSeq(hmm, csfm, revRead, seedLen, seedRegion, mode);
+			const BandedHMMP7::HmmAlignment& fwdAln = alignSeq(hmm, csfm, fwdRead, opts.seedLen, opts.seedRegion, mode, testRng);
+			const BandedHMMP7::HmmAlignment& revAln = alignSeq(hmm, csfm, revRead, opts.seedLen, opts.seedRegion, mode, testRng);
 			if(fwdAln.cost < revAln.cost)
 				fwdScore++;
 			else
@@ -508,177 +624,199 @@ int main(int argc, char* argv[]) {
 			rStrand = 1;
 		else if(revScore >= (fwdScore + revScore) * STRAND_CONFIDENCE)
 			rStrand = 2;
-		else {
-			cerr << "Failed to determine read strandness. Try larger -t|--test or determine manually" << endl;
-			return EXIT_FAILURE;
-		}
+		else
+			throw std::runtime_error("Failed to determine read strandness. Try larger -t|--test or determine manually");
 		infoLog << "Read strand determined as " << rStrand << endl;
 	}
-	if(rStrand == 2 && !revFn.empty()) { /* use simple file swap */
-		string tmpFn = fwdFn;
-		fwdFn = revFn;
-		revFn = tmpFn;
-	}
-
-	/* (re)-open seq inputs */
-#ifdef HAVE_LIBZ
-	if(StringUtils::endsWith(fwdFn, GZIP_FILE_SUFFIX))
-		fwdIn.push(boost::iostreams::gzip_decompressor());
-	else if(StringUtils::endsWith(fwdFn, BZIP2_FILE_SUFFIX))
-		fwdIn.push(boost::iostreams::bzip2_decompressor());
-	else { }
-#endif
-
-	fwdIn.push(boost::iostreams::file_source(fwdFn));
-	if(fwdIn.bad()) {
-		cerr << "Unable to open forward seq file '" << fwdFn << "' " << ::strerror(errno) << endl;
-		return EXIT_FAILURE;
-	}
+	ckpt.rStrand = rStrand;
+	if(rStrand == 2 && revIn != NULL) /* use simple input swap */
+		std::swap(fwdIn, revIn);
 
-	if(!revFn.empty()) {
-#ifdef HAVE_LIBZ
-		if(StringUtils::endsWith(revFn, GZIP_FILE_SUFFIX))
-			revIn.push(boost::iostreams::gzip_decompressor());
-		else if(StringUtils::endsWith(revFn, BZIP2_FILE_SUFFIX))
-			revIn.push(boost::iostreams::bzip2_decompressor());
-		else { }
-#endif
-		revIn.push(boost::iostreams::file_source(revFn));
-		if(revIn.bad()) {
-			cerr << "Unable to open reverse seq file '" << revFn << "' " << ::strerror(errno) << endl;
-			return EXIT_FAILURE;
-		}
-	}
 	/* prepare SeqIO */
-	fwdSeqI.reset(dynamic_cast<istream*> (&fwdIn), abc, seqFmt);
-	if(!revFn.empty())
-		revSeqI.reset(dynamic_cast<istream*> (&revIn), abc, seqFmt);
-
-	if(!alnFn.empty())
-		alnSeqO.reset(dynamic_cast<ostream*> (&alnOut), abc, ALIGN_OUT_FMT);
+	SeqIO fwdSeqI(fwdIn, abc, opts.seqFmt);
+	SeqIO revSeqI;
+	if(revIn != NULL)
+		revSeqI.reset(revIn, abc, opts.seqFmt);
 
 	debugLog << "Sequence input and output prepared" << endl;
 
-	infoLog << "Processing read ..." << endl;
-	/* process reads and output */
-	writeProgInfo(out, string(" taxonomy assignment generated by ") + argv[0]);
-	out << "# command: "<< cmdOpts.getCmdStr() << endl;
-	out << "id\tdescription\t" << BandedHMMP7::HmmAlignment::TSV_HEADER
-			<< (chimeraInfo ? "\t" + CHIMERA_TSV_HEADER + "\t" : "\t")
-			<< PTUnrooted::PTPlacement::TSV_HEADER << endl;
-	if(chiOut.is_complete()) {
-		writeProgInfo(chiOut, string(" taxonomy assignment generated by ") + argv[0]);
-		chiOut << "# command: "<< cmdOpts.getCmdStr() << endl;
-		chiOut << "id\tdescription\t" << BandedHMMP7::HmmAlignment::TSV_HEADER
-				<< (chimeraInfo ? "\t" + CHIMERA_TSV_HEADER + "\t" : "\t")
+	if(resumeFrom != NULL) { /* skip reads/pairs with outputs already written */
+		for(long i = 0; i < ckpt.nRead && fwdSeqI.hasNext() && (revIn == NULL || revSeqI.hasNext()); ++i) {
+			fwdSeqI.nextSeq();
+			if(revIn != NULL)
+				revSeqI.nextSeq();
+		}
+		infoLog << "Resuming after " << ckpt.nRead << " reads" << endl;
+	}
+	else { /* write headers */
+		std::ostringstream header;
+		writeProgInfo(header, string(" taxonomy assignment generated by ") + cmdOpts.getProg());
+		header << "# command: "<< cmdOpts.getCmdStr() << endl;
+		header << "id\tdescription\t" << BandedHMMP7::HmmAlignment::TSV_HEADER
+				<< (opts.chimeraInfo ? "\t" + CHIMERA_TSV_HEADER + "\t" : "\t")
 				<< PTUnrooted::PTPlacement::TSV_HEADER << endl;
+		out << header.str();
+		ckpt.assignSize = header.str().length();
+		if(chiOut != NULL) {
+			*chiOut << header.str();
+			ckpt.chimeraSize = header.str().length();
+		}
 	}
 
+	infoLog << "Processing read ..." << endl;
+	/* process reads and output */
+#ifdef _OPENMP
+	vector<StageStats> threadStats(omp_get_max_threads()); /* stats of each thread, merged after all reads are done */
+#else
+	vector<StageStats> threadStats(1);
+#endif
+	const double startTime = StageStats::now();
+	double lastProgressTime = startTime;
+	const long firstRead = ckpt.nRead;
+	long nRead = ckpt.nRead;
+	long lastCkptRead = ckpt.nRead;
+	long nOut = 0;
+	long nextOut = 0; /* next read output to write */
+	std::map<long, ReadOutput> readOuts; /* finished read outputs waiting for earlier ones */
 #pragma omp parallel
 	{
 #pragma omp single
 		{
-			while(fwdSeqI.hasNext() && (revFn.empty() || revSeqI.hasNext())) {
-				string id;
-				string desc;
-				PrimarySeq fwdRead, revRead;
-				bool isPaired = true;
-				bool isChimera = false;
-				fwdRead = fwdSeqI.nextSeq();
-				id = fwdRead.getId();
-				desc = fwdRead.getDesc();
-				if(!revFn.empty()) {
+			while(fwdSeqI.hasNext() && (revIn == NULL || revSeqI.hasNext())) {
+				const long readIdx = nRead++; /* each read gets its own RNG stream, independent of threads and shards */
+				if(readIdx % opts.numShard != opts.shardIdx) { /* skip reads/pairs of other shards */
+					fwdSeqI.nextSeq();
+					if(revIn != NULL)
+						revSeqI.nextSeq();
+					continue;
+				}
+				PrimarySeq fwdRead = fwdSeqI.nextSeq();
+				PrimarySeq revRead;
+				if(revIn != NULL) {
 					revRead = revSeqI.nextSeq().revcom();
-					assert(revRead.getId() == id);
+					assert(revRead.getId() == fwdRead.getId());
 				}
-
-				if(rStrand == 2 && revFn.empty()) /* wrong strand for single-strand reads */
+				if(rStrand == 2 && revIn == NULL) /* wrong strand for single-strand reads */
 					fwdRead = fwdRead.revcom();
+				const long outIdx = nOut++;
+				const long outEndRead = nRead;
+				addQueuedTasks(1);
 #pragma omp task
 				{
-					BandedHMMP7::HmmAlignment aln;
+					addQueuedTasks(-1);
+					/* outputs are buffered and written in read order, so they are in input order regardless of threads */
+					std::ostringstream readOut, readAlnOut, readChiOut;
+					SeqIO alnSeqO;
+					if(alnOut != NULL)
+						alnSeqO.reset(&readAlnOut, abc, ALIGN_OUT_FMT);
+					StageStats& taskStats = getThreadStats(threadStats); /* a tied task always runs on the same thread */
+					CSFMIndex::RNG rng(opts.seed + readIdx);
+					const string& id = fwdRead.getId();
+					const string& desc = fwdRead.getDesc();
+					bool isChimera = false;
 					/* align fwdRead */
-					aln = alignSeq(hmm, csfm, fwdRead, seedLen, seedRegion, mode);
+					BandedHMMP7::HmmAlignment aln = alignSeq(hmm, csfm, fwdRead, opts.seedLen, opts.seedRegion, mode, rng, NULL, &taskStats);
 					assert(aln.isValid());
-					//						infoLog << "fwd seq aligned: csStart: " << csStart << " csEnd: " << csEnd << " aln: " << aln << endl;
-					if(!revFn.empty()) { /* align revRead */
-						//							cerr << "Aligning mate: " << revRead.getId() << endl;
-						BandedHMMP7::HmmAlignment revAln = alignSeq(hmm, csfm, revRead, seedLen, seedRegion, mode);
+					taskStats.add(COUNTER_READ);
+					if(revIn != NULL) { /* align revRead, then check and merge revAln */
+						BandedHMMP7::HmmAlignment revAln = alignSeq(hmm, csfm, revRead, opts.seedLen, opts.seedRegion, mode, rng, NULL, &taskStats);
 						assert(revAln.isValid());
-						//							infoLog << "rev seq aligned: revStart: " << revStart << " revEnd: " << revEnd << " aln: " << revAln << endl;
-						if(!ignoreOrient && !(aln.csStart <= revAln.csStart && aln.csEnd <= revAln.csEnd)) {
+						if(!opts.ignoreOrient && !(aln.csStart <= revAln.csStart && aln.csEnd <= revAln.csEnd)) {
 #pragma omp critical(writeLog)
 						{
 							warningLog << "Bad orientation of forward/reverse read detected, treating as chimera" << endl;
-//							infoLog << "fwd.csStart: " << aln.csStart << " fwd.csEnd: " << aln.csEnd
-//									<< " rev.csStart: " << revAln.csStart << " rev.csEnd: " << revAln.csEnd << endl;
 						}
 							isChimera = true; /* bad orientation indicates a chimera seq */
 						}
 						else
 							aln.merge(revAln); /* merge alignment */
 					}
+					double t = StageStats::now();
 					DigitalSeq seq(abc, id, aln.align);
 					/* common seeds used for both segments and whole seq */
 					vector<PTUnrooted::PTLoc> seeds;
-					if(checkChimera && !isChimera || !alignOnly) {
-						seeds = getSeed(ptu, seq, aln.csStart - 1, aln.csEnd - 1);
-						if(seeds.size() > maxNSeed)
-							seeds.erase(seeds.end() - (seeds.size() - maxNSeed), seeds.end()); /* remove bad seeds */
+					if(opts.checkChimera && !isChimera || !opts.alignOnly) {
+						seeds = opts.seedBeam > 0 ? getSeedTopDown(ptu, seq, aln.csStart - 1, aln.csEnd - 1, opts.seedBeam)
+								: getSeed(ptu, seq, aln.csStart - 1, aln.csEnd - 1);
+						if(seeds.size() > opts.maxNSeed)
+							seeds.erase(seeds.end() - (seeds.size() - opts.maxNSeed), seeds.end()); /* remove bad seeds */
 					}
+					PDistIndex seedDist(seq, aln.csStart - 1, aln.csEnd - 1); /* p-distances to seeds and their parents */
+					indexSeed(ptu, seeds, seedDist);
+					taskStats.add(COUNTER_SEED, seeds.size());
+					t = taskStats.addTime(STAGE_GET_SEED, t);
 					PTUnrooted::PTPlacement bestPlace;
 					double chimeraLod = EGriceLab::HmmUFOtu::nan;
 					PTUnrooted::PTPlacement bestSeg5Place;
 					PTUnrooted::PTPlacement bestSeg3Place;
-					if(checkChimera && !isChimera) { /* need further chimera checking */
-						/* get segment seeds */
+					if(opts.checkChimera && !isChimera) { /* need further chimera checking */
+						/* place each segment in its own task, if no read is waiting for a thread */
+						vector<vector<PTUnrooted::PTPlacement> > segPlaces(opts.numSeg); /* placements of each segment */
+						const int segLen = (aln.csEnd - aln.csStart + 1) / opts.numSeg;
+						const bool splitSeg = splitTasks(opts.numSeg);
+						for(int n = 0; n < opts.numSeg; ++n) {
+#pragma omp task if(splitSeg) shared(ptu, aln, seq, seeds, seedDist, segPlaces)
+							{
+								int segStart = aln.csStart + n * segLen; /* 1-based */
+								int segEnd = segStart + segLen - 1;      /* 1-based */
+								/* get segment seeds using common seeds */
+								vector<PTUnrooted::PTLoc> segSeeds;
+								segSeeds.reserve(seeds.size());
+								for(vector<PTUnrooted::PTLoc>::const_iterator s = seeds.begin(); s != seeds.end(); ++s)
+									segSeeds.push_back(PTUnrooted::PTLoc(segStart - 1, segEnd - 1, s->id, seedDist.pDist(s->id, segStart - 1, segEnd - 1)));
+								/* estimate segment placements */
+								segPlaces[n] = estimateSeq(ptu, seq, segSeeds, seedDist, opts.estMethod);
+								StageStats& segStats = getThreadStats(threadStats);
+								segStats.add(COUNTER_CANDIDATE, segPlaces[n].size());
+								/* filter placesments for this segment */
+								filterPlacements(segPlaces[n], opts.maxChimeraError);
+								segStats.add(COUNTER_FILTERED, segPlaces[n].size());
+								long nSegPruned = 0;
+								placeSeq(ptu, seq, segPlaces[n], PTUnrooted::UNIFORM, 0, &nSegPruned); /* only the best placements are used */
+								segStats.add(COUNTER_PRUNED, nSegPruned);
+								addPlaceStats(segStats, segPlaces[n]);
+							}
+						}
+#pragma omp taskwait
+						/* add placements of each segment to the larget lists in segment order */
 						vector<PTUnrooted::PTPlacement> seg5Places; /* placements of 5' segments */
 						vector<PTUnrooted::PTPlacement> seg3Places; /* placements of 3' segments */
-						const int segLen = (aln.csEnd - aln.csStart + 1) / numSeg;
-						for(int n = 0; n < numSeg; ++n) {
-							int segStart = aln.csStart + n * segLen; /* 1-based */
-							int segEnd = segStart + segLen - 1;      /* 1-based */
-							/* get segment seeds using common seeds */
-							vector<PTUnrooted::PTLoc> segSeeds;
-							segSeeds.reserve(seeds.size());
-							for(vector<PTUnrooted::PTLoc>::const_iterator s = seeds.begin(); s != seeds.end(); ++s)
-								segSeeds.push_back(PTUnrooted::PTLoc(segStart - 1, segEnd - 1, s->id, SeqUtils::pDist(seq, ptu.getNode(s->id)->getSeq(), segStart - 1, segEnd - 1)));
-							/* estimate segment placements */
-							vector<PTUnrooted::PTPlacement> segPlaces = estimateSeq(ptu, seq, segSeeds, estMethod);
-							/* filter placesments for this segment */
-							filterPlacements(segPlaces, maxChimeraError);
-							placeSeq(ptu, seq, segPlaces);
-							/* add placements of this segment to the larget lists */
-							if(n < numSeg / 2)
-								seg5Places.insert(seg5Places.end(), segPlaces.begin(), segPlaces.end());
+						for(int n = 0; n < opts.numSeg; ++n) {
+							if(n < opts.numSeg / 2)
+								seg5Places.insert(seg5Places.end(), segPlaces[n].begin(), segPlaces[n].end());
 							else
-								seg3Places.insert(seg3Places.end(), segPlaces.begin(), segPlaces.end());
+								seg3Places.insert(seg3Places.end(), segPlaces[n].begin(), segPlaces[n].end());
 						}
 						std::sort(seg5Places.rbegin(), seg5Places.rend(), compareByLoglik);
 						std::sort(seg3Places.rbegin(), seg3Places.rend(), compareByLoglik);
 						bestSeg5Place = seg5Places[0];
 						bestSeg3Place = seg3Places[0];
 						/* get alt-seg5-place */
-						PTUnrooted::PTLoc alt5Loc(bestSeg5Place.start, bestSeg5Place.end, bestSeg3Place.cNode->getId() /* seg3 branch */, SeqUtils::pDist(seq, bestSeg5Place.cNode->getSeq(), bestSeg5Place.start, bestSeg5Place.end));
-						PTUnrooted::PTPlacement altSeg5Place = ptu.estimateSeq(seq, alt5Loc);
-						ptu.placeSeq(seq, altSeg5Place);
+						PTUnrooted::PTLoc alt5Loc(bestSeg5Place.start, bestSeg5Place.end, bestSeg3Place.cNode->getId() /* seg3 branch */, seedDist.pDist(bestSeg5Place.cNode->getId(), bestSeg5Place.start, bestSeg5Place.end));
+						PTUnrooted::PTPlacement altSeg5Place;
+#pragma omp task if(splitTasks(2)) shared(ptu, seq, alt5Loc, seedDist, altSeg5Place)
+						{
+							altSeg5Place = estimateSeq(ptu, seq, alt5Loc, seedDist, "weighted");
+							ptu.placeSeq(seq, altSeg5Place);
+						}
 						/* get alt-seg3-place */
-						PTUnrooted::PTLoc alt3Loc(bestSeg3Place.start, bestSeg3Place.end, bestSeg5Place.cNode->getId() /* seg5 branch */, SeqUtils::pDist(seq, bestSeg3Place.cNode->getSeq(), bestSeg3Place.start, bestSeg3Place.end));
-						PTUnrooted::PTPlacement altSeg3Place = ptu.estimateSeq(seq, alt3Loc);
+						PTUnrooted::PTLoc alt3Loc(bestSeg3Place.start, bestSeg3Place.end, bestSeg5Place.cNode->getId() /* seg5 branch */, seedDist.pDist(bestSeg3Place.cNode->getId(), bestSeg3Place.start, bestSeg3Place.end));
+						PTUnrooted::PTPlacement altSeg3Place = estimateSeq(ptu, seq, alt3Loc, seedDist, "weighted");
 						ptu.placeSeq(seq, altSeg3Place);
+#pragma omp taskwait
 						chimeraLod = bestSeg5Place.loglik - altSeg5Place.loglik + bestSeg3Place.loglik - altSeg3Place.loglik;
-						isChimera = bestSeg5Place.getTaxonId() != bestSeg3Place.getTaxonId() && chimeraLod > minChimeraLod;
+						isChimera = bestSeg5Place.getTaxonId() != bestSeg3Place.getTaxonId() && chimeraLod > opts.minChimeraLod;
+						t = taskStats.addTime(STAGE_CHIMERA, t);
 					} /* end check chimera */
 
 					if(isChimera) { /* a potential chimera sequence */
-						if(chiOut.is_complete())
-							if(!chimeraInfo)
-#pragma omp critical(writeChiAssign)
-								chiOut << id << "\t" << desc << "\t" << aln
+						taskStats.add(COUNTER_CHIMERA);
+						if(chiOut != NULL)
+							if(!opts.chimeraInfo)
+								writeAlign(readChiOut << id << "\t" << desc << "\t", aln, opts.compactAlign)
 								<< "\t" << bestPlace << endl;
 							else
-#pragma omp critical(writeChiAssign)
-								chiOut << id << "\t" << desc << "\t" << aln
+								writeAlign(readChiOut << id << "\t" << desc << "\t", aln, opts.compactAlign)
 								<< "\t" << bestSeg5Place.getTaxonId() << "\t" << bestSeg3Place.getTaxonId()
 								<< "\t" << bestSeg5Place.getTaxonName() << "\t" << bestSeg3Place.getTaxonName()
 								<< "\t" << chimeraLod
@@ -686,49 +824,739 @@ int main(int argc, char* argv[]) {
 					}
 					else { /* not a chimera sequence */
 						/* write the alignment seq to output */
-						if(!alnFn.empty()) {
+						if(alnOut != NULL) {
 							string desc = fwdRead.getDesc();
 							desc += ";csStart=" + boost::lexical_cast<string>(aln.csStart) +
 									";csEnd=" + boost::lexical_cast<string>(aln.csEnd) + ";";
-#pragma omp critical(writeAln)
 							alnSeqO.writeSeq(PrimarySeq(abc, id, aln.align, desc));
 						}
 
-						if(!alignOnly) {
+						if(!opts.alignOnly) {
 							/* place seq with seed-estimate-place (SEP) algorithm */
 							/* estimate placements using the common seeds */
-							vector<PTUnrooted::PTPlacement> places = estimateSeq(ptu, seq, seeds, estMethod);
+							vector<PTUnrooted::PTPlacement> places = estimateSeq(ptu, seq, seeds, seedDist, opts.estMethod);
+							taskStats.add(COUNTER_CANDIDATE, places.size());
 							/* filter placements */
-							filterPlacements(places, maxError);
-							/* accurate placements */
-							placeSeq(ptu, seq, places);
-							if(onlyML) { /* don't calculate q-values */
+							filterPlacements(places, opts.maxError);
+							taskStats.add(COUNTER_FILTERED, places.size());
+							t = taskStats.addTime(STAGE_ESTIMATE, t);
+							/* accurate placements, skipping those cannot affect the best placement or its Q-values */
+							long nReadPruned = 0;
+							if(opts.onlyML)
+								placeSeq(ptu, seq, places, PTUnrooted::UNIFORM, 0, &nReadPruned);
+							else
+								placeSeq(ptu, seq, places, opts.myPrior, qValueMargin(places.size()), &nReadPruned);
+							taskStats.add(COUNTER_PRUNED, nReadPruned);
+							addPlaceStats(taskStats, places);
+							if(opts.onlyML) { /* don't calculate q-values */
 								std::sort(places.rbegin(), places.rend(), compareByLoglik); /* sort places decently by real loglik */
 							}
 							else { /* calculate q-values */
-								calcQValues(places, myPrior);
+								calcQValues(places, opts.myPrior);
 								std::sort(places.rbegin(), places.rend(), compareByQPlace); /* sort places decently by posterior placement probability */
 							}
 
 							bestPlace = places[0];
+							t = taskStats.addTime(STAGE_PLACE, t);
 						} /* end if alignOnly */
 						/* write main output */
-						if(!chimeraInfo)
-#pragma omp critical(writeAssign)
-							out << id << "\t" << desc << "\t" << aln
+						if(!opts.chimeraInfo)
+							writeAlign(readOut << id << "\t" << desc << "\t", aln, opts.compactAlign)
 							<< "\t" << bestPlace << endl;
 						else
-#pragma omp critical(writeAssign)
-							out << id << "\t" << desc << "\t" << aln
+							writeAlign(readOut << id << "\t" << desc << "\t", aln, opts.compactAlign)
 							<< "\t" << bestSeg5Place.getTaxonId() << "\t" << bestSeg3Place.getTaxonId()
 							<< "\t" << bestSeg5Place.getTaxonName() << "\t" << bestSeg3Place.getTaxonName()
 							<< "\t" << chimeraLod
 							<< "\t" << bestPlace << endl;
+						if(otuData != NULL)
+#pragma omp critical(countOTU)
+							addOTURead(*otuData, ptu, abc, bestPlace, aln.align, s, S);
 					} /* end not chimera alignment */
+
+#pragma omp critical(writeAssign)
+					{
+						readOuts[outIdx] = ReadOutput(outEndRead, readOut.str(), readAlnOut.str(), readChiOut.str());
+						std::map<long, ReadOutput>::iterator ro;
+						while((ro = readOuts.find(nextOut)) != readOuts.end()) {
+							out << ro->second.assign;
+							if(alnOut != NULL)
+								*alnOut << ro->second.align;
+							if(chiOut != NULL)
+								*chiOut << ro->second.chimera;
+							ckpt.nRead = ro->second.endRead;
+							ckpt.assignSize += ro->second.assign.length();
+							ckpt.alignSize += ro->second.align.length();
+							ckpt.chimeraSize += ro->second.chimera.length();
+							readOuts.erase(ro);
+							nextOut++;
+						}
+						if(ckptInterval > 0 && ckpt.nRead - lastCkptRead >= ckptInterval) {
+							flushCheckpoint(ckptFn, ckpt, out, alnOut, chiOut);
+							debugLog << "Checkpoint saved after " << ckpt.nRead << " reads" << endl;
+							lastCkptRead = ckpt.nRead;
+						}
+						const double now = StageStats::now();
+						if(now - lastProgressTime >= PROGRESS_INTERVAL) {
+							infoLog << "Processed " << ckpt.nRead << " reads, "
+									<< (ckpt.nRead - firstRead) / (now - startTime) << " reads/sec" << endl;
+							lastProgressTime = now;
+						}
+					}
 				} /* end task */
 			} /* end each read/pair */
 		} /* end single */
 #pragma omp taskwait
 	} /* end parallel */
+	if(ckptInterval > 0) /* final checkpoint, resuming from it appends nothing */
+		flushCheckpoint(ckptFn, ckpt, out, alnOut, chiOut);
+	StageStats allStats;
+	for(vector<StageStats>::const_iterator ts = threadStats.begin(); ts != threadStats.end(); ++ts)
+		allStats += *ts;
+	infoLog << "Alignments done by banded DP: " << allStats.count[COUNTER_BANDED_DP] << " widened banded DP: " << allStats.count[COUNTER_WIDENED_DP]
+			<< " full DP: " << allStats.count[COUNTER_FULL_DP] << endl;
+	infoLog << "Placements skipped by loglik bound: " << allStats.count[COUNTER_PRUNED] << " out of " << allStats.count[COUNTER_FILTERED] << endl;
+	if(stats != NULL)
+		*stats += allStats;
+}
+
+/**
+ * Merge outputs of all shards back into the input order of reads, with the header of the first shard
+ * @param seqI  reads of the whole input
+ * @param shardIns  outputs of shard 0 to n-1
+ * @return  number of records merged
+ * @throw std::runtime_error if any shard has records not found in the input order
+ */
+long mergeShards(SeqIO& seqI, const vector<istream*>& shardIns, ostream& out) {
+	const int n = shardIns.size();
+	vector<string> nextLines(n);
+	vector<bool> hasNext(n);
+	for(int k = 0; k < n; ++k) {
+		string line;
+		while(std::getline(*shardIns[k], line)) {
+			if(k == 0)
+				out << line << endl;
+			if(StringUtils::startsWith(line, "id\t")) /* column header is the last header line */
+				break;
+		}
+		hasNext[k] = !std::getline(*shardIns[k], nextLines[k]).fail();
+	}
+
+	/* the j-th read belongs to shard j % n, and is missing if it is filtered as chimera */
+	long nRecord = 0;
+	for(long j = 0; seqI.hasNext(); ++j) {
+		const string id = seqI.nextSeq().getId();
+		const int k = j % n;
+		if(hasNext[k] && nextLines[k].substr(0, nextLines[k].find('\t')) == id) {
+			out << nextLines[k] << endl;
+			nRecord++;
+			hasNext[k] = !std::getline(*shardIns[k], nextLines[k]).fail();
+		}
+	}
+	for(int k = 0; k < n; ++k)
+		if(hasNext[k])
+			throw std::runtime_error("Output of shard " + boost::lexical_cast<string>(k) + " has records not found in the reads,"
+					" check the read file and the order of shard outputs");
+	return nRecord;
+}
+
+/**
+ * Serve assignment requests read from in, and write responses to out, until no more requests
+ * requests are served one at a time, each using all threads
+ * @return  number of requests served
+ */
+long serveRequests(BandedHMMP7& hmm, const CSFMIndex& csfm, const PTUnrooted& ptu, istream& in, ostream& out) {
+	long nRequest = 0;
+	for(;;) {
+		/* read a request */
+		string name, data;
+		string args, fwdData, revData;
+		bool hasRev = false;
+		while(readBlock(in, name, data) && name != END_BLOCK) {
+			if(name == ARGS_BLOCK)
+				args.swap(data);
+			else if(name == FWD_BLOCK)
+				fwdData.swap(data);
+			else if(name == REV_BLOCK) {
+				revData.swap(data);
+				hasRev = true;
+			}
+			else
+				warningLog << "Ignoring unknown request block '" << name << "'" << endl;
+		}
+		if(!in) { /* no more complete requests */
+			if(!args.empty())
+				warningLog << "Ignoring incomplete request" << endl;
+			break;
+		}
+		nRequest++;
+
+		/* re-construct the command line of the client */
+		vector<string> argv = splitArgs(args);
+		vector<char*> argp;
+		for(vector<string>::iterator arg = argv.begin(); arg != argv.end(); ++arg)
+			argp.push_back(&(*arg)[0]);
+
+		std::ostringstream assignOut, alnOut, chiOut;
+		try {
+			if(argp.empty())
+				throw std::invalid_argument("Missing command line in request");
+			CommandOptions reqOpts(argp.size(), &argp[0]);
+			if(!(reqOpts.numMainOpts() == 1 || reqOpts.numMainOpts() == 2))
+				throw std::invalid_argument("One or two read files must be given in request");
+			if(reqOpts.numMainOpts() == 2 && !hasRev)
+				throw std::invalid_argument("Missing reverse reads in request");
+
+			AssignOptions opts;
+			opts.fwdFn = reqOpts.getMainOpt(0);
+			if(reqOpts.numMainOpts() == 2)
+				opts.revFn = reqOpts.getMainOpt(1);
+			parseAssignOptions(reqOpts, opts);
+			infoLog << "Serving request " << nRequest << ": " << reqOpts.getCmdStr() << endl;
+
+			/* read inputs directly from the request */
+			boost::iostreams::stream<boost::iostreams::array_source> fwdIn(fwdData.c_str(), fwdData.length());
+			boost::iostreams::stream<boost::iostreams::array_source> revIn(revData.c_str(), revData.length());
+			boost::iostreams::stream<boost::iostreams::array_source> testIn(fwdData.c_str(), fwdData.length());
+
+			assignReads(hmm, csfm, ptu, opts, reqOpts, &fwdIn, hasRev ? &revIn : NULL, &testIn,
+					assignOut, !opts.alnFn.empty() ? &alnOut : NULL, !opts.chiOutFn.empty() ? &chiOut : NULL);
+
+			writeBlock(out, ASSIGN_BLOCK, assignOut.str());
+			if(!opts.alnFn.empty())
+				writeBlock(out, ALIGN_BLOCK, alnOut.str());
+			if(!opts.chiOutFn.empty())
+				writeBlock(out, CHIMERA_BLOCK, chiOut.str());
+		}
+		catch(const std::exception& e) {
+			warningLog << "Request " << nRequest << " failed: " << e.what() << endl;
+			writeBlock(out, ERROR_BLOCK, e.what());
+		}
+		writeEndBlock(out);
+		if(!out) /* client gone */
+			break;
+	}
+	return nRequest;
+}
+
+/** socket file to be removed on exit */
+static const char* serverSocket = NULL;
+
+/** remove the server socket and exit upon a terminating signal */
+void removeServerSocket(int sig) {
+	if(serverSocket != NULL)
+		::unlink(serverSocket);
+	::_exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char* argv[]) {
+	/* variable declarations */
+	/* filenames */
+	string dbName, msaFn, csfmFn, hmmFn, hmmbFn, ptuFn;
+	string outFn;
+	string sockFn;
+	string manifestFn, otuFn;
+	string ckptFn;
+	string statsFn;
+	/* output */
+	boost::iostreams::filtering_ostream out, alnOut;
+	boost::iostreams::filtering_ostream chiOut;
+	boost::iostreams::filtering_ostream otuOut;
+	ofstream statsOut;
+	/* other */
+	AssignOptions opts;
+	vector<SampleInfo> samples;
+	bool isServer = false;
+	bool isManifest = false;
+	long ckptInterval = DEFAULT_CHECKPOINT_INTERVAL;
+	bool isResume = false;
+	Checkpoint resumeCkpt;
+
+	int nThreads = DEFAULT_NUM_THREADS;
+
+	/* parse options */
+	CommandOptions cmdOpts(argc, argv);
+	if(cmdOpts.empty() || cmdOpts.hasOpt("-h") || cmdOpts.hasOpt("--help")) {
+		printIntro();
+		printUsage(argv[0]);
+		return EXIT_SUCCESS;
+	}
+
+	if(cmdOpts.hasOpt("--version")) {
+		printVersion(argv[0]);
+		return EXIT_SUCCESS;
+	}
+
+	if(cmdOpts.hasOpt("--merge-shards")) { /* merge mode, no database needed */
+		AssignOptions readOpts;
+		readOpts.fwdFn = cmdOpts.getOpt("--merge-shards");
+		if(cmdOpts.hasOpt("--fmt"))
+			readOpts.seqFmt = cmdOpts.getOpt("--fmt");
+		if(cmdOpts.hasOpt("-o"))
+			outFn = cmdOpts.getOpt("-o");
+		if(cmdOpts.hasOpt("-v"))
+			INCREASE_LEVEL(cmdOpts.getOpt("-v").length());
+		if(readOpts.fwdFn.empty() || cmdOpts.numMainOpts() < 1) {
+			cerr << "Error:" << endl;
+			printUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+		try {
+			setReadFormat(readOpts);
+		}
+		catch(const std::invalid_argument& e) {
+			cerr << e.what() << endl;
+			return EXIT_FAILURE;
+		}
+
+		boost::iostreams::filtering_istream readIn;
+		if(!openInput(readIn, readOpts.fwdFn)) {
+			cerr << "Unable to open seq file '" << readOpts.fwdFn << "' " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+		vector<istream*> shardIns;
+		int status = EXIT_SUCCESS;
+		for(int k = 0; k < cmdOpts.numMainOpts() && status == EXIT_SUCCESS; ++k) {
+			boost::iostreams::filtering_istream* shardIn = new boost::iostreams::filtering_istream;
+			shardIns.push_back(shardIn);
+			if(AssignBinIO::isBinFile(cmdOpts.getMainOpt(k))) {
+				cerr << "Shard output '" << cmdOpts.getMainOpt(k) << "' must be in TSV format, convert it by hmmufotu-convert first" << endl;
+				status = EXIT_FAILURE;
+			}
+			else if(!openInput(*shardIn, cmdOpts.getMainOpt(k))) {
+				cerr << "Unable to open shard output '" << cmdOpts.getMainOpt(k) << "' " << ::strerror(errno) << endl;
+				status = EXIT_FAILURE;
+			}
+		}
+		if(status == EXIT_SUCCESS && !openAssignOutput(out, outFn)) {
+			cerr << "Unable to write to "
+					<< (!outFn.empty() ? " out file '" + outFn + "' " : "stdout ")
+					<< ::strerror(errno) << endl;
+			status = EXIT_FAILURE;
+		}
+		if(status == EXIT_SUCCESS) {
+			try {
+				SeqIO seqI(&readIn, AlphabetFactory::nuclAbc, readOpts.seqFmt);
+				long nRecord = mergeShards(seqI, shardIns, out);
+				infoLog << nRecord << " records merged from " << shardIns.size() << " shards" << endl;
+			}
+			catch(const std::runtime_error& e) {
+				cerr << e.what() << endl;
+				status = EXIT_FAILURE;
+			}
+		}
+		for(vector<istream*>::iterator shardIn = shardIns.begin(); shardIn != shardIns.end(); ++shardIn)
+			delete *shardIn;
+		return status;
+	}
+
+	if(cmdOpts.hasOpt("--server"))
+		isServer = true;
+
+	if(cmdOpts.hasOpt("--manifest")) {
+		manifestFn = cmdOpts.getOpt("--manifest");
+		isManifest = true;
+	}
+
+	if(!(isServer || isManifest ? cmdOpts.numMainOpts() == 1 : cmdOpts.numMainOpts() == 2 || cmdOpts.numMainOpts() == 3)) {
+		cerr << "Error:" << endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	dbName = cmdOpts.getMainOpt(0);
+	if(!isServer && !isManifest) {
+		opts.fwdFn = cmdOpts.getMainOpt(1);
+		if(cmdOpts.numMainOpts() == 3)
+			opts.revFn = cmdOpts.getMainOpt(2);
+	}
+
+	if(cmdOpts.hasOpt("-o"))
+		outFn = cmdOpts.getOpt("-o");
+
+	if(cmdOpts.hasOpt("--listen"))
+		sockFn = cmdOpts.getOpt("--listen");
+
+	if(cmdOpts.hasOpt("--otu-table"))
+		otuFn = cmdOpts.getOpt("--otu-table");
+
+	if(cmdOpts.hasOpt("--stats"))
+		statsFn = cmdOpts.getOpt("--stats");
+
+	if(cmdOpts.hasOpt("--checkpoint"))
+		ckptInterval = ::atol(cmdOpts.getOptStr("--checkpoint"));
+
+	if(cmdOpts.hasOpt("--resume"))
+		isResume = true;
+
+	if(!isServer) {
+		try {
+			parseAssignOptions(cmdOpts, opts);
+		}
+		catch(const std::invalid_argument& e) {
+			cerr << e.what() << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+#ifdef _OPENMP
+	if(cmdOpts.hasOpt("-p"))
+		nThreads = ::atoi(cmdOpts.getOptStr("-p"));
+	if(cmdOpts.hasOpt("--process"))
+		nThreads = ::atoi(cmdOpts.getOptStr("--process"));
+#endif
+
+	if(cmdOpts.hasOpt("-v"))
+		INCREASE_LEVEL(cmdOpts.getOpt("-v").length());
+
+	/* validate options */
+#ifdef _OPENMP
+	if(!(nThreads > 0)) {
+		cerr << "-p|--process must be positive" << endl;
+		return EXIT_FAILURE;
+	}
+	omp_set_num_threads(nThreads);
+#endif
+
+	if(isServer && (isManifest || !otuFn.empty() || !statsFn.empty())) {
+		cerr << "--manifest, --otu-table and --stats cannot be used in server mode" << endl;
+		return EXIT_FAILURE;
+	}
+	if(isManifest && (!outFn.empty() || !opts.alnFn.empty() || !opts.chiOutFn.empty())) {
+		cerr << "-o, -a and --chimera-out cannot be used with --manifest, outputs are given per sample in the manifest" << endl;
+		return EXIT_FAILURE;
+	}
+	if(!otuFn.empty() && opts.alignOnly) {
+		cerr << "--otu-table cannot be used with --align-only" << endl;
+		return EXIT_FAILURE;
+	}
+	if(!(ckptInterval >= 0)) {
+		cerr << "--checkpoint must be non-negative" << endl;
+		return EXIT_FAILURE;
+	}
+	if(ckptInterval > 0 || isResume) {
+		if(isServer || isManifest || !otuFn.empty()) {
+			cerr << "--checkpoint and --resume cannot be used with --server, --manifest or --otu-table" << endl;
+			return EXIT_FAILURE;
+		}
+		if(outFn.empty()) {
+			cerr << "--checkpoint and --resume require an output file given by -o" << endl;
+			return EXIT_FAILURE;
+		}
+		const string outFns[] = { outFn, opts.alnFn, opts.chiOutFn };
+		for(int i = 0; i < 3; ++i) {
+			if(StringUtils::endsWith(outFns[i], GZIP_FILE_SUFFIX) || StringUtils::endsWith(outFns[i], BZIP2_FILE_SUFFIX)
+					|| AssignBinIO::isBinFile(outFns[i])) {
+				cerr << "--checkpoint and --resume require uncompressed TSV output files" << endl;
+				return EXIT_FAILURE;
+			}
+		}
+		ckptFn = outFn + CHECKPOINT_FILE_SUFFIX;
+	}
+	if(isResume) {
+		if(!loadCheckpoint(ckptFn, resumeCkpt)) {
+			cerr << "Unable to load checkpoint file '" << ckptFn << "'" << endl;
+			return EXIT_FAILURE;
+		}
+		if(!truncateOutput(outFn, resumeCkpt.assignSize)
+				|| !opts.alnFn.empty() && !truncateOutput(opts.alnFn, resumeCkpt.alignSize)
+				|| !opts.chiOutFn.empty() && !truncateOutput(opts.chiOutFn, resumeCkpt.chimeraSize)) {
+			cerr << "Unable to restore outputs to checkpoint '" << ckptFn << "': " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+		infoLog << "Outputs restored to checkpoint '" << ckptFn << "'" << endl;
+	}
+
+	/* get samples */
+	if(isManifest) {
+		ifstream manifestIn(manifestFn.c_str());
+		if(!manifestIn.is_open()) {
+			cerr << "Unable to open manifest file '" << manifestFn << "': " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+		try {
+			samples = readManifest(manifestIn);
+		}
+		catch(const std::invalid_argument& e) {
+			cerr << "Error in manifest file '" << manifestFn << "': " << e.what() << endl;
+			return EXIT_FAILURE;
+		}
+		if(samples.empty()) {
+			cerr << "No sample found in manifest file '" << manifestFn << "'" << endl;
+			return EXIT_FAILURE;
+		}
+		infoLog << samples.size() << " samples found in manifest file '" << manifestFn << "'" << endl;
+	}
+	else if(!isServer)
+		samples.push_back(SampleInfo(opts.fwdFn, opts.fwdFn, opts.revFn, outFn));
+
+	/* open database */
+	HmmUFOtuDB db;
+	if(!db.open(dbName)) {
+		cerr << "Unable to open HmmUFOtu database '" << dbName << "'" << endl;
+		return EXIT_FAILURE;
+	}
+	msaFn = db.sectionFn(MSA_FILE_SUFFIX);
+	csfmFn = db.sectionFn(CSFM_FILE_SUFFIX);
+	hmmFn = db.sectionFn(HMM_FILE_SUFFIX);
+	hmmbFn = db.sectionFn(HMM_BIN_FILE_SUFFIX);
+	ptuFn = db.sectionFn(PHYLOTREE_FILE_SUFFIX);
+
+	istream& msaIn = db.openSection(MSA_FILE_SUFFIX);
+	if(!msaIn) {
+		cerr << "Unable to open MSA data '" << msaFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+
+	istream& csfmIn = db.openSection(CSFM_FILE_SUFFIX);
+	if(!csfmIn) {
+		cerr << "Unable to open CSFM-index '" << csfmFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+
+	istream& ptuIn = db.openSection(PHYLOTREE_FILE_SUFFIX);
+	if(!ptuIn) {
+		cerr << "Unable to open PTU data '" << ptuFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+
+	/* open outputs */
+	if(!isServer && !isManifest) {
+		if(!openAssignOutput(out, outFn, isResume)) {
+			cerr << "Unable to write to "
+					<< (!outFn.empty() ? " out file '" + outFn + "' " : "stdout ")
+					<< ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+
+		if(!opts.alnFn.empty() && !openOutput(alnOut, opts.alnFn, isResume)) {
+			cerr << "Unable to write to align file '" << opts.alnFn << "' " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+
+		if(!opts.chiOutFn.empty() && !openAssignOutput(chiOut, opts.chiOutFn, isResume)) {
+			cerr << "Unable to write to '" + opts.chiOutFn + "' " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if(!otuFn.empty() && !openOutput(otuOut, otuFn)) {
+		cerr << "Unable to write to OTU table file '" << otuFn << "' " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(!statsFn.empty()) {
+		statsOut.open(statsFn.c_str());
+		if(!statsOut.is_open()) {
+			cerr << "Unable to write to stats file '" << statsFn << "' " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* loading database files */
+	if(loadProgInfo(msaIn).bad())
+		return EXIT_FAILURE;
+	MSA msa;
+	msa.load(msaIn);
+	if(msaIn.bad()) {
+		cerr << "Failed to load MSA data '" << msaFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	int csLen = msa.getCSLen();
+	infoLog << "MSA loaded" << endl;
+
+	/* use the compiled HMM profile if available and compiled from the current hmm file, or the hmm file otherwise */
+	BandedHMMP7 hmm;
+	bool isCompiled = false;
+	if(db.hasSection(HMM_BIN_FILE_SUFFIX)) {
+		istream& hmmbIn = db.openSection(HMM_BIN_FILE_SUFFIX);
+		if(!hmmbIn) {
+			cerr << "Unable to open compiled HMM profile '" << hmmbFn << "': " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+		if(loadProgInfo(hmmbIn).bad())
+			return EXIT_FAILURE;
+		HmmUFOtuDB::Checksum srcSum, hmmSum;
+		srcSum.load(hmmbIn);
+		if(db.getChecksum(HMM_FILE_SUFFIX, hmmSum) && srcSum != hmmSum)
+			warningLog << "Compiled HMM profile '" << hmmbFn << "' is not compiled from the current '" << hmmFn
+			<< "', reading '" << hmmFn << "' instead" << endl;
+		else {
+			hmm.load(hmmbIn);
+			if(hmmbIn.bad()) {
+				cerr << "Unable to load compiled HMM profile '" << hmmbFn << "'" << endl;
+				return EXIT_FAILURE;
+			}
+			isCompiled = true;
+			infoLog << "Compiled HMM profile loaded" << endl;
+		}
+	}
+	if(!isCompiled) {
+		istream& hmmIn = db.openSection(HMM_FILE_SUFFIX);
+		if(!hmmIn) {
+			cerr << "Unable to open HMM profile '" << hmmFn << "': " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+		hmmIn >> hmm;
+		if(hmmIn.bad()) {
+			cerr << "Unable to read HMM profile '" << hmmFn << "': " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+		infoLog << "HMM profile read" << endl;
+	}
+	if(hmm.getProfileSize() > csLen) {
+		cerr << "Error: HMM profile size is found greater than the MSA CS length" << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(loadProgInfo(csfmIn).bad())
+		return EXIT_FAILURE;
+	CSFMIndex csfm;
+	csfm.load(csfmIn);
+	if(csfmIn.bad()) {
+		cerr << "Failed to load CSFM-index '" << csfmFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	infoLog << "CSFM-index loaded" << endl;
+	if(csfm.getCSLen() != csLen) {
+		cerr << "Error: Unmatched CS length between CSFM-index and MSA data" << endl;
+		return EXIT_FAILURE;
+	}
+
+	if(loadProgInfo(ptuIn).bad())
+		return EXIT_FAILURE;
+	PTUnrooted ptu;
+	if(isServer || !opts.alignOnly) { /* a server may get requests of either kind */
+		ptu.load(ptuIn);
+		if(ptuIn.bad()) {
+			cerr << "Unable to load Phylogenetic tree data '" << ptuFn << "': " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+		infoLog << "Phylogenetic tree loaded" << endl;
+	}
+	db.close(); /* all sections loaded */
+
+	/* configure HMM mode */
+	hmm.wingRetract();
+
+	if(isServer) {
+		::signal(SIGPIPE, SIG_IGN); /* a disconnected client only fails its own request */
+		if(sockFn.empty()) { /* serve requests from stdin */
+			infoLog << "Serving requests from stdin" << endl;
+			long nRequest = serveRequests(hmm, csfm, ptu, std::cin, std::cout);
+			infoLog << nRequest << " requests served" << endl;
+			return EXIT_SUCCESS;
+		}
+
+		int listenFd = listenSocket(sockFn);
+		if(listenFd < 0) {
+			cerr << "Unable to listen on socket '" << sockFn << "': " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+		serverSocket = sockFn.c_str();
+		::signal(SIGINT, removeServerSocket);
+		::signal(SIGTERM, removeServerSocket);
+		infoLog << "Listening on socket '" << sockFn << "'" << endl;
+		for(;;) {
+			int connFd = acceptSocket(listenFd);
+			if(connFd < 0) {
+				cerr << "Unable to accept connections on socket '" << sockFn << "': " << ::strerror(errno) << endl;
+				break;
+			}
+			debugLog << "Client connected" << endl;
+			{
+				boost::iostreams::stream<boost::iostreams::file_descriptor_source> connIn(connFd, boost::iostreams::never_close_handle);
+				boost::iostreams::stream<boost::iostreams::file_descriptor_sink> connOut(connFd, boost::iostreams::never_close_handle);
+				serveRequests(hmm, csfm, ptu, connIn, connOut);
+			}
+			::close(connFd);
+			debugLog << "Client disconnected" << endl;
+		}
+		::close(listenFd);
+		::unlink(sockFn.c_str());
+		return EXIT_FAILURE;
+	}
+
+	/* assign samples */
+	OTUMap otuData;
+	StageStats stats;
+	const double startTime = StageStats::now();
+	const int S = samples.size();
+	for(int k = 0; k < S; ++k) {
+		const SampleInfo& sample = samples[k];
+		AssignOptions sampleOpts(opts);
+		sampleOpts.fwdFn = sample.fwdFn;
+		sampleOpts.revFn = sample.revFn;
+		if(isManifest) {
+			infoLog << "Processing sample '" << sample.name << "' (" << (k + 1) << "/" << S << ")" << endl;
+			try {
+				setReadFormat(sampleOpts);
+			}
+			catch(const std::invalid_argument& e) {
+				cerr << "Sample '" << sample.name << "': " << e.what() << endl;
+				return EXIT_FAILURE;
+			}
+			out.reset();
+			if(!openAssignOutput(out, sample.outFn)) {
+				cerr << "Unable to write to out file '" << sample.outFn << "' " << ::strerror(errno) << endl;
+				return EXIT_FAILURE;
+			}
+		}
+
+		/* open seq inputs */
+		boost::iostreams::filtering_istream fwdIn, revIn, testIn;
+		if(sampleOpts.rStrand == 0 && !openInput(testIn, sampleOpts.fwdFn)) {
+			cerr << "Unable to test forward seq file '" << sampleOpts.fwdFn << "' " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+
+		if(!openInput(fwdIn, sampleOpts.fwdFn)) {
+			cerr << "Unable to open forward seq file '" << sampleOpts.fwdFn << "' " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+
+		if(!sampleOpts.revFn.empty() && !openInput(revIn, sampleOpts.revFn)) {
+			cerr << "Unable to open reverse seq file '" << sampleOpts.revFn << "' " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+
+		try {
+			assignReads(hmm, csfm, ptu, sampleOpts, cmdOpts,
+					&fwdIn, !sampleOpts.revFn.empty() ? &revIn : NULL, &testIn,
+					out, !opts.alnFn.empty() ? &alnOut : NULL, !opts.chiOutFn.empty() ? &chiOut : NULL,
+					!otuFn.empty() ? &otuData : NULL, k, S,
+					ckptFn, ckptInterval, isResume ? &resumeCkpt : NULL, &stats);
+		}
+		catch(const std::runtime_error& e) {
+			cerr << (isManifest ? "Sample '" + sample.name + "': " : "") << e.what() << endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	/* write stats */
+	if(!statsFn.empty()) {
+#ifdef _OPENMP
+		stats.writeJSON(statsOut, StageStats::now() - startTime, nThreads);
+#else
+		stats.writeJSON(statsOut, StageStats::now() - startTime, 1);
+#endif
+		infoLog << "Stats written to '" << statsFn << "'" << endl;
+	}
+
+	/* write OTU table */
+	if(!otuFn.empty()) {
+		vector<string> sampleNames;
+		for(vector<SampleInfo>::const_iterator sample = samples.begin(); sample != samples.end(); ++sample)
+			sampleNames.push_back(sample->name);
+		OTUTable otuTable(sampleNames);
+		for(size_t i = 0; i < ptu.numNodes(); ++i) { /* add OTUs in node order as hmmufotu-sum does */
+			OTUMap::const_iterator otu = otuData.find(ptu.getNode(i));
+			if(otu != otuData.end())
+				otuTable.addOTU(otu->second);
+		}
+		infoLog << "Writing OTU table with " << otuTable.numOTUs() << " OTUs" << endl;
+		writeProgInfo(otuOut, string(" OTU table generated by ") + argv[0]);
+		otuTable.save(otuOut, OTU_TABLE_FORMAT);
+	}
+
 	/* release resources */
 }
@@ -0,0 +1,193 @@
+/*
+ * HypergeometricDistribution.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: zhengqi
+ */
+
+#ifndef HYPERGEOMETRICDISTRIBUTION_H_
+#define HYPERGEOMETRICDISTRIBUTION_H_
+
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <boost/random/uniform_01.hpp>
+
+namespace EGriceLab {
+namespace Math {
+
+template <typename IntType = long> class HypergeometricDistribution;
+typedef HypergeometricDistribution<> hypergeometric;
+
+/**
+ * C++ Boost Random Distribution like class of Hypergeometric distribution,
+ * the number of successes in n draws without replacement from a population of N with K successes
+ * values are generated by inversion searching outward from the mode if the standard deviation is small,
+ * or by the ratio-of-uniforms rejection method (HRUA, Stadlober 1989) otherwise,
+ * so the expected cost is bounded regardless of N or n
+ */
+template <typename IntType>
+class HypergeometricDistribution {
+public:
+	typedef IntType result_type;
+
+	/* constructors */
+	HypergeometricDistribution(IntType N, IntType K, IntType n) : N(N), K(K), n(n)
+	{
+		assert(N >= 0 && K >= 0 && K <= N && n >= 0 && n <= N);
+	}
+
+	/* member methods */
+	IntType min() const {
+		return std::max<IntType>(0, n - (N - K));
+	}
+
+	IntType max() const {
+		return std::min(n, K);
+	}
+
+	/** log-probability mass of k successes */
+	double lpmf(IntType k) const {
+		return lchoose(K, k) + lchoose(N - K, n - k) - lchoose(N, n);
+	}
+
+	/** get the variance */
+	double variance() const {
+		if(N <= 1)
+			return 0;
+		const double p = static_cast<double> (K) / N;
+		return n * p * (1 - p) * (N - n) / (N - 1.0);
+	}
+
+	/** generate a random value with given uniform random number generator */
+	template<typename Engine>
+	IntType operator()(Engine& eng) const {
+		if(min() == max())
+			return min();
+		return variance() < MAX_INVERSION_VAR ? inversion(eng) : ratioOfUniforms(eng);
+	}
+
+	static const double MAX_INVERSION_VAR; /* max variance using the inversion method */
+
+private:
+	/** generate a value by inversion from the mode, searching alternately above and below the mode */
+	template<typename Engine>
+	IntType inversion(Engine& eng) const {
+		const IntType lo = min();
+		const IntType hi = max();
+		const IntType mode = std::max(lo, std::min(hi,
+				static_cast<IntType> ((static_cast<double> (n) + 1) * (static_cast<double> (K) + 1) / (static_cast<double> (N) + 2))));
+		double u = boost::random::uniform_01<double>()(eng);
+		double pUp = std::exp(lpmf(mode));
+		double pDown = pUp;
+		u -= pUp;
+		if(u <= 0)
+			return mode;
+		/* use the ratio of neighboring masses */
+		for(IntType kUp = mode, kDown = mode; kUp < hi || kDown > lo; ) {
+			if(kUp < hi) {
+				pUp *= static_cast<double> (K - kUp) * (n - kUp) / ((kUp + 1.0) * (N - K - n + kUp + 1.0));
+				kUp++;
+				u -= pUp;
+				if(u <= 0)
+					return kUp;
+			}
+			if(kDown > lo) {
+				pDown *= static_cast<double> (kDown) * (N - K - n + kDown) / ((K - kDown + 1.0) * (n - kDown + 1.0));
+				kDown--;
+				u -= pDown;
+				if(u <= 0)
+					return kDown;
+			}
+		}
+		return mode; /* only by rounding errors */
+	}
+
+	/** generate a value by the ratio-of-uniforms rejection method */
+	template<typename Engine>
+	IntType ratioOfUniforms(Engine& eng) const {
+		const double D1 = 1.7155277699214135; /* 2 * sqrt(2 / e) */
+		const double D2 = 0.8989161620588988; /* 3 - 2 * sqrt(3 / e) */
+		/* sample from the symmetric case of m <= N / 2 draws of the smaller of successes and failures */
+		const IntType minKF = std::min(K, N - K);
+		const IntType maxKF = std::max(K, N - K);
+		const IntType m = std::min(n, N - n);
+		const double p = static_cast<double> (minKF) / N;
+		const double mu = m * p + 0.5;
+		const double sd = std::sqrt((N - m) * static_cast<double> (n) * p * (1 - p) / (N - 1.0) + 0.5);
+		const double width = D1 * sd + D2;
+		const IntType mode = static_cast<IntType> (std::floor((m + 1.0) * (minKF + 1.0) / (N + 2.0)));
+		const double lpMode = lfactors(mode, minKF, m, maxKF);
+		const double upper = std::min(std::min(m, minKF) + 1.0, std::floor(mu + 16 * sd));
+		boost::random::uniform_01<double> unif;
+
+		IntType k;
+		while(true) {
+			const double x = unif(eng);
+			const double y = unif(eng);
+			const double w = mu + width * (y - 0.5) / x;
+			if(!(w >= 0 && w < upper)) /* fast rejection */
+				continue;
+			k = static_cast<IntType> (std::floor(w));
+			const double t = lpMode - lfactors(k, minKF, m, maxKF);
+			if(x * (4 - x) - 3 <= t) /* fast acceptance */
+				break;
+			if(x * (x - t) >= 1) /* fast rejection */
+				continue;
+			if(2 * std::log(x) <= t)
+				break;
+		}
+		if(K > N - K) /* drawn successes from drawn failures */
+			k = m - k;
+		if(m < n) /* drawn from the undrawn */
+			k = K - k;
+		return k;
+	}
+
+	/** negative log-mass of k in the symmetric case up to a constant */
+	static double lfactors(IntType k, IntType minKF, IntType m, IntType maxKF) {
+		return lfactorial(k) + lfactorial(minKF - k) + lfactorial(m - k) + lfactorial(maxKF - m + k);
+	}
+
+	/** log of the binomial coefficient */
+	static double lchoose(IntType a, IntType b) {
+		return lfactorial(a) - lfactorial(b) - lfactorial(a - b);
+	}
+
+	/**
+	 * log factorial of k by the Stirling series, much faster than boost::math::lgamma
+	 * with the same double precision for non-negative integers
+	 */
+	static double lfactorial(IntType k) {
+		static const double A[] = { 8.333333333333333e-02, -2.777777777777778e-03, 7.936507936507937e-04,
+				-5.952380952380952e-04, 8.417508417508418e-04, -1.917526917526918e-03, 6.410256410256410e-03,
+				-2.955065359477124e-02, 1.796443723688307e-01, -1.39243221690590e+00 };
+		static const double LOG_2PI = 1.8378770664093453;
+		if(k <= 1)
+			return 0;
+		/* shift small k up for the asymptotic series */
+		const IntType shift = k < 6 ? 6 - k : 0;
+		const double x = k + shift + 1.0;
+		const double x2 = 1 / (x * x);
+		double series = A[9];
+		for(int i = 8; i >= 0; --i)
+			series = series * x2 + A[i];
+		double lf = series / x + 0.5 * LOG_2PI + (x - 0.5) * std::log(x) - x;
+		for(IntType i = 0; i < shift; ++i)
+			lf -= std::log(x - 1.0 - i);
+		return lf;
+	}
+
+	/* member fields */
+	IntType N; /* population size */
+	IntType K; /* success states in the population */
+	IntType n; /* number of draws */
+};
+
+template <typename IntType>
+const double HypergeometricDistribution<IntType>::MAX_INVERSION_VAR = 256;
+
+} /* namespace Math */
+} /* namespace EGriceLab */
+
+#endif /* HYPERGEOMETRICDISTRIBUTION_H_ */
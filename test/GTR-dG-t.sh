@@ -53,6 +53,17 @@ if [ $? == 0 ]
 		exit 1
 fi
 
+echo "Testing bHMM binary IO ..."
+./bHmmBin_IO_test ${DB}.hmm ${DB}.2.hmmb
+if [ $? == 0 ]
+	then
+		echo "bHMM binary IO passed"
+	else
+		echo "bHMM binary IO failed"
+		rm -f ${DB}.*
+		exit 1
+fi
+
 echo "Testing PTU IO ..."
 ./PTU_IO_test ${DB}.ptu ${DB}.2.ptu
 if [ $? == 0 ]
@@ -53,6 +53,17 @@ if [ $? == 0 ]
 		exit 1
 fi
 
+echo "Testing bHMM binary IO ..."
+./bHmmBin_IO_test ${DB}.hmm ${DB}.2.hmmb
+if [ $? == 0 ]
+	then
+		echo "bHMM binary IO passed"
+	else
+		echo "bHMM binary IO failed"
+		rm -f ${DB}.*
+		exit 1
+fi
+
 echo "Testing PTU IO ..."
 ./PTU_IO_test ${DB}.ptu ${DB}.2.ptu
 if [ $? == 0 ]
@@ -64,4 +75,16 @@ if [ $? == 0 ]
 		exit 1
 fi
 
+echo "Testing packed database IO ..."
+./HmmUFOtuDB_IO_test ${DB} ${DB}.2
+if [ $? == 0 ]
+	then
+		echo "Packed database IO passed"
+		rm -f ${DB}.2.hudb
+	else
+		echo "Packed database IO failed"
+		rm -f ${DB}.*
+		exit 1
+fi
+
 #rm -f ${DB}.2* # leave GTR db for further tests
@@ -0,0 +1,106 @@
+/*
+ * HmmUFOtuDB_IO_test.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: zhengqi
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include "HmmUFOtu_common.h"
+
+using namespace std;
+using namespace EGriceLab;
+using namespace EGriceLab::HmmUFOtu;
+
+/** read the whole content of an input */
+static string readAll(istream& in) {
+	ostringstream buf;
+	buf << in.rdbuf();
+	return buf.str();
+}
+
+int main(int argc, char *argv[]) {
+	if(argc != 3) {
+		cerr << "Usage:  " << argv[0] << " DBNAME PACKED-DBNAME" << endl;
+		return EXIT_FAILURE;
+	}
+	const string dbName(argv[1]);
+	const string packedName(argv[2]);
+	const string packedFn = packedName + DB_FILE_SUFFIX;
+	const string badName = packedName + "_bad";
+	const string badFn = badName + DB_FILE_SUFFIX;
+
+	ofstream out(packedFn.c_str(), ios_base::out | ios_base::binary);
+	if(!out.is_open()) {
+		cerr << "Unable to write to " << packedFn << endl;
+		return EXIT_FAILURE;
+	}
+	HmmUFOtuDB::pack(dbName, out);
+	out.close();
+	if(!out.good()) {
+		cerr << "Unable to pack database " << dbName << endl;
+		return EXIT_FAILURE;
+	}
+	cerr << "Database packed" << endl;
+
+	HmmUFOtuDB db, packed;
+	if(!db.open(dbName) || db.isPacked()) {
+		cerr << "Unable to open legacy database " << dbName << endl;
+		return EXIT_FAILURE;
+	}
+	if(!packed.open(packedName, true) || !packed.isPacked()) {
+		cerr << "Unable to open packed database " << packedFn << endl;
+		return EXIT_FAILURE;
+	}
+	cerr << "Packed database opened" << endl;
+
+	/* every section must be read back identically */
+	for(size_t i = 0; i < HmmUFOtuDB::NUM_DB_SECTIONS; ++i) {
+		const string& suffix = HmmUFOtuDB::DB_SECTIONS[i];
+		if(db.hasSection(suffix) != packed.hasSection(suffix)) {
+			cerr << "Section " << suffix << " is not packed" << endl;
+			return EXIT_FAILURE;
+		}
+		if(!db.hasSection(suffix))
+			continue;
+		istream& in = db.openSection(suffix);
+		istream& pin = packed.openSection(suffix);
+		if(!in || !pin) {
+			cerr << "Unable to open section " << suffix << endl;
+			return EXIT_FAILURE;
+		}
+		HmmUFOtuDB::Checksum sum, psum;
+		if(readAll(in) != readAll(pin) || !db.getChecksum(suffix, sum) || !packed.getChecksum(suffix, psum) || sum != psum) {
+			cerr << "Packed section " << suffix << " differs from the original file" << endl;
+			return EXIT_FAILURE;
+		}
+	}
+	cerr << "Packed sections read" << endl;
+
+	/* a corrupted section must be detected only with verify */
+	ifstream pIn(packedFn.c_str(), ios_base::in | ios_base::binary);
+	string data = readAll(pIn);
+	const HmmUFOtuDB::Section& sec = packed.getSections().front();
+	data[sec.offset + sec.size / 2] ^= 0xFF;
+	ofstream badOut(badFn.c_str(), ios_base::out | ios_base::binary);
+	badOut.write(data.data(), data.length());
+	badOut.close();
+
+	HmmUFOtuDB bad;
+	if(!bad.open(badName, true) || bad.openSection(sec.name)) {
+		cerr << "Corrupted section " << sec.name << " not detected" << endl;
+		return EXIT_FAILURE;
+	}
+	if(!bad.open(badName) || !bad.openSection(sec.name)) {
+		cerr << "Unverified section " << sec.name << " not opened" << endl;
+		return EXIT_FAILURE;
+	}
+	bad.close();
+	std::remove(badFn.c_str());
+	cerr << "Packed database round-trip passed" << endl;
+
+	return 0;
+}
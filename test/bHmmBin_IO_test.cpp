@@ -0,0 +1,82 @@
+/*
+ * bHmmBin_IO_test.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: zhengqi
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include "HmmUFOtu_common.h"
+#include "HmmUFOtu_hmm.h"
+
+using namespace std;
+using namespace EGriceLab;
+using namespace EGriceLab::HmmUFOtu;
+
+int main(int argc, char *argv[]) {
+	if(argc != 3) {
+		cerr << "Usage:  " << argv[0] << " HMM-INFILE HMMB-OUTFILE" << endl;
+		return EXIT_FAILURE;
+	}
+
+	ifstream in(argv[1]);
+	if(!in.is_open()) {
+		cerr << "Unable to open " << argv[1] << endl;
+		return EXIT_FAILURE;
+	}
+
+	BandedHMMP7 hmm;
+	in >> hmm;
+	if(in.bad()) {
+		cerr << "Unable to read Hmm file: " << argv[1] << endl;
+		return EXIT_FAILURE;
+	}
+	cerr << "Hmm read" << endl;
+
+	ofstream out(argv[2], ios_base::out | ios_base::binary);
+	if(!out.is_open()) {
+		cerr << "Unable to write to " << argv[2] << endl;
+		return EXIT_FAILURE;
+	}
+	hmm.save(out);
+	out.close();
+	if(!out.good()) {
+		cerr << "Unable to save compiled Hmm file: " << argv[2] << endl;
+		return EXIT_FAILURE;
+	}
+	cerr << "Compiled Hmm saved" << endl;
+
+	ifstream bin(argv[2], ios_base::in | ios_base::binary);
+	BandedHMMP7 hmmc;
+	hmmc.load(bin);
+	if(bin.bad()) {
+		cerr << "Unable to load compiled Hmm file: " << argv[2] << endl;
+		return EXIT_FAILURE;
+	}
+	cerr << "Compiled Hmm loaded" << endl;
+
+	/* the loaded profile must be saved and printed identically */
+	ostringstream bin1, bin2, txt1, txt2;
+	hmm.save(bin1);
+	hmmc.save(bin2);
+	txt1 << hmm;
+	txt2 << hmmc;
+	if(bin1.str() != bin2.str() || txt1.str() != txt2.str()) {
+		cerr << "Compiled Hmm differs from the original Hmm" << endl;
+		return EXIT_FAILURE;
+	}
+
+	/* a truncated input must be rejected */
+	istringstream trunc(bin1.str().substr(0, bin1.str().length() / 2));
+	BandedHMMP7 hmmt;
+	hmmt.load(trunc);
+	if(!trunc.bad()) {
+		cerr << "Truncated compiled Hmm not detected" << endl;
+		return EXIT_FAILURE;
+	}
+	cerr << "Compiled Hmm round-trip passed" << endl;
+
+	return 0;
+}
@@ -0,0 +1,50 @@
+#!/bin/bash
+
+# basic info
+INPUT="70_otus"
+DBNAME="gg_70_otus_bench"
+SMTYPE="GTR"
+DB="${DBNAME}_${SMTYPE}"
+SRCPATH="../src"
+
+# simulating info
+SIMFILE="${DB}_sim.fasta"
+SIMNUM=200
+SIMSEED=0
+
+# benchmark info
+BENCHFILE="kernel_bench.json"
+MINTIME=${BENCH_MIN_TIME:-0.5}
+export OMP_NUM_THREADS=1
+
+echo "Constructing a benchmark database ..."
+$SRCPATH/hmmufotu-build ${INPUT}.fasta ${INPUT}.tree -a ${INPUT}_taxonomy.txt -n $DBNAME -s $SMTYPE
+if [ $? != 0 ]
+	then
+		echo "Failed to construct $DB"
+		rm -f ${DB}*
+		exit 1
+fi
+
+echo "Generating simulated reads ..."
+$SRCPATH/hmmufotu-sim $DB $SIMFILE -N $SIMNUM -S $SIMSEED
+if [ $? != 0 ]
+	then
+		echo "Failed to generate simulated reads"
+		rm -f ${DB}*
+		exit 1
+fi
+
+echo "Running micro-benchmarks ..."
+./kernel_bench $DB $SIMFILE $MINTIME > $BENCHFILE
+if [ $? == 0 ]
+	then
+		echo "Benchmark results written to $BENCHFILE"
+		cat $BENCHFILE
+	else
+		echo "Failed to run micro-benchmarks"
+		rm -f ${DB}*
+		exit 1
+fi
+
+rm -f ${DB}*
@@ -0,0 +1,355 @@
+/*
+ * kernel_bench.cpp
+ * Micro-benchmarks of the core alignment, indexing and placement kernels, with results written in JSON
+ *  Created on: Oct 19, 2026
+ *      Author: zhengqi
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <ctime>
+#include "HmmUFOtu.h"
+#include "HmmUFOtu_main.h"
+
+using namespace std;
+using namespace EGriceLab;
+using namespace EGriceLab::HmmUFOtu;
+
+static const double DEFAULT_MIN_TIME = 0.5;
+static const int DEFAULT_SEED_LEN = 20;
+static const int DEFAULT_SEED_REGION = 50;
+static const size_t DEFAULT_MAX_NSEED = 50;
+static const double DEFAULT_MAX_PLACE_ERROR = 20;
+static const int NUM_BRANCH_LEN = 1000;
+static const double MAX_BRANCH_LEN = 1;
+
+/** checksum of all benchmark results, so no work can be optimized away */
+static volatile double sink = 0;
+
+/** monotonic time in seconds */
+double now() {
+	struct timespec ts;
+	::clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** Inputs shared by all benchmarks, all derived deterministically from the database and reads */
+struct BenchData {
+	const BandedHMMP7* hmm;
+	const CSFMIndex* csfm;
+	PTUnrooted* ptu;
+	string readsData; /* raw read file content */
+	string seqFmt;
+	vector<PrimarySeq> reads;
+	vector<vector<BandedHMMP7::ViterbiAlignPath> > vpaths; /* seed paths of each read */
+	vector<BandedHMMP7::ViterbiScores> vscores; /* final Viterbi scores of each read */
+	vector<BandedHMMP7::ViterbiAlignTrace> vtraces;
+	vector<string> seeds; /* seed patterns of all reads */
+	vector<DigitalSeq> alnSeqs; /* aligned reads */
+	vector<BandedHMMP7::HmmAlignment> alns;
+	vector<vector<PTUnrooted::PTLoc> > seedLocs; /* seed nodes of each aligned read */
+	vector<vector<PTUnrooted::PTPlacement> > places; /* filtered estimated placements of each aligned read */
+};
+
+/**
+ * A benchmark runs one pass over its inputs
+ * @return  number of items processed in a pass
+ */
+typedef long (*BenchFunc)(const BenchData& data);
+
+long benchViterbiBanded(const BenchData& data) {
+	long n = 0;
+	for(size_t i = 0; i < data.reads.size(); ++i) {
+		if(data.vpaths[i].empty()) /* no seed found */
+			continue;
+		BandedHMMP7::ViterbiScores vs(data.hmm->getProfileSize(), data.reads[i].length());
+		data.hmm->calcViterbiScores(data.reads[i], vs, data.vpaths[i]);
+		sink += vs.minScore;
+		n++;
+	}
+	return n;
+}
+
+long benchViterbiFull(const BenchData& data) {
+	for(size_t i = 0; i < data.reads.size(); ++i) {
+		BandedHMMP7::ViterbiScores vs(data.hmm->getProfileSize(), data.reads[i].length());
+		data.hmm->calcViterbiScores(data.reads[i], vs);
+		sink += vs.minScore;
+	}
+	return data.reads.size();
+}
+
+long benchViterbiTrace(const BenchData& data) {
+	for(size_t i = 0; i < data.vscores.size(); ++i) {
+		BandedHMMP7::ViterbiAlignTrace vtrace;
+		data.hmm->buildViterbiTrace(data.vscores[i], vtrace);
+		sink += vtrace.minScore;
+	}
+	return data.vscores.size();
+}
+
+long benchGlobalAlign(const BenchData& data) {
+	for(size_t i = 0; i < data.vscores.size(); ++i) {
+		const BandedHMMP7::HmmAlignment& aln = data.hmm->buildGlobalAlign(data.reads[i], data.vscores[i], data.vtraces[i]);
+		sink += aln.csStart;
+	}
+	return data.vscores.size();
+}
+
+long benchCSFMCount(const BenchData& data) {
+	for(vector<string>::const_iterator seed = data.seeds.begin(); seed != data.seeds.end(); ++seed)
+		sink += data.csfm->count(*seed);
+	return data.seeds.size();
+}
+
+long benchCSFMLocateOne(const BenchData& data) {
+	CSFMIndex::RNG rng(0);
+	for(vector<string>::const_iterator seed = data.seeds.begin(); seed != data.seeds.end(); ++seed)
+		sink += data.csfm->locateOne(*seed, rng).start;
+	return data.seeds.size();
+}
+
+long benchPDist(const BenchData& data) {
+	long n = 0;
+	for(size_t i = 0; i < data.alnSeqs.size(); ++i) {
+		for(size_t j = 0; j < data.ptu->numNodes(); ++j) {
+			sink += SeqUtils::pDist(data.ptu->getNode(j)->getSeq(), data.alnSeqs[i], data.alns[i].csStart - 1, data.alns[i].csEnd - 1);
+			n++;
+		}
+	}
+	return n;
+}
+
+long benchEstimateSeq(const BenchData& data) {
+	for(size_t i = 0; i < data.alnSeqs.size(); ++i) {
+		const vector<PTUnrooted::PTPlacement>& places = estimateSeq(*data.ptu, data.alnSeqs[i], data.seedLocs[i], "unweighted");
+		sink += places.front().loglik;
+	}
+	return data.alnSeqs.size();
+}
+
+long benchPlaceSeq(const BenchData& data) {
+	for(size_t i = 0; i < data.alnSeqs.size(); ++i) {
+		vector<PTUnrooted::PTPlacement> places(data.places[i]);
+		placeSeq(*data.ptu, data.alnSeqs[i], places);
+		sink += places.front().loglik;
+	}
+	return data.alnSeqs.size();
+}
+
+long benchPlaceSeqPruned(const BenchData& data) {
+	for(size_t i = 0; i < data.alnSeqs.size(); ++i) {
+		vector<PTUnrooted::PTPlacement> places(data.places[i]);
+		placeSeq(*data.ptu, data.alnSeqs[i], places, PTUnrooted::UNIFORM, qValueMargin(places.size()));
+		sink += places.front().loglik;
+	}
+	return data.alnSeqs.size();
+}
+
+long benchPlaceSeqPrunedML(const BenchData& data) {
+	for(size_t i = 0; i < data.alnSeqs.size(); ++i) {
+		vector<PTUnrooted::PTPlacement> places(data.places[i]);
+		placeSeq(*data.ptu, data.alnSeqs[i], places, PTUnrooted::UNIFORM, 0);
+		sink += places.front().loglik;
+	}
+	return data.alnSeqs.size();
+}
+
+long benchBoundLoglik(const BenchData& data) {
+	long n = 0;
+	for(size_t i = 0; i < data.alnSeqs.size(); ++i) {
+		for(size_t j = 0; j < data.places[i].size(); ++j) {
+			sink += data.ptu->boundLoglik(data.alnSeqs[i], data.places[i][j]);
+			n++;
+		}
+	}
+	return n;
+}
+
+long benchSubModelPr(const BenchData& data) {
+	const PTUnrooted::ModelPtr& model = data.ptu->getModel();
+	for(int i = 1; i <= NUM_BRANCH_LEN; ++i)
+		sink += model->Pr(MAX_BRANCH_LEN * i / NUM_BRANCH_LEN).sum();
+	return NUM_BRANCH_LEN;
+}
+
+long benchSeqIO(const BenchData& data) {
+	istringstream in(data.readsData);
+	SeqIO seqI(&in, data.hmm->getNuclAbc(), data.seqFmt);
+	long n = 0;
+	while(seqI.hasNext()) {
+		sink += seqI.nextSeq().length();
+		n++;
+	}
+	return n;
+}
+
+long benchEvaluate(const BenchData& data) {
+	data.ptu->resetBranchLoglik();
+	data.ptu->evaluate();
+	return 1;
+}
+
+/** run a benchmark for at least minTime seconds, and write its result as a JSON object */
+void runBench(ostream& out, const string& name, BenchFunc func, const BenchData& data, double minTime, bool isLast = false) {
+	func(data); /* warm up */
+	long nPass = 0;
+	long nItem = 0;
+	double start = now();
+	double elapsed = 0;
+	do {
+		nItem += func(data);
+		nPass++;
+		elapsed = now() - start;
+	} while(elapsed < minTime);
+	out << "    {\"name\": \"" << name << "\", \"passes\": " << nPass << ", \"items\": " << nItem
+		<< ", \"seconds\": " << elapsed << ", \"ns_per_item\": " << (nItem > 0 ? elapsed * 1e9 / nItem : 0)
+		<< "}" << (isLast ? "" : ",") << endl;
+	cerr << name << " done" << endl;
+}
+
+int main(int argc, char* argv[]) {
+	if(!(argc == 3 || argc == 4)) {
+		cerr << "Usage:  " << argv[0] << " <HmmUFOtu-DB> <READ-FILE> [MIN-TIME]" << endl
+			 << "Run micro-benchmarks of the core kernels, each for at least MIN-TIME seconds [" << DEFAULT_MIN_TIME << "], and write the results in JSON to stdout" << endl;
+		return EXIT_FAILURE;
+	}
+	const string dbName = argv[1];
+	const string readFn = argv[2];
+	const double minTime = argc == 4 ? ::atof(argv[3]) : DEFAULT_MIN_TIME;
+
+	/* load database */
+	HmmUFOtuDB db;
+	if(!db.open(dbName)) {
+		cerr << "Unable to open HmmUFOtu database '" << dbName << "'" << endl;
+		return EXIT_FAILURE;
+	}
+	istream& csfmIn = db.openSection(CSFM_FILE_SUFFIX);
+	CSFMIndex csfm;
+	if(!csfmIn || loadProgInfo(csfmIn).bad() || csfm.load(csfmIn).bad()) {
+		cerr << "Unable to load CSFM-index: " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	const bool isCompiled = db.hasSection(HMM_BIN_FILE_SUFFIX);
+	istream& hmmIn = db.openSection(isCompiled ? HMM_BIN_FILE_SUFFIX : HMM_FILE_SUFFIX);
+	BandedHMMP7 hmm;
+	if(isCompiled) {
+		HmmUFOtuDB::Checksum srcSum; /* checksum of the source hmm file, not checked by benchmarks */
+		if(loadProgInfo(hmmIn).bad() || srcSum.load(hmmIn).bad() || hmm.load(hmmIn).bad()) {
+			cerr << "Unable to load compiled HMM profile: " << ::strerror(errno) << endl;
+			return EXIT_FAILURE;
+		}
+	}
+	else if(!(hmmIn >> hmm)) {
+		cerr << "Unable to read HMM profile: " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	istream& ptuIn = db.openSection(PHYLOTREE_FILE_SUFFIX);
+	PTUnrooted ptu;
+	if(!ptuIn || loadProgInfo(ptuIn).bad() || ptu.load(ptuIn).bad()) {
+		cerr << "Unable to load Phylogenetic tree data: " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	db.close();
+	hmm.wingRetract();
+	hmm.setSequenceMode(BandedHMMP7::GLOBAL);
+
+	/* prepare inputs */
+	BenchData data;
+	data.hmm = &hmm;
+	data.csfm = &csfm;
+	data.ptu = &ptu;
+	ifstream readIn(readFn.c_str());
+	if(!readIn.is_open()) {
+		cerr << "Unable to open read file '" << readFn << "': " << ::strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	data.readsData.assign(std::istreambuf_iterator<char>(readIn), std::istreambuf_iterator<char>());
+	data.seqFmt = SeqUtils::guessSeqFileFormat(readFn);
+	istringstream readsIn(data.readsData);
+	SeqIO seqI(&readsIn, hmm.getNuclAbc(), data.seqFmt);
+	while(seqI.hasNext())
+		data.reads.push_back(seqI.nextSeq());
+	if(data.reads.empty()) {
+		cerr << "No reads found in '" << readFn << "'" << endl;
+		return EXIT_FAILURE;
+	}
+
+	const int K = hmm.getProfileSize();
+	CSFMIndex::RNG rng(0);
+	for(size_t i = 0; i < data.reads.size(); ++i) {
+		const PrimarySeq& read = data.reads[i];
+		for(int j = 0; j + DEFAULT_SEED_LEN <= DEFAULT_SEED_REGION && j + DEFAULT_SEED_LEN <= read.length(); ++j)
+			data.seeds.push_back(read.subseq(j, DEFAULT_SEED_LEN));
+		data.vpaths.push_back(getSeedPaths(hmm, csfm, read, DEFAULT_SEED_LEN, DEFAULT_SEED_REGION, BandedHMMP7::GLOBAL, rng));
+	}
+	/* banded scores, traces and alignments of reads in read order, using the full DP when no seed found */
+	for(size_t i = 0; i < data.reads.size(); ++i) {
+		data.vscores.push_back(BandedHMMP7::ViterbiScores(K, data.reads[i].length()));
+		if(!data.vpaths[i].empty())
+			hmm.calcViterbiScores(data.reads[i], data.vscores.back(), data.vpaths[i]);
+		if(data.vscores.back().minScore == inf) {
+			data.vscores.back().reset();
+			hmm.calcViterbiScores(data.reads[i], data.vscores.back());
+		}
+		data.vtraces.push_back(BandedHMMP7::ViterbiAlignTrace());
+		hmm.buildViterbiTrace(data.vscores.back(), data.vtraces.back());
+		data.alns.push_back(hmm.buildGlobalAlign(data.reads[i], data.vscores.back(), data.vtraces.back()));
+		data.alnSeqs.push_back(DigitalSeq(hmm.getNuclAbc(), data.reads[i].getId(), data.alns.back().align));
+	}
+	for(size_t i = 0; i < data.alnSeqs.size(); ++i) {
+		vector<PTUnrooted::PTLoc> seeds = getSeed(ptu, data.alnSeqs[i], data.alns[i].csStart - 1, data.alns[i].csEnd - 1);
+		if(seeds.size() > DEFAULT_MAX_NSEED)
+			seeds.erase(seeds.begin() + DEFAULT_MAX_NSEED, seeds.end());
+		data.seedLocs.push_back(seeds);
+		vector<PTUnrooted::PTPlacement> places = estimateSeq(ptu, data.alnSeqs[i], seeds, "unweighted");
+		data.places.push_back(filterPlacements(places, DEFAULT_MAX_PLACE_ERROR));
+	}
+	/* placements pruned by placeSeq at the default -e, with the Q-value margin and with no margin (--ML) */
+	long nPlace = 0;
+	long nPruned = 0;
+	long nPrunedML = 0;
+	for(size_t i = 0; i < data.alnSeqs.size(); ++i) {
+		vector<PTUnrooted::PTPlacement> places(data.places[i]);
+		nPlace += places.size();
+		placeSeq(ptu, data.alnSeqs[i], places, PTUnrooted::UNIFORM, qValueMargin(places.size()), &nPruned);
+		places = data.places[i];
+		placeSeq(ptu, data.alnSeqs[i], places, PTUnrooted::UNIFORM, 0, &nPrunedML);
+	}
+	cerr << "Benchmark inputs prepared with " << data.reads.size() << " reads" << endl;
+
+	/* run benchmarks */
+	cout << "{" << endl
+		 << "  \"db\": \"" << dbName << "\"," << endl
+		 << "  \"reads\": " << data.reads.size() << "," << endl
+		 << "  \"seeds\": " << data.seeds.size() << "," << endl
+		 << "  \"placements\": " << nPlace << "," << endl
+		 << "  \"pruned_placements\": " << nPruned << "," << endl
+		 << "  \"pruned_placements_ML\": " << nPrunedML << "," << endl
+		 << "  \"min_time\": " << minTime << "," << endl
+		 << "  \"benchmarks\": [" << endl;
+	runBench(cout, "BandedHMMP7::calcViterbiScores/banded", benchViterbiBanded, data, minTime);
+	runBench(cout, "BandedHMMP7::calcViterbiScores/full", benchViterbiFull, data, minTime);
+	runBench(cout, "BandedHMMP7::buildViterbiTrace", benchViterbiTrace, data, minTime);
+	runBench(cout, "BandedHMMP7::buildGlobalAlign", benchGlobalAlign, data, minTime);
+	runBench(cout, "CSFMIndex::count", benchCSFMCount, data, minTime);
+	runBench(cout, "CSFMIndex::locateOne", benchCSFMLocateOne, data, minTime);
+	runBench(cout, "SeqUtils::pDist", benchPDist, data, minTime);
+	runBench(cout, "estimateSeq", benchEstimateSeq, data, minTime);
+	runBench(cout, "placeSeq", benchPlaceSeq, data, minTime);
+	runBench(cout, "placeSeq/pruned", benchPlaceSeqPruned, data, minTime);
+	runBench(cout, "placeSeq/pruned-ML", benchPlaceSeqPrunedML, data, minTime);
+	runBench(cout, "PTUnrooted::boundLoglik", benchBoundLoglik, data, minTime);
+	runBench(cout, "DNASubModel::Pr", benchSubModelPr, data, minTime);
+	runBench(cout, "SeqIO::nextSeq", benchSeqIO, data, minTime);
+	runBench(cout, "PTUnrooted::evaluate", benchEvaluate, data, minTime, true); /* last, as it resets the cached loglik */
+	cout << "  ]," << endl
+		 << "  \"checksum\": " << sink << endl
+		 << "}" << endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,186 @@
+#!/bin/bash
+
+# basic info
+INPUT="70_otus"
+SMTYPE="GTR"
+SRCPATH="../src"
+
+# synthetic database info, each 70_otus leaf is replaced by a clade of SYNCOPY mutated copies
+SYNNAME="${INPUT}_syn"
+SYNCOPY=${SCALING_SYN_COPY:-8}
+SYNMUT=0.02
+SYNSEED=0
+
+# simulating info
+SIMNUM=${SCALING_READS:-200}
+SIMLEN=150
+SIMSEED=0
+
+# benchmark info
+THREADS=${SCALING_THREADS:-"1 2 4"}
+PREFIX="scaling_bench"
+BENCHFILE="${PREFIX}.tsv"
+REPORTFILE="${PREFIX}_report.txt"
+WORKDIR="${PREFIX}_tmp"
+
+# current time in nanoseconds
+now() {
+	date +%s%N
+}
+
+# build a synthetic database larger than 70_otus by replicating each sequence and tree leaf
+build_synthetic() {
+	awk -v k=$SYNCOPY -v p=$SYNMUT -v seed=$SYNSEED '
+		BEGIN { srand(seed); split("A C G T", base, " ") }
+		/^>/ { id = substr($1, 2); next }
+		{ seq[id] = seq[id] $0; if(!(id in seen)) { seen[id] = 1; ids[++n] = id } }
+		END {
+			for(i = 1; i <= n; i++)
+				for(c = 1; c <= k; c++) {
+					s = seq[ids[i]]
+					out = ""
+					for(j = 1; j <= length(s); j++) {
+						ch = substr(s, j, 1)
+						if(ch ~ /[ACGTacgt]/ && rand() < p)
+							ch = base[int(rand() * 4) + 1]
+						out = out ch
+					}
+					print ">" ids[i] "_" c
+					print out
+				}
+		}' ${INPUT}.fasta > $WORKDIR/${SYNNAME}.fasta
+
+	awk -v k=$SYNCOPY '
+		{
+			out = ""
+			while(match($0, /[(,][0-9]+:/)) {
+				id = substr($0, RSTART + 1, RLENGTH - 2)
+				clade = id "_" k ":0.001"
+				for(c = k - 1; c >= 1; c--)
+					clade = "(" id "_" c ":0.001," clade ")" (c > 1 ? ":0.0005" : "")
+				out = out substr($0, 1, RSTART) clade ":"
+				$0 = substr($0, RSTART + RLENGTH)
+			}
+			print out $0
+		}' ${INPUT}.tree > $WORKDIR/${SYNNAME}.tree
+
+	awk -v k=$SYNCOPY -F '\t' '{ for(c = 1; c <= k; c++) print $1 "_" c "\t" $2 }' \
+		${INPUT}_taxonomy.txt > $WORKDIR/${SYNNAME}_taxonomy.txt
+}
+
+# run hmmufotu once, and append reads/sec, peak RSS and time-to-first-record to BENCHFILE
+# usage: run_one DB-NAME DB INPUT-TYPE MODE THREADS NREAD READ-FILE(s) [options]
+run_one() {
+	local dbName=$1 db=$2 type=$3 mode=$4 nThread=$5 nRead=$6
+	shift 6
+	local out=$WORKDIR/run.out
+	rm -f $out $WORKDIR/run.chimera
+	local start=$(now)
+	$SRCPATH/hmmufotu $db "$@" -p $nThread -o $out 2> $WORKDIR/run.log &
+	local pid=$!
+	local first="" rss=0 hwm
+	while kill -0 $pid 2> /dev/null; do
+		hwm=$(awk '/^VmHWM:/ { print $2 }' /proc/$pid/status 2> /dev/null)
+		[ -n "$hwm" ] && rss=$hwm
+		if [ -z "$first" ] && [ -s $out ] && grep -qv '^#\|^id' $out; then
+			first=$(now)
+		fi
+		sleep 0.01
+	done
+	wait $pid
+	if [ $? != 0 ]; then
+		echo "Failed to run hmmufotu on $dbName ($type $mode, $nThread threads)"
+		cat $WORKDIR/run.log
+		return 1
+	fi
+	local end=$(now)
+	[ -z "$first" ] && first=$end # output flushed only at exit
+	awk -v OFS='\t' -v db=$dbName -v type=$type -v mode=$mode -v p=$nThread -v n=$nRead \
+		-v start=$start -v end=$end -v first=$first -v rss=$rss \
+		'BEGIN { t = (end - start) / 1e9; print db, type, mode, p, n, sprintf("%.3f", t), sprintf("%.2f", n / t), sprintf("%.3f", (first - start) / 1e9), rss }' >> $BENCHFILE
+	echo "$dbName $type $mode $nThread threads $nRead reads: $(tail -n 1 $BENCHFILE | cut -f 6) sec"
+}
+
+# simulate NREAD reads from DB, single-end as amplicons and paired-end with SIMLEN read length
+simulate() {
+	local db=$1 nRead=$2
+	$SRCPATH/hmmufotu-sim $db $WORKDIR/${db##*/}_${nRead}.fasta -N $nRead -S $SIMSEED &&
+	$SRCPATH/hmmufotu-sim $db $WORKDIR/${db##*/}_${nRead}_1.fasta $WORKDIR/${db##*/}_${nRead}_2.fasta -N $nRead -r $SIMLEN -S $SIMSEED
+}
+
+rm -rf $WORKDIR
+mkdir -p $WORKDIR
+printf "db\tinput\tmode\tthreads\treads\tseconds\treads_per_sec\tfirst_record_sec\tpeak_rss_kb\n" > $BENCHFILE
+
+echo "Constructing benchmark databases ..."
+build_synthetic
+$SRCPATH/hmmufotu-build ${INPUT}.fasta ${INPUT}.tree -a ${INPUT}_taxonomy.txt -n $WORKDIR/$INPUT -s $SMTYPE > /dev/null &&
+$SRCPATH/hmmufotu-build $WORKDIR/${SYNNAME}.fasta $WORKDIR/${SYNNAME}.tree -a $WORKDIR/${SYNNAME}_taxonomy.txt -n $WORKDIR/$SYNNAME -s $SMTYPE > /dev/null
+if [ $? != 0 ]
+	then
+		echo "Failed to construct benchmark databases"
+		rm -rf $WORKDIR
+		exit 1
+fi
+
+for dbName in $INPUT $SYNNAME; do
+	DB="$WORKDIR/${dbName}_${SMTYPE}"
+	echo "Generating simulated reads from $dbName ..."
+	simulate $DB $SIMNUM || { echo "Failed to generate simulated reads"; rm -rf $WORKDIR; exit 1; }
+	for p in $THREADS; do
+		# weak scaling reads, SIMNUM per thread
+		[ $p != 1 ] && { simulate $DB $((SIMNUM * p)) || { echo "Failed to generate simulated reads"; rm -rf $WORKDIR; exit 1; }; }
+	done
+
+	# strong scaling, fixed number of reads
+	for p in $THREADS; do
+		for type in single paired; do
+			if [ $type == single ]; then
+				READS="$WORKDIR/${dbName}_${SMTYPE}_${SIMNUM}.fasta"
+			else
+				READS="$WORKDIR/${dbName}_${SMTYPE}_${SIMNUM}_1.fasta $WORKDIR/${dbName}_${SMTYPE}_${SIMNUM}_2.fasta"
+			fi
+			run_one $dbName $DB $type align-only $p $SIMNUM $READS --align-only -S $SIMSEED &&
+			run_one $dbName $DB $type full $p $SIMNUM $READS -S $SIMSEED &&
+			run_one $dbName $DB $type chimera $p $SIMNUM $READS -S $SIMSEED -C --chimera-out $WORKDIR/run.chimera ||
+			{ rm -rf $WORKDIR; exit 1; }
+		done
+	done
+
+	# weak scaling, full placement of single-end reads with SIMNUM reads per thread
+	for p in $THREADS; do
+		[ $p == 1 ] && continue
+		run_one $dbName $DB single weak $p $((SIMNUM * p)) $WORKDIR/${dbName}_${SMTYPE}_$((SIMNUM * p)).fasta -S $SIMSEED ||
+		{ rm -rf $WORKDIR; exit 1; }
+	done
+done
+
+# scaling report, strong scaling relative to 1 thread with the same reads, weak scaling relative to 1 thread full run
+awk -F '\t' '
+	NR == 1 { next }
+	$4 == 1 && $3 != "weak" { base[$1 FS $2 FS $3] = $6 }
+	$4 == 1 && $2 == "single" && $3 == "full" { weak[$1] = $6 }
+	{ row[NR] = $0 }
+	END {
+		print "Strong scaling (fixed reads): db, input, mode, threads, seconds, speedup, efficiency"
+		for(i = 2; i <= NR; i++) {
+			split(row[i], f, FS)
+			if(f[3] == "weak" || !((f[1] FS f[2] FS f[3]) in base))
+				continue
+			s = base[f[1] FS f[2] FS f[3]] / f[6]
+			printf "%s\t%s\t%s\t%d\t%.3f\t%.2f\t%.2f\n", f[1], f[2], f[3], f[4], f[6], s, s / f[4]
+		}
+		print ""
+		print "Weak scaling (reads per thread fixed, single-end full): db, threads, reads, seconds, efficiency"
+		for(i = 2; i <= NR; i++) {
+			split(row[i], f, FS)
+			if(!(f[1] in weak) || !(f[3] == "weak" || (f[4] == 1 && f[2] == "single" && f[3] == "full")))
+				continue
+			printf "%s\t%d\t%d\t%.3f\t%.2f\n", f[1], f[4], f[5], f[6], weak[f[1]] / f[6]
+		}
+	}' $BENCHFILE > $REPORTFILE
+
+echo "Benchmark results written to $BENCHFILE and $REPORTFILE"
+cat $REPORTFILE
+
+rm -rf $WORKDIR
@@ -13,6 +13,10 @@ SIMSEED=0
 # assigning info
 ASSIGNFILE="${DB}_sim_assign.txt"
 CHIMERAFILE="${DB}_sim_chimera.txt"
+ASSIGNSEED=0
+SHARDNUM=2
+SHARDPREFIX="${DB}_sim_assign_shard"
+MERGEDASSIGNFILE="${DB}_sim_assign_merged.txt"
 
 # OTU info
 OTUFILE="${DB}_sim_OTU.txt"
@@ -60,6 +64,22 @@ exit 1
 fi
 
 
+echo "Running sharded taxonomy assignment ..."
+$SRCPATH/hmmufotu $DB $SIMFILE -o $ASSIGNFILE -S $ASSIGNSEED -v
+SHARDFILES=""
+for ((i = 0; i < $SHARDNUM; i++)); do
+	$SRCPATH/hmmufotu $DB $SIMFILE -o $SHARDPREFIX$i.txt -S $ASSIGNSEED --shard $i/$SHARDNUM -v || exit 1
+	SHARDFILES="$SHARDFILES $SHARDPREFIX$i.txt"
+done
+$SRCPATH/hmmufotu --merge-shards $SIMFILE $SHARDFILES -o $MERGEDASSIGNFILE -v
+if [ $? == 0 ] && diff <(grep -v '^#' $ASSIGNFILE) <(grep -v '^#' $MERGEDASSIGNFILE) > /dev/null
+	then
+		echo "merged shard assignments identical to unsharded assignments"
+	else
+		echo "Merged shard assignments differ from unsharded assignments"
+		exit 1
+fi
+
 echo "Summarizing OTU table ..."
 $SRCPATH/hmmufotu-sum $DB $ASSIGNFILE -o $OTUFILE -r $OTULIST -c $OTUALIGN -t $OTUTREE -v
 if [ $? == 0 ]